@@ -0,0 +1,29 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QStringList>
+#include <QVector>
+
+struct ScenarioRecord;
+
+/*
+ * Benchmark cases of vesikko-bench. Each takes the arguments after its
+ * name and prints one result line per measurement, whitespace separated
+ * key=value pairs after the case name, so runs can be compared by script.
+ */
+int benchTick(const QStringList &args);
+int benchSession(const QStringList &args);
+int benchFireControl(const QStringList &args);
+// Hot paths of the views and the servo gauges, reported with benchstats.h
+int benchVessel(const QStringList &args);
+int benchCollisions(const QStringList &args);
+int benchMapUpdate(const QStringList &args);
+int benchSphereSegment(const QStringList &args);
+int benchCubeMap(const QStringList &args);
+int benchServo(const QStringList &args);
+int benchRender(const QStringList &args);
+
+// Ships in convoys, as many as count, shared by the cases
+void generateConvoys(int count, QVector<ScenarioRecord> &records);
+
+#endif // BENCHMARKS_H
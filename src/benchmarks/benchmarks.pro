@@ -0,0 +1,75 @@
+#-------------------------------------------------
+#
+# Benchmarks of the simulation and the views, run
+# from the command line: vesikko-bench <case> [options]
+#
+#-------------------------------------------------
+
+QT += gui declarative network
+
+TARGET = vesikko-bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += link_prl
+
+CONFIG += link_pkgconfig
+PKGCONFIG += openscenegraph
+LIBS += -losgOcean
+LIBS += ../periscopeview/libperiscopeview.a
+LIBS += ../mapview/libmapview.a
+LIBS += ../servogauges/libservogauges.a
+LIBS += ../profiling/libprofiling.a
+
+SOURCES += main.cpp \
+    benchstats.cpp \
+    tickbench.cpp \
+    sessionbench.cpp \
+    firecontrolbench.cpp \
+    vesselbench.cpp \
+    periscopebench.cpp \
+    mapbench.cpp \
+    servobench.cpp \
+    renderbench.cpp \
+    ../simulation/simulation.cpp \
+    ../simulation/vessel.cpp \
+    ../simulation/torpedo.cpp \
+    ../simulation/contactgrid.cpp \
+    ../simulation/shipai.cpp \
+    ../simulation/workpool.cpp \
+    ../simulation/taskgraph.cpp \
+    ../simulation/worldpartition.cpp \
+    ../simulation/sensors.cpp \
+    ../simulation/scenario.cpp \
+    ../simulation/replication.cpp \
+    ../simulation/sessionserver.cpp \
+    ../simulation/sessionclient.cpp \
+    ../simulation/tmasolver.cpp \
+    ../simulation/firecontrol.cpp \
+    ../simulation/simulationrecorder.cpp \
+    ../simulation/snapshotring.cpp \
+    ../simulation/timingwheel.cpp \
+    ../simulation/bathymetry.cpp
+
+HEADERS += benchmarks.h \
+    benchstats.h \
+    ../simulation/simulation.h \
+    ../simulation/vessel.h \
+    ../simulation/torpedo.h \
+    ../simulation/contactgrid.h \
+    ../simulation/shipai.h \
+    ../simulation/workpool.h \
+    ../simulation/taskgraph.h \
+    ../simulation/worldpartition.h \
+    ../simulation/sensors.h \
+    ../simulation/scenario.h \
+    ../simulation/replication.h \
+    ../simulation/sessionserver.h \
+    ../simulation/sessionclient.h \
+    ../simulation/tmasolver.h \
+    ../simulation/firecontrol.h \
+    ../simulation/simulationrecorder.h \
+    ../simulation/simulationstate.h \
+    ../simulation/snapshotring.h \
+    ../simulation/timingwheel.h \
+    ../simulation/bathymetry.h
@@ -0,0 +1,65 @@
+#include "benchstats.h"
+#include "../profiling/profiler.h"
+#include <math.h>
+
+static int sampleCount = BENCH_SAMPLES;
+
+int benchSampleCount() {
+    return sampleCount;
+}
+
+void setBenchSampleCount(int samples) {
+    sampleCount = qMax(1, samples);
+}
+
+BenchStats benchStats(QVector<double> samples) {
+    BenchStats s;
+    s.samples = samples.size();
+    s.mean = s.median = s.stddev = s.min = s.max = s.p95 = 0;
+    if(samples.isEmpty()) return s;
+    qSort(samples.begin(), samples.end());
+    int n = samples.size();
+    double sum = 0;
+    for(int i=0;i<n;i++)
+        sum += samples[i];
+    s.mean = sum / n;
+    double squares = 0;
+    for(int i=0;i<n;i++)
+        squares += (samples[i] - s.mean) * (samples[i] - s.mean);
+    s.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+    s.median = n & 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    s.min = samples.first();
+    s.max = samples.last();
+    s.p95 = samples[qMin(n - 1, (int) ceil(0.95 * n) - 1)];
+    return s;
+}
+
+BenchStats BenchLoop::measure(double perRun) {
+    for(int i=0;i<BENCH_WARMUP;i++) {
+        prepare();
+        run();
+    }
+    QVector<double> samples(benchSampleCount());
+    for(int i=0;i<samples.size();i++) {
+        prepare();
+        qint64 start = Profiler::now();
+        run();
+        samples[i] = (Profiler::now() - start) / perRun;
+    }
+    return benchStats(samples);
+}
+
+void printStats(QTextStream &out, const QString &caseName, const QString &params, const BenchStats &s,
+                const char *unit) {
+    out << caseName;
+    if(!params.isEmpty())
+        out << " " << params;
+    out << " samples=" << s.samples
+        << " median_" << unit << "=" << QString::number(s.median, 'f', 1)
+        << " mean_" << unit << "=" << QString::number(s.mean, 'f', 1)
+        << " stddev_" << unit << "=" << QString::number(s.stddev, 'f', 1)
+        << " min_" << unit << "=" << QString::number(s.min, 'f', 1)
+        << " p95_" << unit << "=" << QString::number(s.p95, 'f', 1)
+        << " max_" << unit << "=" << QString::number(s.max, 'f', 1) << "\n";
+    out.flush();
+}
@@ -0,0 +1,43 @@
+#ifndef BENCHSTATS_H
+#define BENCHSTATS_H
+
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+// Untimed runs before the samples, and the samples taken by default
+#define BENCH_WARMUP 3
+#define BENCH_SAMPLES 20
+
+// Summary of repeated timings of one measurement
+struct BenchStats
+{
+    int samples;
+    double mean, median, stddev, min, max, p95;
+};
+
+BenchStats benchStats(QVector<double> samples);
+// Samples per measurement, set with --samples
+int benchSampleCount();
+void setBenchSampleCount(int samples);
+
+/*
+ * Times run() BENCH_WARMUP + benchSampleCount() times and keeps the last
+ * ones, each divided by perRun (e.g. the vessels ticked), in nanoseconds.
+ * prepare() runs untimed before every run().
+ */
+class BenchLoop
+{
+public:
+    virtual ~BenchLoop() {}
+    virtual void prepare() {}
+    virtual void run() = 0;
+    BenchStats measure(double perRun = 1);
+};
+
+// One result line: the case, its parameters, then the statistics with
+// the unit as a suffix, e.g. "vessel type=ship count=1000 median_ns=..."
+void printStats(QTextStream &out, const QString &caseName, const QString &params, const BenchStats &stats,
+                const char *unit = "ns");
+
+#endif // BENCHSTATS_H
@@ -0,0 +1,112 @@
+#include <QTextStream>
+#include <QTime>
+#include <QVector>
+#include <stdlib.h>
+#include <math.h>
+#include "benchmarks.h"
+#include "../simulation/firecontrol.h"
+#include "../simulation/torpedo.h"
+
+#define FIRECONTROL_SCENARIOS 4096
+#define FIRECONTROL_DT 0.05
+
+// Launches from a sub at up to 8 m/s on any heading, at targets 300-2000 m
+// off on any course at up to 12 m/s
+static void generateShots(QVector<TorpedoLaunch> &launches, QVector<TargetMotion> &targets) {
+    srand48(FIRECONTROL_SCENARIOS);
+    launches.resize(FIRECONTROL_SCENARIOS);
+    targets.resize(FIRECONTROL_SCENARIOS);
+    for(int i=0;i<FIRECONTROL_SCENARIOS;i++) {
+        TorpedoLaunch &l = launches[i];
+        l.x = l.y = 0;
+        l.heading = drand48() * 360;
+        l.speed = drand48() * 8;
+        TargetMotion &t = targets[i];
+        double range = 300 + drand48() * 1700, bearing = drand48() * 2 * M_PI;
+        t.x = sin(bearing) * range;
+        t.y = -cos(bearing) * range;
+        t.course = drand48() * 360;
+        t.speed = drand48() * 12;
+    }
+}
+
+// Closest approach of a real torpedo fired on the solution
+static double missDistance(const TorpedoLaunch &l, const TargetMotion &target, const FiringSolution &s) {
+    Torpedo torpedo(0, 1);
+    torpedo.x = l.x;
+    torpedo.y = l.y;
+    torpedo.heading = l.heading;
+    torpedo.speed = l.speed + TORPEDO_LAUNCH_SPEED;
+    torpedo.headingCommand = s.gyro;
+    double c = target.course * (M_PI/180.0);
+    double tx = target.x, ty = target.y, closest = 1e9;
+    while(torpedo.runTime < s.runTime + 2) {
+        torpedo.tickTime(FIRECONTROL_DT, 0);
+        tx += sin(c) * target.speed * FIRECONTROL_DT;
+        ty -= cos(c) * target.speed * FIRECONTROL_DT;
+        closest = qMin(closest, sqrt((torpedo.x - tx) * (torpedo.x - tx) + (torpedo.y - ty) * (torpedo.y - ty)));
+    }
+    return closest;
+}
+
+/*
+ * Torpedo data computer: intercept solves per second over random shots,
+ * single and as salvo spreads, and how close real torpedoes fired on the
+ * solutions get to their targets.
+ *
+ *   vesikko-bench firecontrol [solves] [salvo]
+ */
+int benchFireControl(const QStringList &args) {
+    QTextStream out(stdout);
+    int solves = args.size() > 0 ? qMax(1, args[0].toInt()) : 1000000;
+    int salvo = args.size() > 1 ? qMax(1, args[1].toInt()) : 4;
+    QVector<TorpedoLaunch> launches;
+    QVector<TargetMotion> targets;
+    generateShots(launches, targets);
+
+    QVector<FiringSolution> solutions(salvo);
+    qint64 iterations = 0;
+    int valid = 0;
+    QTime time;
+    time.start();
+    for(int i=0;i<solves;i++) {
+        int n = i % FIRECONTROL_SCENARIOS;
+        solveIntercept(launches[n], targets[n], solutions[0]);
+        iterations += solutions[0].iterations;
+        valid += solutions[0].valid;
+    }
+    int elapsed = qMax(1, time.elapsed());
+    out << "firecontrol case=single solves=" << solves
+        << " solves_per_sec=" << QString::number(solves * 1000.0 / elapsed, 'f', 0)
+        << " iterations=" << QString::number((double) iterations / solves, 'f', 2)
+        << " valid_pct=" << QString::number(100.0 * valid / solves, 'f', 1) << "\n";
+
+    int salvos = qMax(1, solves / salvo);
+    time.start();
+    for(int i=0;i<salvos;i++) {
+        int n = i % FIRECONTROL_SCENARIOS;
+        solveSpread(launches[n], targets[n], salvo, 100, solutions.data());
+    }
+    elapsed = qMax(1, time.elapsed());
+    out << "firecontrol case=spread torpedoes=" << salvo << " salvos=" << salvos
+        << " salvos_per_sec=" << QString::number(salvos * 1000.0 / elapsed, 'f', 0)
+        << " solves_per_sec=" << QString::number(salvos * salvo * 1000.0 / elapsed, 'f', 0) << "\n";
+
+    double missSum = 0, missMax = 0;
+    int shots = 0, hits = 0;
+    for(int n=0;n<FIRECONTROL_SCENARIOS;n++) {
+        FiringSolution s;
+        if(!solveIntercept(launches[n], targets[n], s)) continue;
+        double miss = missDistance(launches[n], targets[n], s);
+        missSum += miss;
+        missMax = qMax(missMax, miss);
+        shots++;
+        if(miss < TORPEDO_HIT_RADIUS)
+            hits++;
+    }
+    out << "firecontrol case=accuracy shots=" << shots
+        << " miss_mean=" << QString::number(shots ? missSum / shots : 0, 'f', 1)
+        << " miss_max=" << QString::number(missMax, 'f', 1)
+        << " hit_pct=" << QString::number(shots ? 100.0 * hits / shots : 0, 'f', 1) << "\n";
+    return 0;
+}
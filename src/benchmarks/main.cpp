@@ -0,0 +1,60 @@
+#include <QApplication>
+#include <QStringList>
+#include <QTextStream>
+#include "benchmarks.h"
+#include "benchstats.h"
+
+static int usage() {
+    QTextStream(stdout) << "Usage: vesikko-bench [--samples n] <case> [options]\n"
+                        << "       vesikko-bench tick [vessels,...] [ticks] [maxthreads]\n"
+                        << "       vesikko-bench session [clients] [contacts] [ticks]\n"
+                        << "       vesikko-bench firecontrol [solves] [salvo]\n"
+                        << "       vesikko-bench vessel [vessels,...]\n"
+                        << "       vesikko-bench collisions [vessels,...]\n"
+                        << "       vesikko-bench mapupdate [contacts,...]\n"
+                        << "       vesikko-bench spheresegment\n"
+                        << "       vesikko-bench cubemap [dir,...]\n"
+                        << "       vesikko-bench servo\n"
+                        << "       vesikko-bench render [frames] [width] [height] [imagedir] [slices]\n";
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    // Only the map needs a window system
+    bool gui = false;
+    for(int i=1;i<argc;i++)
+        gui = gui || QString(argv[i]) == "mapupdate";
+    QApplication app(argc, argv, gui);
+    QStringList args = app.arguments();
+    int samplesArg = args.indexOf("--samples");
+    if(samplesArg > 0 && samplesArg + 1 < args.size()) {
+        setBenchSampleCount(args[samplesArg + 1].toInt());
+        args.removeAt(samplesArg);
+        args.removeAt(samplesArg);
+    }
+    if(args.size() < 2) return usage();
+    QString name = args[1];
+    args = args.mid(2);
+    if(name == "tick")
+        return benchTick(args);
+    if(name == "session")
+        return benchSession(args);
+    if(name == "firecontrol")
+        return benchFireControl(args);
+    if(name == "vessel")
+        return benchVessel(args);
+    if(name == "collisions")
+        return benchCollisions(args);
+    if(name == "mapupdate")
+        return benchMapUpdate(args);
+    if(name == "spheresegment")
+        return benchSphereSegment(args);
+    if(name == "cubemap")
+        return benchCubeMap(args);
+    if(name == "servo")
+        return benchServo(args);
+    if(name == "render")
+        return benchRender(args);
+    return usage();
+}
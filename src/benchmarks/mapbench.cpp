@@ -0,0 +1,71 @@
+#include <QTextStream>
+#include <QDeclarativeView>
+#include <QGraphicsObject>
+#include <QVector>
+#include <stdlib.h>
+#include <math.h>
+#include "benchmarks.h"
+#include "benchstats.h"
+#include "../simulation/vessel.h"
+#include "../mapview/mapqmlupdater.h"
+#include "../mapview/mapview.h"
+
+class MapUpdateLoop : public BenchLoop
+{
+public:
+    MapUpdateLoop(MapQmlUpdater *u, const QVector<Vessel*> &v) : updater(u), vessels(v) {}
+    void run() {
+        for(int i=0;i<vessels.size();i++) {
+            Vessel *v = vessels[i];
+            v->x += 1;
+            v->heading = fmod(v->heading + 1, 360);
+            updater->vesselUpdated(v);
+        }
+    }
+    MapQmlUpdater *updater;
+    QVector<Vessel*> vessels;
+};
+
+/*
+ * MapQmlUpdater::vesselUpdated pushing every vessel to the map's QML
+ * items, per vessel, the sub first as in a tick. Loads the map QML, so it
+ * needs a display and has to be run from the source tree root.
+ *
+ *   vesikko-bench mapupdate [contacts,...]
+ */
+int benchMapUpdate(const QStringList &args) {
+    QTextStream out(stdout);
+    QStringList countList = (args.size() > 0 ? args[0] : QString("100,1000")).split(",");
+    foreach(QString countText, countList) {
+        int count = countText.toInt();
+        if(count <= 0) continue;
+        MapView::registerTypes();
+        QDeclarativeView view;
+        view.setSource(QUrl::fromLocalFile("src/mapview/qml/vesikko/main.qml"));
+        QGraphicsObject *root = view.rootObject();
+        QObject *sub = root ? root->findChild<QObject*>("sub") : 0;
+        if(!sub) {
+            out << "mapupdate error=no-qml\n";
+            return 1;
+        }
+        MapQmlUpdater updater(0);
+        updater.init(sub, root->findChild<QObject*>("helm"), root);
+
+        srand48(count);
+        QVector<Vessel*> vessels;
+        vessels.append(new Vessel(0, 0));
+        for(int i=1;i<=count;i++) {
+            Vessel *v = new Vessel(0, i);
+            v->type = 1;
+            v->x = (drand48() - 0.5) * 20000;
+            v->y = (drand48() - 0.5) * 20000;
+            v->heading = drand48() * 360;
+            vessels.append(v);
+        }
+        updater.createVessels(vessels.mid(1));
+        MapUpdateLoop loop(&updater, vessels);
+        printStats(out, "mapupdate", "contacts=" + QString::number(count), loop.measure(vessels.size()));
+        qDeleteAll(vessels);
+    }
+    return 0;
+}
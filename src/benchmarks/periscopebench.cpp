@@ -0,0 +1,142 @@
+#include <QTextStream>
+#include <QMap>
+#include <QVector>
+#include <stdlib.h>
+#include <math.h>
+#include <osg/MatrixTransform>
+#include <osg/ShapeDrawable>
+#include "benchmarks.h"
+#include "benchstats.h"
+#include "../simulation/vessel.h"
+#include "../periscopeview/periscopeview.h"
+#include "../periscopeview/SphereSegment.h"
+#include "../periscopeview/cubemap.h"
+
+// One torpedo for every this many vessels in the collision measurement
+#define COLLISION_TORPEDO_RATIO 10
+// The sky dome's segment, see SkyDome
+#define SPHERE_RADIUS 15000.f
+#define SPHERE_STEPS 16
+
+class CollisionLoop : public BenchLoop
+{
+public:
+    CollisionLoop(const QMap<Vessel *, osg::MatrixTransform*> &t) : transforms(t), hits(0) {}
+    // Vessels move every frame, so the bounds are recomputed every pass
+    void prepare() {
+        foreach(osg::MatrixTransform *t, transforms)
+            t->dirtyBound();
+    }
+    void run() {
+        QMap<Vessel *, Vessel *> collided;
+        PeriscopeView::findCollisions(transforms, collided);
+        hits = collided.size();
+    }
+    QMap<Vessel *, osg::MatrixTransform*> transforms;
+    int hits;
+};
+
+class SphereLoop : public BenchLoop
+{
+public:
+    SphereLoop(bool c) : cached(c), segment(new SphereSegment) {}
+    void run() {
+        if(cached) {
+            segment->compute(SPHERE_RADIUS, SPHERE_STEPS, SPHERE_STEPS, 90.f, 180.f, 0.f, 360.f);
+        } else {
+            osg::ref_ptr<osg::Geometry> geometry =
+                    SphereSegment::createGeometry(SPHERE_RADIUS, SPHERE_STEPS, SPHERE_STEPS, 90.f, 180.f, 0.f, 360.f);
+        }
+    }
+    bool cached;
+    osg::ref_ptr<SphereSegment> segment;
+};
+
+class CubeMapLoop : public BenchLoop
+{
+public:
+    CubeMapLoop(const std::string &d) : dir(d) {}
+    void run() {
+        cubemap = loadCubeMapTextures(dir);
+    }
+    std::string dir;
+    osg::ref_ptr<osg::TextureCubeMap> cubemap;
+};
+
+/*
+ * The torpedo hit test of PeriscopeView::tick over vessels scattered in
+ * the periscope's world, per pass.
+ *
+ *   vesikko-bench collisions [vessels,...]
+ */
+int benchCollisions(const QStringList &args) {
+    QTextStream out(stdout);
+    QStringList countList = (args.size() > 0 ? args[0] : QString("100,300,1000")).split(",");
+    foreach(QString countText, countList) {
+        int count = countText.toInt();
+        if(count <= 0) continue;
+        srand48(count);
+        double radius = 100 * sqrt((double) count);
+        QVector<Vessel*> vessels;
+        QMap<Vessel *, osg::MatrixTransform*> transforms;
+        for(int i=0;i<count;i++) {
+            Vessel *v = new Vessel(0, i + 1);
+            v->type = i % COLLISION_TORPEDO_RATIO == 0 ? 2 : 1;
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(new osg::ShapeDrawable(v->type == 2 ? new osg::Box(osg::Vec3(), 1, 7, 1)
+                                                                   : new osg::Box(osg::Vec3(), 10, 80, 15)));
+            osg::MatrixTransform *transform = new osg::MatrixTransform;
+            transform->ref();
+            transform->addChild(geode.get());
+            double a = drand48() * 2 * M_PI, d = sqrt(drand48()) * radius;
+            transform->setMatrix(osg::Matrix::rotate(drand48() * 2 * M_PI, osg::Vec3(0, 0, 1))
+                                 * osg::Matrix::translate(sin(a) * d, cos(a) * d, 0));
+            vessels.append(v);
+            transforms.insert(v, transform);
+        }
+        CollisionLoop loop(transforms);
+        BenchStats stats = loop.measure();
+        printStats(out, "collisions", "vessels=" + QString::number(count) + " hits=" + QString::number(loop.hits), stats);
+        foreach(osg::MatrixTransform *t, transforms)
+            t->unref();
+        qDeleteAll(vessels);
+    }
+    return 0;
+}
+
+/*
+ * The sky dome's sphere segment built from scratch, and through the
+ * geometry cache as every dome after the first gets it.
+ *
+ *   vesikko-bench spheresegment
+ */
+int benchSphereSegment(const QStringList &) {
+    QTextStream out(stdout);
+    QString params = "steps=" + QString::number(SPHERE_STEPS);
+    SphereLoop build(false);
+    printStats(out, "spheresegment", params + " cached=no", build.measure());
+    SphereLoop cached(true);
+    printStats(out, "spheresegment", params + " cached=yes", cached.measure());
+    return 0;
+}
+
+/*
+ * Loading the six sky box images of a scene. Run from the directory
+ * resources/ is in, as vesikko is.
+ *
+ *   vesikko-bench cubemap [dir,...]
+ */
+int benchCubeMap(const QStringList &args) {
+    QTextStream out(stdout);
+    QStringList dirs = (args.size() > 0 ? args[0] : QString("sky_clear,sky_dusk")).split(",");
+    foreach(QString dir, dirs) {
+        CubeMapLoop loop(dir.toStdString());
+        BenchStats stats = loop.measure();
+        if(!loop.cubemap.valid() || !loop.cubemap->getImage(osg::TextureCubeMap::POSITIVE_X)) {
+            out << "cubemap dir=" << dir << " error=cannot-load\n";
+            return 1;
+        }
+        printStats(out, "cubemap", "dir=" + dir, stats);
+    }
+    return 0;
+}
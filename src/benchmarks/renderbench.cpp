@@ -0,0 +1,100 @@
+#include <QTextStream>
+#include <QDir>
+#include <QVector>
+#include <math.h>
+#include "benchmarks.h"
+#include "benchstats.h"
+#include "../simulation/vessel.h"
+#include "../profiling/profiler.h"
+#include "../periscopeview/periscopeview.h"
+
+#define RENDER_DT 0.05
+// Frames rendered before timing starts, while textures and shaders load
+#define RENDER_WARMUP 30
+// Reference images taken over the flight
+#define RENDER_CAPTURES 4
+
+// The fixed scene: a convoy in a ring around the sub, and one torpedo
+// running across the view
+static void generateScene(QVector<Vessel*> &vessels) {
+    for(int i=0;i<12;i++) {
+        Vessel *v = new Vessel(0, i + 1);
+        double a = i * (2 * M_PI / 12), d = 800 + 200 * (i % 4);
+        v->type = 1;
+        v->x = sin(a) * d;
+        v->y = -cos(a) * d;
+        v->heading = fmod(i * 30 + 90, 360);
+        vessels.append(v);
+    }
+    Vessel *torpedo = new Vessel(0, 13);
+    torpedo->type = 2;
+    torpedo->x = -300;
+    torpedo->y = -200;
+    torpedo->heading = 90;
+    vessels.append(torpedo);
+}
+
+/*
+ * Periscope frame cost, rendered offscreen: the sub sails a fixed course
+ * while the periscope sweeps the horizon once over the frames. Prints the
+ * frame times, then every render pass zone (osg's update, cull and draw,
+ * the main camera and osgOcean's pre and post render cameras). With a
+ * directory, reference images are written to it. Run from the source tree
+ * root; needs an X display, which can be Xvfb with a software GL. With
+ * several slices the periscope is a panorama of that many width x height
+ * views, each slice's passes are listed on their own and the reference
+ * images are of the middle slice.
+ *
+ *   vesikko-bench render [frames] [width] [height] [imagedir] [slices]
+ */
+int benchRender(const QStringList &args) {
+    QTextStream out(stdout);
+    int frames = args.size() > 0 ? qMax(1, args[0].toInt()) : 300;
+    int width = args.size() > 1 ? qMax(16, args[1].toInt()) : 640;
+    int height = args.size() > 2 ? qMax(16, args[2].toInt()) : 480;
+    QString imageDir = args.size() > 3 ? args[3] : QString();
+    int slices = args.size() > 4 ? qMax(1, args[4].toInt()) : 1;
+    if(!imageDir.isEmpty() && !QDir().mkpath(imageDir)) {
+        out << "render error=cannot-create-" << imageDir << "\n";
+        return 1;
+    }
+
+    PeriscopeView view(0, true, width, height, slices);
+    Vessel sub(0, 0);
+    sub.speed = 5;
+    QVector<Vessel*> vessels;
+    generateScene(vessels);
+    view.createVessels(vessels);
+
+    QVector<double> samples(frames);
+    int total = 0;
+    for(int f=-RENDER_WARMUP;f<frames;f++) {
+        total += RENDER_DT * 1000;
+        sub.y -= sub.speed * RENDER_DT;
+        vessels.last()->x += 20 * RENDER_DT;
+        view.setPeriscopeDirection(f < 0 ? 0 : 360.0 * f / frames);
+        if(!imageDir.isEmpty() && f >= 0 && f % qMax(1, frames / RENDER_CAPTURES) == 0)
+            view.captureFrame(imageDir + QString("/periscope-%1.png").arg(f, 4, 10, QChar('0')));
+        qint64 start = Profiler::now();
+        view.vesselUpdated(&sub);
+        foreach(Vessel *v, vessels)
+            view.vesselUpdated(v);
+        view.tick(RENDER_DT, total);
+        if(f >= 0)
+            samples[f] = Profiler::now() - start;
+    }
+    QString params = "width=" + QString::number(width) + " height=" + QString::number(height)
+            + " slices=" + QString::number(slices);
+    printStats(out, "render", params + " pass=frame", benchStats(samples));
+    // Zone histograms include the warmup frames
+    foreach(ProfileZoneStats zone, Profiler::instance()->stats()) {
+        if(!zone.name.startsWith("periscope.") || zone.name == "periscope.update") continue;
+        out << "render " << params << " pass=" << zone.name.mid(10) << " count=" << zone.count
+            << " mean_ms=" << QString::number(zone.count ? zone.totalMs / zone.count : 0, 'f', 3)
+            << " p50_ms=" << QString::number(zone.p50Ms, 'f', 3)
+            << " p95_ms=" << QString::number(zone.p95Ms, 'f', 3)
+            << " max_ms=" << QString::number(zone.maxMs, 'f', 3) << "\n";
+    }
+    qDeleteAll(vessels);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <QTextStream>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "benchmarks.h"
+#include "benchstats.h"
+#include "../servogauges/servocontroller.h"
+
+// Position commands per run, few enough for the pty to buffer them
+#define SERVO_COMMANDS 256
+
+class ServoLoop : public BenchLoop
+{
+public:
+    ServoLoop(ServoController *s, int m) : servo(s), master(m) {}
+    // Reads away what the last run wrote so writes never block
+    void prepare() {
+        char buffer[4096];
+        while(read(master, buffer, sizeof(buffer)) > 0);
+    }
+    void run() {
+        for(int i=0;i<SERVO_COMMANDS;i++)
+            servo->setPosRaw(0, i & 1 ? SERVO_POS_MIN : SERVO_POS_MAX);
+    }
+    ServoController *servo;
+    int master;
+};
+
+/*
+ * ServoController::setPosRaw writing to a pseudo terminal in place of the
+ * servo board's serial port, per command.
+ *
+ *   vesikko-bench servo
+ */
+int benchServo(const QStringList &) {
+    QTextStream out(stdout);
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        out << "servo error=no-pty\n";
+        return 1;
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    int result = 1;
+    {
+        ServoController servo;
+        if(servo.openSerial(ptsname(master))) {
+            ServoLoop loop(&servo, master);
+            printStats(out, "servo", "commands=" + QString::number(SERVO_COMMANDS), loop.measure(SERVO_COMMANDS));
+            result = 0;
+        } else {
+            out << "servo error=cannot-open\n";
+        }
+    }
+    close(master);
+    return result;
+}
@@ -0,0 +1,114 @@
+#include <QCoreApplication>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QTime>
+#include <QList>
+#include "benchmarks.h"
+#include "../simulation/simulation.h"
+#include "../simulation/scenario.h"
+#include "../simulation/sessionserver.h"
+#include "../simulation/sessionclient.h"
+
+#define SESSION_DT 0.05
+#define SESSION_TIMEOUT 10000
+
+// Runs the event loop until every client has caught up with tick, false
+// on timeout
+static bool waitForClients(const QList<SessionClient*> &clients, int tick, bool joinOnly) {
+    QTime time;
+    time.start();
+    while(time.elapsed() < SESSION_TIMEOUT) {
+        bool done = true;
+        foreach(SessionClient *client, clients) {
+            if(joinOnly ? !client->playerId() : client->world().tick < tick)
+                done = false;
+        }
+        if(done) return true;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return false;
+}
+
+/*
+ * Session replication over loopback: clients join a session on the local
+ * socket, each steering its sub, and the server sends a snapshot to each
+ * of them every tick. Reports the bytes a client gets per tick against a
+ * full snapshot and the unquantized state of the same contacts.
+ *
+ *   vesikko-bench session [clients] [contacts] [ticks]
+ */
+int benchSession(const QStringList &args) {
+    QTextStream out(stdout);
+    int clientCount = args.size() > 0 ? qMax(1, args[0].toInt()) : 4;
+    int contacts = args.size() > 1 ? qMax(1, args[1].toInt()) : 1000;
+    int ticks = args.size() > 2 ? qMax(1, args[2].toInt()) : 200;
+
+    QVector<ScenarioRecord> records;
+    generateConvoys(contacts, records);
+    QTemporaryFile file;
+    if(!file.open() || !Scenario::writeBinary(file.fileName(), records.constData(), contacts)) {
+        out << "session error=cannot-write-scenario\n";
+        return 1;
+    }
+    Simulation simulation;
+    simulation.loadScenario(file.fileName());
+    SessionServer server(&simulation);
+    QString name = QString("vesikko-bench-session-%1").arg(QCoreApplication::applicationPid());
+    if(!server.listen(name)) {
+        out << "session error=cannot-listen\n";
+        return 1;
+    }
+    QObject::connect(&simulation, SIGNAL(tickTime(double, int)), &server, SLOT(replicate()));
+
+    QList<SessionClient*> clients;
+    for(int i=0;i<clientCount;i++) {
+        SessionClient *client = new SessionClient(&server);
+        client->connectToLocal(name);
+        clients.append(client);
+    }
+    // Subs join on the tick after their hello arrives
+    int total = 0;
+    QTime joinTime;
+    joinTime.start();
+    while(server.clientCount() < clientCount || simulation.players().size() < clientCount) {
+        if(joinTime.elapsed() > SESSION_TIMEOUT) {
+            out << "session error=join-timeout\n";
+            return 1;
+        }
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        total += SESSION_DT * 1000;
+        simulation.step(SESSION_DT, total);
+    }
+    if(!waitForClients(clients, 0, true)) {
+        out << "session error=welcome-timeout\n";
+        return 1;
+    }
+    for(int i=0;i<clients.size();i++)
+        clients[i]->setHelm(i % 2 ? 20 : -20);
+
+    SessionServer::Stats before = server.stats();
+    QTime time;
+    time.start();
+    for(int t=0;t<ticks;t++) {
+        total += SESSION_DT * 1000;
+        simulation.step(SESSION_DT, total);
+        if(!waitForClients(clients, simulation.tickCount(), false)) {
+            out << "session error=snapshot-timeout tick=" << t << "\n";
+            return 1;
+        }
+    }
+    int elapsed = time.elapsed();
+    SessionServer::Stats after = server.stats();
+
+    const ReplicaSnapshot &world = clients[0]->world();
+    QByteArray full;
+    encodeSnapshot(world, 0, full);
+    qint64 snapshots = after.snapshots - before.snapshots;
+    out << "session clients=" << clientCount << " contacts=" << world.vessels.size() << " ticks=" << ticks
+        << " bytes_per_tick_per_client=" << QString::number(snapshots ? (double) (after.bytes - before.bytes) / snapshots : 0, 'f', 1)
+        << " full_snapshot_bytes=" << full.size()
+        << " raw_bytes=" << world.vessels.size() * (int) (sizeof(qint32) + 5 * sizeof(double) + sizeof(qint32))
+        << " full_resends=" << after.fullSnapshots - before.fullSnapshots
+        << " ms_per_tick=" << QString::number((double) elapsed / ticks, 'f', 3) << "\n";
+    return 0;
+}
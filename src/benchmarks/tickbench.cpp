@@ -0,0 +1,143 @@
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QThread>
+#include <QTime>
+#include <QVector>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "benchmarks.h"
+#include "../simulation/simulation.h"
+#include "../simulation/scenario.h"
+#include "../simulation/torpedo.h"
+
+// Simulated ticks before timing starts, and torpedo launch interval
+#define TICK_WARMUP 20
+#define TICK_SALVO_INTERVAL 100
+#define TICK_DT 0.05
+
+// Convoys of six as vesikko-scenario generates them, spread so the density
+// stays the same whatever the count
+void generateConvoys(int count, QVector<ScenarioRecord> &records) {
+    srand48(count);
+    double radius = 200 * sqrt((double) count);
+    records.resize(count);
+    for(int i=0;i<count;i++) {
+        ScenarioRecord &r = records[i];
+        memset(&r, 0, sizeof(r));
+        r.type = 1;
+        int member = i % 6;
+        if(member == 0) {
+            double a = drand48() * 2 * M_PI;
+            double d = sqrt(drand48()) * radius;
+            r.x = sin(a) * d;
+            r.y = cos(a) * d;
+            r.heading = drand48() * 360;
+            r.speed = r.speedCommand = 5 + 5 * drand48();
+            r.behaviour = ShipTransit;
+            continue;
+        }
+        const ScenarioRecord &guide = records[i - member];
+        double h = guide.heading * (M_PI/180.0);
+        double right = member < 5 ? ((member & 1) ? -300 : 300) : 800;
+        double ahead = member < 5 ? -400 * ((member + 1) / 2) : 0;
+        r.x = guide.x + right * cos(h) + ahead * sin(h);
+        r.y = guide.y + right * sin(h) - ahead * cos(h);
+        r.heading = guide.heading;
+        r.speed = r.speedCommand = guide.speed;
+        r.behaviour = member < 5 ? ShipConvoy : ShipZigZag;
+    }
+}
+
+// FNV-1a over the kinematic state, in id order
+static quint64 checksum(const SimulationState &state) {
+    QVector<const VesselState*> byId(state.lastVesselId + 1, 0);
+    for(int i=0;i<state.vessels.size();i++)
+        byId[state.vessels[i].id] = &state.vessels[i];
+    quint64 hash = 14695981039346656037ULL;
+    for(int id=0;id<byId.size();id++) {
+        const VesselState *v = byId[id];
+        if(!v) continue;
+        double values[6] = { v->x, v->y, v->depth, v->heading, v->speed, v->runTime };
+        const unsigned char *bytes = (const unsigned char*) values;
+        for(unsigned int b=0;b<sizeof(values);b++)
+            hash = (hash ^ bytes[b]) * 1099511628211ULL;
+        hash = (hash ^ (quint64) v->id) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Runs ticks of a fresh simulation on threads, returns ms per tick
+static double runTicks(const QString &scenario, int threads, int ticks, quint64 &sum, int &survivors,
+                       Simulation::LodStats &lod) {
+    Simulation simulation;
+    simulation.setThreadCount(threads);
+    simulation.loadScenario(scenario);
+    int total = 0;
+    QTime time;
+    for(int t=0;t<TICK_WARMUP + ticks;t++) {
+        if(t == TICK_WARMUP)
+            time.start();
+        if(t % TICK_SALVO_INTERVAL == 0)
+            simulation.fireTorpedo((t / TICK_SALVO_INTERVAL) * 45 % 360, Torpedo::PassiveHoming);
+        total += TICK_DT * 1000;
+        simulation.step(TICK_DT, total, false);
+    }
+    double ms = (double) time.elapsed() / ticks;
+    SimulationState state;
+    simulation.saveState(state);
+    sum = checksum(state);
+    survivors = state.vessels.size();
+    lod = simulation.lodStats();
+    return ms;
+}
+
+/*
+ * Tick scaling: every vessel count against 1..maxthreads threads. The state
+ * checksum must be the same on every thread count.
+ *
+ *   vesikko-bench tick [vessels,...] [ticks] [maxthreads]
+ */
+int benchTick(const QStringList &args) {
+    QTextStream out(stdout);
+    QStringList countList = (args.size() > 0 ? args[0] : QString("1000,10000,100000")).split(",");
+    int ticks = args.size() > 1 ? qMax(1, args[1].toInt()) : 200;
+    int maxThreads = args.size() > 2 ? qMax(1, args[2].toInt()) : qMax(1, QThread::idealThreadCount());
+    bool deterministic = true;
+    foreach(QString countText, countList) {
+        int count = countText.toInt();
+        if(count <= 0) continue;
+        QVector<ScenarioRecord> records;
+        generateConvoys(count, records);
+        QTemporaryFile file;
+        if(!file.open() || !Scenario::writeBinary(file.fileName(), records.constData(), count)) {
+            out << "tick error=cannot-write-scenario\n";
+            return 1;
+        }
+        double base = 0;
+        quint64 baseSum = 0;
+        for(int threads=1;threads<=maxThreads;threads++) {
+            quint64 sum;
+            int survivors;
+            Simulation::LodStats lod;
+            double ms = runTicks(file.fileName(), threads, ticks, sum, survivors, lod);
+            qint64 vesselTicks = lod.fineTicks + lod.coarseSteps + lod.skippedTicks;
+            if(threads == 1) {
+                base = ms;
+                baseSum = sum;
+            }
+            bool same = sum == baseSum;
+            deterministic = deterministic && same;
+            out << "tick vessels=" << count << " threads=" << threads << " ticks=" << ticks
+                << " ms_per_tick=" << QString::number(ms, 'f', 3)
+                << " speedup=" << QString::number(ms > 0 ? base / ms : 0, 'f', 2)
+                << " survivors=" << survivors
+                << " fine=" << lod.fineTicks << " coarse=" << lod.coarseSteps
+                << " saved_pct=" << QString::number(vesselTicks ? 100.0 * lod.skippedTicks / vesselTicks : 0, 'f', 1)
+                << " checksum=" << QString::number(sum, 16)
+                << " deterministic=" << (same ? "yes" : "no") << "\n";
+            out.flush();
+        }
+    }
+    return deterministic ? 0 : 2;
+}
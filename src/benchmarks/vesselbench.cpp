@@ -0,0 +1,85 @@
+#include <QTextStream>
+#include <QVector>
+#include <stdlib.h>
+#include <math.h>
+#include "benchmarks.h"
+#include "benchstats.h"
+#include "../simulation/vessel.h"
+#include "../simulation/torpedo.h"
+#include "../simulation/contactgrid.h"
+
+#define VESSEL_DT 0.05
+// Torpedoes per ship in the torpedo measurement
+#define VESSEL_TORPEDO_RATIO 10
+
+// Ships moving and turning at random, spread as densely as convoys
+static void generateShips(int count, QVector<Vessel*> &ships) {
+    srand48(count);
+    double radius = 200 * sqrt((double) count);
+    for(int i=0;i<count;i++) {
+        Vessel *v = new Vessel(0, i + 1);
+        double a = drand48() * 2 * M_PI, d = sqrt(drand48()) * radius;
+        v->type = 1;
+        v->x = sin(a) * d;
+        v->y = cos(a) * d;
+        v->heading = drand48() * 360;
+        v->speed = v->speedCommand = 5 + 5 * drand48();
+        v->helm = drand48() * 2 - 1;
+        ships.append(v);
+    }
+}
+
+class VesselLoop : public BenchLoop
+{
+public:
+    VesselLoop(const QVector<Vessel*> &v) : vessels(v), total(0) {}
+    void run() {
+        total += VESSEL_DT * 1000;
+        for(int i=0;i<vessels.size();i++)
+            vessels[i]->tickTime(VESSEL_DT, total);
+    }
+    QVector<Vessel*> vessels;
+    int total;
+};
+
+/*
+ * Vessel::tickTime and Torpedo::tickTime on their own, per vessel. Homing
+ * torpedoes search a contact grid of the ships, one torpedo for every
+ * VESSEL_TORPEDO_RATIO ships.
+ *
+ *   vesikko-bench vessel [vessels,...]
+ */
+int benchVessel(const QStringList &args) {
+    QTextStream out(stdout);
+    QStringList countList = (args.size() > 0 ? args[0] : QString("1000,10000,100000")).split(",");
+    foreach(QString countText, countList) {
+        int count = countText.toInt();
+        if(count <= 0) continue;
+        QVector<Vessel*> ships;
+        generateShips(count, ships);
+        VesselLoop shipLoop(ships);
+        printStats(out, "vessel", "type=ship count=" + QString::number(count), shipLoop.measure(count));
+
+        ContactGrid grid;
+        grid.build(ships);
+        QVector<Vessel*> torpedoes;
+        int torpedoCount = qMax(1, count / VESSEL_TORPEDO_RATIO);
+        for(int i=0;i<torpedoCount;i++) {
+            const Vessel *ship = ships[i * VESSEL_TORPEDO_RATIO % count];
+            Torpedo *t = new Torpedo(0, count + i + 1);
+            t->x = ship->x + 1500;
+            t->y = ship->y;
+            t->heading = t->headingCommand = 270;
+            t->speed = TORPEDO_SPEED;
+            t->mode = Torpedo::PassiveHoming;
+            t->setContacts(&grid);
+            torpedoes.append(t);
+        }
+        VesselLoop torpedoLoop(torpedoes);
+        printStats(out, "vessel", "type=torpedo count=" + QString::number(torpedoCount) + " contacts=" + QString::number(count),
+                   torpedoLoop.measure(torpedoCount));
+        qDeleteAll(torpedoes);
+        qDeleteAll(ships);
+    }
+    return 0;
+}
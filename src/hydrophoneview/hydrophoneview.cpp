@@ -4,6 +4,7 @@
 #include <QDeclarativeItem>
 #include <QCoreApplication>
 #include "../simulation/vessel.h"
+#include "../profiling/profiler.h"
 
 HydrophoneView::HydrophoneView(QObject *parent) : QObject(parent), mainWin()
 {
@@ -28,6 +29,7 @@ HydrophoneView::HydrophoneView(QObject *parent) : QObject(parent), mainWin()
 }
 
 void HydrophoneView::vesselUpdated(Vessel* vessel) {
+    PROFILE_SCOPE("hydrophone.update");
     if(vessel->id==0) {
         QMetaObject::invokeMethod(hydrophoneViewObject, "subDirectionChanged",
                                   Q_ARG(QVariant, vessel->heading));
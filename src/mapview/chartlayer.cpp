@@ -0,0 +1,133 @@
+#include "chartlayer.h"
+#include "../profiling/profiler.h"
+#include <QPainter>
+#include <math.h>
+
+// Coarser levels looked at for a stand-in while a tile renders
+#define CHART_FALLBACK_LEVELS 3
+// Rows of tiles prefetched ahead of the view on the sub's heading
+#define CHART_PREFETCH_TILES 2
+
+// Index of the coarser tile, up levels up, that covers tile i
+static int coarser(int i, int up) {
+    return i >= 0 ? i >> up : -((-i - 1) >> up) - 1;
+}
+
+static void appendUnique(QVector<ChartTileId> &ids, const ChartTileId &id) {
+    quint64 key = id.key();
+    for(int i=0;i<ids.size();i++)
+        if(ids[i].key() == key) return;
+    ids.append(id);
+}
+
+ChartLayer::ChartLayer(QDeclarativeItem *parent) : QDeclarativeItem(parent),
+    pixelsPerMeter(0.01), headingDegrees(0)
+{
+    setFlag(QGraphicsItem::ItemHasNoContents, false);
+    connect(&tiles, SIGNAL(tileReady()), this, SLOT(tileReady()));
+}
+
+void ChartLayer::setSource(const QString &fileName) {
+    if(fileName == sourceFile) return;
+    sourceFile = fileName;
+    if(sourceFile.isEmpty())
+        tiles.close();
+    else
+        tiles.open(sourceFile);
+    emit sourceChanged();
+    update();
+}
+
+void ChartLayer::setCenterX(qreal x) {
+    if(x == center.x()) return;
+    center.setX(x);
+    update();
+}
+
+void ChartLayer::setCenterY(qreal y) {
+    if(y == center.y()) return;
+    center.setY(y);
+    update();
+}
+
+void ChartLayer::setScaling(qreal s) {
+    if(s == pixelsPerMeter) return;
+    pixelsPerMeter = s;
+    update();
+}
+
+void ChartLayer::setHeading(qreal h) {
+    headingDegrees = h;
+}
+
+void ChartLayer::tileReady() {
+    update();
+}
+
+int ChartLayer::level() const {
+    double metersPerPixel = 1 / pixelsPerMeter;
+    int z = (int) floor(log(metersPerPixel / CHART_BASE_RESOLUTION) / log(2.0) + 0.5);
+    return qBound(0, z, CHART_LEVELS - 1);
+}
+
+// Only looks tiles up, never waits for one: what isn't rendered yet is
+// requested and drawn when ChartTiles reports it ready
+void ChartLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) {
+    if(!tiles.isOpen() || pixelsPerMeter <= 0) return;
+    PROFILE_SCOPE("map.chart.paint");
+    int z = level();
+    double tileMeters = CHART_TILE_PIXELS * ChartTiles::metersPerPixel(z);
+    double halfWidth = width() / 2 / pixelsPerMeter, halfHeight = height() / 2 / pixelsPerMeter;
+    int left = (int) floor((center.x() - halfWidth) / tileMeters);
+    int right = (int) floor((center.x() + halfWidth) / tileMeters);
+    int top = (int) floor((center.y() - halfHeight) / tileMeters);
+    int bottom = (int) floor((center.y() + halfHeight) / tileMeters);
+    visible.resize(0);
+    for(int ty=top;ty<=bottom;ty++) {
+        // Edges rounded to whole pixels so neighbouring tiles meet
+        int y0 = qRound((ty * tileMeters - center.y()) * pixelsPerMeter + height() / 2);
+        int y1 = qRound(((ty + 1) * tileMeters - center.y()) * pixelsPerMeter + height() / 2);
+        for(int tx=left;tx<=right;tx++) {
+            int x0 = qRound((tx * tileMeters - center.x()) * pixelsPerMeter + width() / 2);
+            int x1 = qRound(((tx + 1) * tileMeters - center.x()) * pixelsPerMeter + width() / 2);
+            ChartTileId id = { z, tx, ty };
+            if(!drawTile(painter, id, QRectF(x0, y0, x1 - x0, y1 - y0)))
+                visible.append(id);
+        }
+    }
+    addPrefetch(z, tileMeters);
+    tiles.request(visible, prefetch);
+}
+
+bool ChartLayer::drawTile(QPainter *painter, const ChartTileId &id, const QRectF &target) {
+    QImage image;
+    for(int up=0;up<=CHART_FALLBACK_LEVELS && id.level + up < CHART_LEVELS;up++) {
+        ChartTileId cover = { id.level + up, coarser(id.x, up), coarser(id.y, up) };
+        if(!tiles.tile(cover, image)) continue;
+        int part = CHART_TILE_PIXELS >> up;
+        QRectF source((id.x - cover.x * (1 << up)) * part, (id.y - cover.y * (1 << up)) * part, part, part);
+        painter->drawImage(target, image, source);
+        return up == 0;
+    }
+    return false;
+}
+
+// The map follows the sub, so what comes into view next lies on its
+// heading: a band of tiles just past the corners of the view
+void ChartLayer::addPrefetch(int z, double tileMeters) {
+    prefetch.resize(0);
+    double h = headingDegrees * (M_PI / 180.0);
+    double dx = sin(h), dy = -cos(h);
+    double edge = sqrt(width() * width() + height() * height()) / 2 / pixelsPerMeter;
+    for(int i=1;i<=CHART_PREFETCH_TILES;i++) {
+        double d = edge + (i - 0.5) * tileMeters;
+        int tx = (int) floor((center.x() + dx * d) / tileMeters);
+        int ty = (int) floor((center.y() + dy * d) / tileMeters);
+        for(int oy=-1;oy<=1;oy++) {
+            for(int ox=-1;ox<=1;ox++) {
+                ChartTileId id = { z, tx + ox, ty + oy };
+                appendUnique(prefetch, id);
+            }
+        }
+    }
+}
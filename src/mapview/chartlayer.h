@@ -0,0 +1,58 @@
+#ifndef CHARTLAYER_H
+#define CHARTLAYER_H
+
+#include <QDeclarativeItem>
+#include "charttiles.h"
+
+/*
+ * The nautical chart under the map, a QML item (ChartLayer in the Vesikko
+ * module). The map's center and scale are bound to it; it draws whatever
+ * tiles are rendered, filling gaps with the nearest coarser tile scaled
+ * up, and asks ChartTiles for the missing ones and for tiles ahead of the
+ * sub on its heading. Without a source it draws nothing.
+ */
+class ChartLayer : public QDeclarativeItem
+{
+    Q_OBJECT
+    // Bathymetry file the chart is drawn from
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+    // World position at the item's center, pixels per meter, and the
+    // sub's heading in degrees
+    Q_PROPERTY(qreal centerX READ centerX WRITE setCenterX)
+    Q_PROPERTY(qreal centerY READ centerY WRITE setCenterY)
+    Q_PROPERTY(qreal scaling READ scaling WRITE setScaling)
+    Q_PROPERTY(qreal heading READ heading WRITE setHeading)
+public:
+    explicit ChartLayer(QDeclarativeItem *parent = 0);
+    QString source() const { return sourceFile; }
+    void setSource(const QString &fileName);
+    qreal centerX() const { return center.x(); }
+    void setCenterX(qreal x);
+    qreal centerY() const { return center.y(); }
+    void setCenterY(qreal y);
+    qreal scaling() const { return pixelsPerMeter; }
+    void setScaling(qreal s);
+    qreal heading() const { return headingDegrees; }
+    void setHeading(qreal h);
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+signals:
+    void sourceChanged();
+private slots:
+    void tileReady();
+private:
+    // The chart level closest to the scale
+    int level() const;
+    // Draws a tile or the part of a coarser one covering it; false if the
+    // tile itself isn't rendered yet
+    bool drawTile(QPainter *painter, const ChartTileId &id, const QRectF &target);
+    void addPrefetch(int level, double tileMeters);
+
+    ChartTiles tiles;
+    QString sourceFile;
+    QPointF center;
+    qreal pixelsPerMeter, headingDegrees;
+    // paint() scratch
+    QVector<ChartTileId> visible, prefetch;
+};
+
+#endif // CHARTLAYER_H
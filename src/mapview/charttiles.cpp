@@ -0,0 +1,139 @@
+#include "charttiles.h"
+#include "../profiling/profiler.h"
+#include <QDebug>
+#include <math.h>
+
+#define CHART_IDLE (~(quint64) 0)
+
+// Depth band limits in meters; band 0 is land
+static const float bandLimits[] = { 0, 10, 20, 50, 100 };
+#define CHART_BANDS 6
+static const QRgb bandColors[CHART_BANDS] = {
+    qRgb(232, 216, 168), qRgb(168, 216, 240), qRgb(144, 200, 232),
+    qRgb(120, 180, 220), qRgb(96, 156, 204), qRgb(70, 130, 180)
+};
+// Contours between water bands, each band's color darkened
+static const QRgb contourColors[CHART_BANDS] = {
+    qRgb(178, 166, 129), qRgb(129, 166, 184), qRgb(110, 153, 178),
+    qRgb(92, 138, 169), qRgb(73, 120, 156), qRgb(53, 100, 138)
+};
+static const QRgb coastColor = qRgb(48, 48, 48);
+
+static int band(float depth) {
+    int b = 0;
+    while(b < CHART_BANDS - 1 && depth >= bandLimits[b])
+        b++;
+    return b;
+}
+
+ChartTiles::ChartTiles(QObject *parent) : QThread(parent),
+    cache(CHART_CACHE_BYTES), rendering(CHART_IDLE), stopping(false)
+{
+}
+
+ChartTiles::~ChartTiles() {
+    close();
+}
+
+bool ChartTiles::open(const QString &fileName) {
+    close();
+    if(!bathymetry.open(fileName)) {
+        qWarning() << "Can't load chart" << fileName << bathymetry.errorString();
+        return false;
+    }
+    stopping = false;
+    start(QThread::LowPriority);
+    return true;
+}
+
+void ChartTiles::close() {
+    if(isRunning()) {
+        mutex.lock();
+        stopping = true;
+        requested.wakeOne();
+        mutex.unlock();
+        wait();
+    }
+    QMutexLocker locker(&mutex);
+    cache.clear();
+    queue.clear();
+    bathymetry.close();
+}
+
+bool ChartTiles::tile(const ChartTileId &id, QImage &image) {
+    QMutexLocker locker(&mutex);
+    QImage *cached = cache.object(id.key());
+    if(!cached) return false;
+    image = *cached;
+    return true;
+}
+
+void ChartTiles::request(const QVector<ChartTileId> &visible, const QVector<ChartTileId> &prefetch) {
+    QMutexLocker locker(&mutex);
+    queue.resize(0);
+    for(int i=0;i<visible.size() + prefetch.size();i++) {
+        const ChartTileId &id = i < visible.size() ? visible[i] : prefetch[i - visible.size()];
+        quint64 key = id.key();
+        if(key != rendering && !cache.contains(key))
+            queue.append(id);
+    }
+    if(!queue.isEmpty())
+        requested.wakeOne();
+}
+
+void ChartTiles::run() {
+    forever {
+        mutex.lock();
+        while(queue.isEmpty() && !stopping)
+            requested.wait(&mutex);
+        if(stopping) {
+            mutex.unlock();
+            break;
+        }
+        ChartTileId id = queue.first();
+        queue.remove(0);
+        rendering = id.key();
+        mutex.unlock();
+
+        QImage *image = new QImage(render(id));
+
+        mutex.lock();
+        cache.insert(id.key(), image, image->byteCount());
+        rendering = CHART_IDLE;
+        mutex.unlock();
+        emit tileReady();
+    }
+}
+
+// Samples the depth at every pixel corner from the bathymetry level closest
+// to the tile's resolution, fills the pixels by depth band and outlines
+// where the band changes: the coastline dark, contours a shade darker than
+// the band. Rows are by increasing y, like the map.
+QImage ChartTiles::render(const ChartTileId &id) {
+    PROFILE_SCOPE("map.chart.render");
+    int size = CHART_TILE_PIXELS, stride = size + 1;
+    double mpp = metersPerPixel(id.level);
+    double x0 = id.x * size * mpp, y0 = id.y * size * mpp;
+    int level = 0;
+    while(level + 1 < bathymetry.levels() && bathymetry.cellSize(level + 1) <= mpp)
+        level++;
+    bands.resize(stride * stride);
+    for(int j=0;j<stride;j++)
+        for(int i=0;i<stride;i++)
+            bands[j * stride + i] = band(bathymetry.depthAt(x0 + i * mpp, y0 + j * mpp, level));
+    QImage image(size, size, QImage::Format_RGB32);
+    for(int j=0;j<size;j++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(j));
+        const char *b = bands.constData() + j * stride;
+        for(int i=0;i<size;i++) {
+            int here = b[i], right = b[i + 1], below = b[i + stride];
+            if(here == right && here == below)
+                line[i] = bandColors[here];
+            else if(!here || !right || !below)
+                line[i] = coastColor;
+            else
+                line[i] = contourColors[here];
+        }
+    }
+    return image;
+}
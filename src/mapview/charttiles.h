@@ -0,0 +1,70 @@
+#ifndef CHARTTILES_H
+#define CHARTTILES_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QCache>
+#include <QImage>
+#include <QVector>
+#include "../simulation/bathymetry.h"
+
+// Chart tiles are square images of this many pixels. Level n has
+// CHART_BASE_RESOLUTION * 2^n meters per pixel.
+#define CHART_TILE_PIXELS 256
+#define CHART_BASE_RESOLUTION 6.25
+#define CHART_LEVELS 8
+// Bytes of rendered tiles kept; the least recently drawn go first
+#define CHART_CACHE_BYTES (48 * 1024 * 1024)
+
+struct ChartTileId
+{
+    int level, x, y;
+    quint64 key() const {
+        return ((quint64) level << 56) | ((quint64) (x & 0xfffffff) << 28) | (quint64) (y & 0xfffffff);
+    }
+};
+
+/*
+ * Renders nautical chart tiles from a bathymetry file's tile pyramid on a
+ * worker thread: depth bands, depth contours and the coastline. Rendered
+ * tiles are kept in an LRU cache within CHART_CACHE_BYTES.
+ *
+ * The GUI thread only looks tiles up and hands over the tiles it wants;
+ * it never waits for a tile to be rendered. Each request replaces the
+ * previous one, so tiles panned or zoomed away from are never rendered.
+ */
+class ChartTiles : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ChartTiles(QObject *parent = 0);
+    ~ChartTiles();
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return isRunning(); }
+    // The tile if it is rendered
+    bool tile(const ChartTileId &id, QImage &image);
+    // Tiles to render, in order: the visible ones, then the prefetched
+    void request(const QVector<ChartTileId> &visible, const QVector<ChartTileId> &prefetch);
+    static double metersPerPixel(int level) { return CHART_BASE_RESOLUTION * (1 << level); }
+signals:
+    // Emitted from the worker thread
+    void tileReady();
+protected:
+    void run();
+private:
+    QImage render(const ChartTileId &id);
+
+    Bathymetry bathymetry;
+    QMutex mutex;
+    QWaitCondition requested;
+    QCache<quint64, QImage> cache;
+    QVector<ChartTileId> queue;
+    quint64 rendering;
+    bool stopping;
+    // render() scratch, worker thread only
+    QVector<char> bands;
+};
+
+#endif // CHARTTILES_H
@@ -1,10 +1,12 @@
 #include "mapqmlupdater.h"
 #include "../simulation/vessel.h"
+#include "../profiling/profiler.h"
 #include <QVariant>
+#include <QSet>
 #include <QDebug>
 
 MapQmlUpdater::MapQmlUpdater(QObject *parent) :
-    QObject(parent)
+    QObject(parent), showTruth(true)
 {
 }
 
@@ -14,13 +16,23 @@ void MapQmlUpdater::init(QObject *s, QObject *h, QObject *v) {
     vesselsObject = v;
 }
 
+void MapQmlUpdater::setShowTruth(bool show) {
+    showTruth = show;
+    vesselsObject->setProperty("showShips", show);
+}
+
+QObject *MapQmlUpdater::findVessel(int id) {
+    return vesselsObject->findChild<QObject*>("vessel-" + QString::number(id));
+}
+
 void MapQmlUpdater::vesselUpdated(Vessel *vessel) {
+    PROFILE_SCOPE("map.update");
+    if(!showTruth && vessel->type == 1) return;
     QObject *vesselObject = 0;
     if(vessel->id==0) {
         vesselObject = subObject;
     } else {
-        QString objectname = "vessel-" + QString::number(vessel->id);
-        vesselObject = vesselsObject->findChild<QObject*>(objectname);
+        vesselObject = findVessel(vessel->id);
     }
     Q_ASSERT(vesselObject);
     vesselObject->setProperty("lat", vessel->x);
@@ -39,7 +51,57 @@ void MapQmlUpdater::createVessel(Vessel *sub) {
                               Q_ARG(QVariant, sub->type));
 }
 
-void MapQmlUpdater::vesselDeleted(Vessel *sub) {
-    qDebug() << Q_FUNC_INFO;
-    QMetaObject::invokeMethod(vesselsObject, "deleteVessel", Q_ARG(QVariant, sub->id));
+void MapQmlUpdater::createVessels(const QVector<Vessel*> &vessels) {
+    qDebug() << Q_FUNC_INFO << vessels.size();
+    QVariantList ids, lats, lons, types;
+    foreach(Vessel *v, vessels) {
+        ids.append(v->id);
+        lats.append(v->x);
+        lons.append(v->y);
+        types.append(v->type);
+    }
+    QMetaObject::invokeMethod(vesselsObject, "createVessels",
+                              Q_ARG(QVariant, QVariant(ids)),
+                              Q_ARG(QVariant, QVariant(lats)),
+                              Q_ARG(QVariant, QVariant(lons)),
+                              Q_ARG(QVariant, QVariant(types)));
+}
+
+// One pass over the map items instead of broadcasting each deleted id to
+// every vessel item
+void MapQmlUpdater::vesselsDeleted(const QVector<Vessel*> &vessels) {
+    qDebug() << Q_FUNC_INFO << vessels.size();
+    QSet<int> ids;
+    foreach(Vessel *v, vessels)
+        ids.insert(v->id);
+    foreach(QObject *child, vesselsObject->children()) {
+        QVariant id = child->property("vesselId");
+        if(id.isValid() && ids.contains(id.toInt())) {
+            child->setProperty("visible", false);
+            child->deleteLater();
+        }
+    }
+}
+
+void MapQmlUpdater::tracksUpdated(const QVector<TrackEstimate> &tracks) {
+    PROFILE_SCOPE("map.tracks");
+    if(showTruth) return;
+    foreach(const TrackEstimate &track, tracks) {
+        QObject *vesselObject = findVessel(track.contact);
+        // Sunk since the detection
+        if(!vesselObject) continue;
+        vesselObject->setProperty("lat", track.x);
+        vesselObject->setProperty("lon", track.y);
+        vesselObject->setProperty("rotation", track.course);
+        vesselObject->setProperty("speed", track.speed);
+        vesselObject->setProperty("positionError", track.positionError);
+        vesselObject->setProperty("visible", true);
+    }
+}
+
+void MapQmlUpdater::trackLost(int contact) {
+    if(showTruth) return;
+    QObject *vesselObject = findVessel(contact);
+    if(vesselObject)
+        vesselObject->setProperty("visible", false);
 }
@@ -1,7 +1,9 @@
 #ifndef MAPQMLUPDATER_H
 #define MAPQMLUPDATER_H
 #include "../simulation/vessel.h"
+#include "../simulation/tmasolver.h"
 #include <QObject>
+#include <QVector>
 
 class MapQmlUpdater : public QObject
 {
@@ -9,14 +11,22 @@ class MapQmlUpdater : public QObject
 public:
     explicit MapQmlUpdater(QObject *parent);
     void init(QObject *s, QObject *h, QObject *v);
+    // Without the truth ships are drawn where the contact tracker puts
+    // them, once tracked
+    void setShowTruth(bool show);
 signals:
 
 public slots:
     void vesselUpdated(Vessel *v);
     void createVessel(Vessel *v);
-    void vesselDeleted(Vessel *v);
+    void createVessels(const QVector<Vessel*> &vessels);
+    void vesselsDeleted(const QVector<Vessel*> &vessels);
+    void tracksUpdated(const QVector<TrackEstimate> &tracks);
+    void trackLost(int contact);
 private:
+    QObject *findVessel(int id);
     QObject *subObject, *helmObject, *vesselsObject;
+    bool showTruth;
 };
 
 #endif // MAPQMLUPDATER_H
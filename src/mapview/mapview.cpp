@@ -2,10 +2,16 @@
 #include <QGraphicsObject>
 #include <QDeclarativeItem>
 #include <QCoreApplication>
+#include <QShortcut>
+#include <QDateTime>
+#include <qdeclarative.h>
 #include "mapview.h"
 #include "qmlapplicationviewer.h"
+#include "chartlayer.h"
+#include "../profiling/profiler.h"
 
-MapView::MapView(QObject *parent) : QObject(parent), mainWin(), mqu(this) {
+MapView::MapView(QObject *parent) : QObject(parent), mainWin(), mqu(this), profilerOverlay(0) {
+    registerTypes();
     view = new QDeclarativeView(&mainWin);
     view->setSource(QUrl::fromLocalFile("src/mapview/qml/vesikko/main.qml"));
     view->setResizeMode(QDeclarativeView::SizeRootObjectToView);
@@ -34,5 +40,52 @@ MapView::MapView(QObject *parent) : QObject(parent), mainWin(), mqu(this) {
 
     mqu.init(sub, helm, object);
 
+    // F11 shows frame/tick timings, F12 dumps them as a Chrome trace
+    profilerOverlay = item->findChild<QObject*>("profilerOverlay");
+    connect(new QShortcut(QKeySequence(Qt::Key_F11), &mainWin), SIGNAL(activated()), this, SLOT(toggleProfilerOverlay()));
+    connect(new QShortcut(QKeySequence(Qt::Key_F12), &mainWin), SIGNAL(activated()), this, SLOT(dumpProfilerTrace()));
+    // F9 rewinds the simulation to the previous snapshot
+    connect(new QShortcut(QKeySequence(Qt::Key_F9), &mainWin), SIGNAL(activated()), this, SIGNAL(rewind()));
+    connect(&profilerOverlayTimer, SIGNAL(timeout()), this, SLOT(updateProfilerOverlay()));
+    profilerOverlayTimer.setInterval(1000);
+
     connect(&mainWin, SIGNAL(destroyed()), QCoreApplication::instance(), SLOT(quit()));
 }
+
+void MapView::registerTypes() {
+    static bool registered = false;
+    if(registered) return;
+    registered = true;
+    qmlRegisterType<ChartLayer>("Vesikko", 1, 0, "ChartLayer");
+}
+
+void MapView::setChart(const QString &fileName) {
+    QGraphicsObject *object = view->rootObject();
+    QObject *chart = object ? object->findChild<QObject*>("chart") : 0;
+    if(!chart) {
+        qDebug() << "No chart object - QML missing?";
+        return;
+    }
+    chart->setProperty("source", fileName);
+}
+
+void MapView::toggleProfilerOverlay() {
+    if(!profilerOverlay) return;
+    bool visible = !profilerOverlay->property("visible").toBool();
+    profilerOverlay->setProperty("visible", visible);
+    if(visible) {
+        updateProfilerOverlay();
+        profilerOverlayTimer.start();
+    } else {
+        profilerOverlayTimer.stop();
+    }
+}
+
+void MapView::updateProfilerOverlay() {
+    profilerOverlay->setProperty("text", Profiler::instance()->summary());
+}
+
+void MapView::dumpProfilerTrace() {
+    QString fileName = "vesikko-trace-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".json";
+    Profiler::instance()->writeChromeTrace(fileName);
+}
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QDeclarativeView>
 #include <QMainWindow>
+#include <QTimer>
 
 #include "mapqmlupdater.h"
 
@@ -13,16 +14,27 @@ class MapView : public QObject
 public:
     explicit MapView(QObject *parent = 0);
     MapQmlUpdater mqu;
+    // Draws a nautical chart from a bathymetry file under the map
+    void setChart(const QString &fileName);
+    // The map QML's own item types, needed before loading main.qml
+    static void registerTypes();
 
 signals:
     void setHelm(int);
     void setSpeed(int);
     void setDepthChange(int);
+    void rewind();
 
 public slots:
+private slots:
+    void toggleProfilerOverlay();
+    void updateProfilerOverlay();
+    void dumpProfilerTrace();
 private:
     QDeclarativeView *view;
     QMainWindow mainWin;
+    QObject *profilerOverlay;
+    QTimer profilerOverlayTimer;
 };
 
 #endif // MAPVIEW_H
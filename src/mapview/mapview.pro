@@ -9,13 +9,17 @@ QML_IMPORT_PATH =
 
 # The .cpp file which was generated for your project. Feel free to hack it.
 SOURCES += mapqmlupdater.cpp \
-    mapview.cpp
+    mapview.cpp \
+    charttiles.cpp \
+    chartlayer.cpp
 
 # Please do not modify the following two lines. Required for deployment.
 include(qmlapplicationviewer/qmlapplicationviewer.pri)
 qtcAddDeployment()
 
 HEADERS += mapqmlupdater.h \
-    mapview.h
+    mapview.h \
+    charttiles.h \
+    chartlayer.h
 
 OTHER_FILES += qml/vesikko/*
@@ -4,19 +4,27 @@ var vessel
 function createVessel(id, lat, lon, type) {
     console.log("CreateVessel " + id + " " + lat + "/" + lon + " type " + type );
     component = Qt.createComponent("Vessel.qml");
+    addVessel(id, lat, lon, type)
+}
+
+// Bulk version used when the simulation is restored
+function createVessels(ids, lats, lons, types) {
+    console.log("CreateVessels " + ids.length);
+    component = Qt.createComponent("Vessel.qml");
+    for(var i=0;i<ids.length;i++)
+        addVessel(ids[i], lats[i], lons[i], types[i])
+}
+
+function addVessel(id, lat, lon, type) {
     vessel = component.createObject(map);
     vessel.lat = lat;
     vessel.lon = lon;
     vessel.objectName = "vessel-" + id
     vessel.vesselId = id
-    if(type==1)
+    if(type==1) {
         vessel.source = "ship.png"
+        vessel.visible = map.showShips
+    }
     if(type==2)
         vessel.source = "torpedo.png"
-    map.deleteVesselSignal.connect(vessel.deleteVesselSignal)
-}
-
-function deleteVessel(id) {
-    console.log("DeleteVessel " + id);
-    map.deleteVesselSignal(id)
 }
@@ -1,7 +1,6 @@
 import QtQuick 1.0
 
 Image {
-    signal deleteVesselSignal(int id)
     source: "sub.png"
     smooth: true
     z: 10
@@ -15,10 +14,16 @@ Image {
     property real depth: 0
     property real speed: 0
     property int vesselId: -1
-    onDeleteVesselSignal: {
-        if(id == vesselId) {
-            visible = false;
-            destroy()
-        }
+    // Of a tracked contact's solution, in meters
+    property real positionError: 0
+    Rectangle {
+        visible: positionError > 0
+        anchors.centerIn: parent
+        width: 2 * positionError * zoomcontrol.scaling / parent.scale
+        height: width
+        radius: width / 2
+        color: "transparent"
+        border.color: "white"
+        opacity: 0.5
     }
 }
@@ -1,4 +1,5 @@
 import QtQuick 1.0
+import Vesikko 1.0
 import "ComponentCreation.js" as ComponentCreation
 
 Rectangle {
@@ -9,14 +10,14 @@ Rectangle {
     property int gridCount: 40
     property real mapCenterLat: sub.lat
     property real mapCenterLon: sub.lon
-
-    signal deleteVesselSignal(int id)
+    // Ships stay hidden until the contact tracker places them
+    property bool showShips: true
 
     function createVessel(id, lat, lon, type) {
         ComponentCreation.createVessel(id, lat, lon, type)
     }
-    function deleteVessel(id) {
-        ComponentCreation.deleteVessel(id)
+    function createVessels(ids, lats, lons, types) {
+        ComponentCreation.createVessels(ids, lats, lons, types)
     }
     function transformToMapX(lat) {
         return (lat - mapCenterLat) * zoomcontrol.scaling + map.width/2
@@ -51,6 +52,18 @@ Rectangle {
         }
     }
 
+    Text {
+        z:100
+        objectName: "profilerOverlay"
+        visible: false
+        anchors.top: parent.top
+        anchors.right: parent.right
+        color: "white"
+        font.family: "monospace"
+        font.pixelSize: 10
+        text: ""
+    }
+
     Text {
         z:100
         id: statusText
@@ -63,6 +76,18 @@ Rectangle {
         objectName: "sub"
     }
 
+    // Nautical chart over the plain background, once MapView::setChart()
+    // gives it a bathymetry file
+    ChartLayer {
+        objectName: "chart"
+        anchors.fill: parent
+        z: 0
+        centerX: mapCenterLat
+        centerY: mapCenterLon
+        scaling: zoomcontrol.scaling
+        heading: sub.rotation
+    }
+
     Grid {
         function positionGridX() {
             return transformToMapX(xPos - gridsize * gridCount/2)
@@ -17,6 +17,8 @@
 
 #include "SkyDome.h"
 #include <osgOcean/ShaderManager>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 
 SkyDome::SkyDome( void )
 {
@@ -59,6 +61,15 @@ void SkyDome::setupStateSet( osg::TextureCubeMap* cubemap )
 
 osg::ref_ptr<osg::Program> SkyDome::createShader(void)
 {
+    // Every dome uses the same program, so compile and link it only once.
+    static osg::ref_ptr<osg::Program> s_program;
+    static OpenThreads::Mutex s_programMutex;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_programMutex);
+
+    if (s_program.valid())
+        return s_program;
+
     osg::ref_ptr<osg::Program> program = new osg::Program;
 
     // Do not use shaders if they were globally disabled.
@@ -87,6 +98,7 @@ osg::ref_ptr<osg::Program> SkyDome::createShader(void)
         program->setName( "sky_dome_shader" );
         program->addShader(new osg::Shader(osg::Shader::VERTEX,   vertexSource));
         program->addShader(new osg::Shader(osg::Shader::FRAGMENT, fragmentSource));
+        s_program = program;
     }
 
     return program;
@@ -16,6 +16,37 @@
 */
 
 #include "SphereSegment.h"
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <map>
+#include <vector>
+#include <math.h>
+
+namespace
+{
+    struct SegmentKey
+    {
+        float radius;
+        unsigned int longitudeSteps, lattitudeSteps;
+        float longStart, longEnd, latStart, latEnd;
+
+        bool operator<( const SegmentKey& rhs ) const
+        {
+            if( radius != rhs.radius ) return radius < rhs.radius;
+            if( longitudeSteps != rhs.longitudeSteps ) return longitudeSteps < rhs.longitudeSteps;
+            if( lattitudeSteps != rhs.lattitudeSteps ) return lattitudeSteps < rhs.lattitudeSteps;
+            if( longStart != rhs.longStart ) return longStart < rhs.longStart;
+            if( longEnd != rhs.longEnd ) return longEnd < rhs.longEnd;
+            if( latStart != rhs.latStart ) return latStart < rhs.latStart;
+            return latEnd < rhs.latEnd;
+        }
+    };
+
+    typedef std::map< SegmentKey, osg::ref_ptr<osg::Geometry> > GeometryCache;
+
+    OpenThreads::Mutex s_cacheMutex;
+    GeometryCache s_geometryCache;
+}
 
 SphereSegment::SphereSegment(void)
 {}
@@ -53,68 +84,111 @@ void SphereSegment::compute( float radius,
 {
     removeDrawables(0,getNumDrawables());
 
-    osg::Vec3Array* vertices = new osg::Vec3Array();
-    osg::Vec2Array* texcoords = new osg::Vec2Array();
-
-    double x, y, z, t, p, sin_t, cos_t;
+    SegmentKey key;
+    key.radius = radius;
+    key.longitudeSteps = longitudeSteps;
+    key.lattitudeSteps = lattitudeSteps;
+    key.longStart = longStart;
+    key.longEnd = longEnd;
+    key.latStart = latStart;
+    key.latEnd = latEnd;
 
-    double longInc = (longEnd - longStart) / (double)longitudeSteps;
-    double latInc  = (latEnd  - latStart ) / (double)lattitudeSteps;
+    osg::ref_ptr<osg::Geometry> geom;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_cacheMutex);
+        osg::ref_ptr<osg::Geometry>& cached = s_geometryCache[key];
+        if( !cached.valid() )
+            cached = createGeometry(radius,longitudeSteps,lattitudeSteps,longStart,longEnd,latStart,latEnd);
+        geom = cached;
+    }
 
-    double theta = longStart, phi = latStart;
+    addDrawable( geom.get() );
+}
 
-    float uScale = 1.f / longitudeSteps;
-    float vScale = 1.f / lattitudeSteps;
+osg::Geometry* SphereSegment::createGeometry( float radius, 
+                                      unsigned int longitudeSteps, 
+                                      unsigned int lattitudeSteps,
+                                      float longStart,
+                                      float longEnd,
+                                      float latStart,
+                                      float latEnd )
+{
+    const unsigned int rowLen = lattitudeSteps + 1;
+    const unsigned int numVertices = (longitudeSteps + 1) * rowLen;
 
-    for( unsigned int i = 0; i <= longitudeSteps; ++i)
-    {
-        t = osg::DegreesToRadians( theta );
-        sin_t = sin(t);
-        cos_t = cos(t);
+    osg::Vec3Array* vertices = new osg::Vec3Array( numVertices );
+    osg::Vec2Array* texcoords = new osg::Vec2Array( numVertices );
 
-        for( unsigned int j = 0; j <= lattitudeSteps; ++j)
-        {        
-            p = osg::DegreesToRadians( phi );
+    const float longInc = (longEnd - longStart) / (float)longitudeSteps;
+    const float latInc  = (latEnd  - latStart ) / (float)lattitudeSteps;
 
-            x = radius * sin_t * cos(p);
-            y = radius * sin_t * sin(p);
-            z = radius * cos_t;
+    const float uScale = 1.f / longitudeSteps;
+    const float vScale = 1.f / lattitudeSteps;
 
-            vertices->push_back( osg::Vec3( x, y, z ) );
-            texcoords->push_back( osg::Vec2( j*vScale, i*uScale ) );
+    // phi only depends on the column, so its sin/cos are shared by every row
+    std::vector<float> sinP( rowLen ), cosP( rowLen );
+    for( unsigned int j = 0; j < rowLen; ++j )
+    {
+        const float p = osg::DegreesToRadians( latStart + j * latInc );
+        sinP[j] = sinf( p );
+        cosP[j] = cosf( p );
+    }
 
-            phi += latInc;
+    unsigned int v = 0;
+    for( unsigned int i = 0; i <= longitudeSteps; ++i )
+    {
+        const float t = osg::DegreesToRadians( longStart - i * longInc );
+        const float rSinT = radius * sinf( t );
+        const float z = radius * cosf( t );
+
+        for( unsigned int j = 0; j < rowLen; ++j, ++v )
+        {
+            (*vertices)[v].set( rSinT * cosP[j], rSinT * sinP[j], z );
+            (*texcoords)[v].set( j * vScale, i * uScale );
         }
-
-        theta -= longInc;
-        phi = latStart;
     }
 
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+    // One strip for the whole segment: every row is (r,c),(r+1,c) pairs and
+    // consecutive rows are stitched by repeating the last index of one row and
+    // the first of the next. Each row has an even index count so the winding
+    // stays the same across the joins.
+    const unsigned int numIndices = longitudeSteps * 2 * rowLen + (longitudeSteps - 1) * 2;
 
-    for(unsigned int r = 0; r <= longitudeSteps-1; r += 1)
-    {
-        osg::DrawElementsUInt* indices = 
-            new osg::DrawElementsUInt( osg::PrimitiveSet::TRIANGLE_STRIP, 0 );
+    osg::DrawElements* indices;
+    if( numVertices <= 0x10000 )
+        indices = new osg::DrawElementsUShort( osg::PrimitiveSet::TRIANGLE_STRIP );
+    else
+        indices = new osg::DrawElementsUInt( osg::PrimitiveSet::TRIANGLE_STRIP );
+    indices->reserveElements( numIndices );
 
-        for(unsigned int c = 0; c <= lattitudeSteps; c += 1 )
-        {    
-            indices->push_back( idx( r,    c,  lattitudeSteps+1 ) );
-            indices->push_back( idx( r+1,    c,  lattitudeSteps+1 ) );
+    for( unsigned int r = 0; r < longitudeSteps; ++r )
+    {
+        if( r > 0 )
+        {
+            indices->addElement( idx( r, lattitudeSteps, rowLen ) );
+            indices->addElement( idx( r, 0, rowLen ) );
+        }
+        for( unsigned int c = 0; c < rowLen; ++c )
+        {
+            indices->addElement( idx( r,   c, rowLen ) );
+            indices->addElement( idx( r+1, c, rowLen ) );
         }
-
-        geom->addPrimitiveSet( indices );
     }
 
     osg::Vec4Array* colors = new osg::Vec4Array();
     colors->push_back( osg::Vec4( 1.f, 1.f, 1.f, 1.f ) );
 
+    osg::Geometry* geom = new osg::Geometry();
+    geom->setDataVariance( osg::Object::STATIC );
+    geom->setUseDisplayList( false );
+    geom->setUseVertexBufferObjects( true );
     geom->setVertexArray( vertices );
     geom->setTexCoordArray( 0, texcoords );
     geom->setColorArray( colors );
     geom->setColorBinding( osg::Geometry::BIND_OVERALL );
+    geom->addPrimitiveSet( indices );
 
-    addDrawable( geom.get() );
+    return geom;
 }
 
 osg::Vec2 SphereSegment::sphereMap( osg::Vec3& vertex, float radius)
@@ -40,6 +40,7 @@ protected:
 public:
 	// 0 >= longStart/longEnd <= 180
 	// 0 >= latStart/latEnd <= 360
+	// Geometry is shared between all segments with the same parameters.
 	void compute( float radius, 
 					  unsigned int longitudeSteps, 
 					  unsigned int lattitudeSteps,
@@ -47,10 +48,21 @@ public:
 					  float longEnd,
 					  float latStart,
 					  float latEnd	);
+
+	// Builds the segment as a single indexed triangle strip, rows joined
+	// with degenerate triangles. Always allocates a new geometry.
+	static osg::Geometry* createGeometry( float radius, 
+					  unsigned int longitudeSteps, 
+					  unsigned int lattitudeSteps,
+					  float longStart,
+					  float longEnd,
+					  float latStart,
+					  float latEnd	);
+
 private:
 	osg::Vec2 sphereMap( osg::Vec3& vertex, float radius);
 
-	inline unsigned int idx(unsigned int r, unsigned int c, unsigned int row_len)
+	static inline unsigned int idx(unsigned int r, unsigned int c, unsigned int row_len)
 	{
 		return c + r * row_len;
 	}
@@ -19,6 +19,7 @@ private:
     osg::ref_ptr< osg::Camera > _camera;
     osg::ref_ptr< osgText::Text > _headingText;
     osg::ref_ptr< osgText::Text > _distanceText;
+    osg::ref_ptr< osgText::Text > _statusText;
     int oldHeading, oldDistance;
 public:
     TextHUD( QObject *parent ) : QObject(parent) {
@@ -64,6 +65,15 @@ public:
         _headingText->setAlignment(osgText::TextBase::CENTER_CENTER);
         textGeode->addDrawable( _distanceText.get() );
 
+        _statusText = new osgText::Text;
+        _statusText->setFont("/usr/share/fonts/truetype/freefont/FreeSans.ttf");
+        _statusText->setCharacterSize(60);
+        _statusText->setPosition( osg::Vec3f(512.f, 384.f, 0.f ) );
+        _statusText->setDataVariance(osg::Object::DYNAMIC);
+        _statusText->setColor(osg::Vec4f(0.8,0.8,0.8,1.0));
+        _statusText->setAlignment(osgText::TextBase::CENTER_CENTER);
+        textGeode->addDrawable( _statusText.get() );
+
         osg::PositionAttitudeTransform* titlePAT = new osg::PositionAttitudeTransform;
         titlePAT->addChild(textGeode);
 //        setDistance(42);
@@ -95,4 +105,9 @@ public slots:
             _distanceText->setText("");
         }
     }
+    // Shown across the middle of the view, empty to hide
+    void setStatus(const QString &status)
+    {
+        _statusText->setText( status.toStdString() );
+    }
 };
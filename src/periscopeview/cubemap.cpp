@@ -0,0 +1,33 @@
+#include "cubemap.h"
+#include <osgDB/ReadFile>
+
+osg::ref_ptr<osg::TextureCubeMap> loadCubeMapTextures( const std::string& dir )
+{
+    enum {POS_X, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z};
+
+    std::string filenames[6];
+
+    filenames[POS_X] = "resources/textures/" + dir + "/east.png";
+    filenames[NEG_X] = "resources/textures/" + dir + "/west.png";
+    filenames[POS_Z] = "resources/textures/" + dir + "/north.png";
+    filenames[NEG_Z] = "resources/textures/" + dir + "/south.png";
+    filenames[POS_Y] = "resources/textures/" + dir + "/down.png";
+    filenames[NEG_Y] = "resources/textures/" + dir + "/up.png";
+
+    osg::ref_ptr<osg::TextureCubeMap> cubeMap = new osg::TextureCubeMap;
+    cubeMap->setInternalFormat(GL_RGBA);
+
+    cubeMap->setFilter( osg::Texture::MIN_FILTER,    osg::Texture::LINEAR_MIPMAP_LINEAR);
+    cubeMap->setFilter( osg::Texture::MAG_FILTER,    osg::Texture::LINEAR);
+    cubeMap->setWrap  ( osg::Texture::WRAP_S,        osg::Texture::CLAMP_TO_EDGE);
+    cubeMap->setWrap  ( osg::Texture::WRAP_T,        osg::Texture::CLAMP_TO_EDGE);
+
+    cubeMap->setImage(osg::TextureCubeMap::NEGATIVE_X, osgDB::readImageFile( filenames[NEG_X] ) );
+    cubeMap->setImage(osg::TextureCubeMap::POSITIVE_X, osgDB::readImageFile( filenames[POS_X] ) );
+    cubeMap->setImage(osg::TextureCubeMap::NEGATIVE_Y, osgDB::readImageFile( filenames[NEG_Y] ) );
+    cubeMap->setImage(osg::TextureCubeMap::POSITIVE_Y, osgDB::readImageFile( filenames[POS_Y] ) );
+    cubeMap->setImage(osg::TextureCubeMap::NEGATIVE_Z, osgDB::readImageFile( filenames[NEG_Z] ) );
+    cubeMap->setImage(osg::TextureCubeMap::POSITIVE_Z, osgDB::readImageFile( filenames[POS_Z] ) );
+
+    return cubeMap;
+}
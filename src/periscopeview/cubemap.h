@@ -0,0 +1,10 @@
+#ifndef CUBEMAP_H
+#define CUBEMAP_H
+
+#include <string>
+#include <osg/TextureCubeMap>
+
+// Sky box from the six images in resources/textures/<dir>
+osg::ref_ptr<osg::TextureCubeMap> loadCubeMapTextures( const std::string& dir );
+
+#endif // CUBEMAP_H
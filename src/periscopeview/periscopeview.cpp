@@ -25,6 +25,7 @@
 #include <osg/Notify>
 #include <osg/TextureCubeMap>
 #include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
 #include <osg/Shape>
 #include <osg/ShapeDrawable>
 #include <osg/PositionAttitudeTransform>
@@ -35,8 +36,13 @@
 #include <osgText/Font>
 #include <osg/Switch>
 #include <osg/Texture3D>
+#include <osg/BufferObject>
+#include <osg/KdTree>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/IntersectionVisitor>
 #include <string>
 #include <vector>
+#include <set>
 
 #include <osgOcean/Version>
 #include <osgOcean/OceanScene>
@@ -44,12 +50,40 @@
 #include <osgOcean/SiltEffect>
 #include <osgOcean/ShaderManager>
 
+#include <osgUtil/CullVisitor>
+#include <osgUtil/RenderStage>
+
 #include <QDebug>
 #include "periscopeview.h"
 #include "SkyDome.h"
+#include "cubemap.h"
+#include "videorecorder.h"
+#include "wakes.h"
+#include "../profiling/profiler.h"
 
 #define USE_CUSTOM_SHADER
+// Pixel buffer objects frames are read into while recording, see FrameCapture
+#define VIDEO_PBO_COUNT 3
+// How far the view reaches; vessels further from the sub are not drawn
 #define WORLD_RADIUS 50000
+// Render space is recentred on the sub once it gets this far from the
+// origin, to keep float positions precise near the camera
+#define ORIGIN_REBASE_DISTANCE 4000
+// The eye has to be this far past the wave-displaced surface before the
+// passes are switched to the other medium, so passing waves don't flip it
+#define MEDIUM_HYSTERESIS 0.5
+// Eye depth below the surface at which the periscope is under and nothing
+// is rendered, unless there is a seabed to show
+#define PERISCOPE_UNDER_DEPTH 2.0
+// Earth radius for horizon distances, 4/3 of the real one for the usual
+// atmospheric refraction
+#define EARTH_RADIUS_EFFECTIVE 8.5e6
+// Height above the waterline of the tallest part of each model: ship
+// masts and a torpedo's wake
+#define SHIP_MAST_HEIGHT 30.0
+#define TORPEDO_VISIBLE_HEIGHT 0.5
+// How far the rangefinder reaches
+#define RANGEFINDER_MAX_RANGE 20000
 
 // ----------------------------------------------------
 //               Camera Track Callback
@@ -147,6 +181,165 @@ private:
     bool _endline_after_time;
 };
 
+// ----------------------------------------------------
+//                  Render pass timers
+// ----------------------------------------------------
+
+// Times a camera's draw traversal into a profiler zone. One instance is the
+// camera's initial draw callback and another its final draw callback.
+class RenderPassTimer : public osg::Camera::DrawCallback
+{
+public:
+    static void install(osg::Camera* camera, const std::string& zoneName)
+    {
+        osg::ref_ptr<RenderPassTimer> begin = new RenderPassTimer(Profiler::instance()->zone(zoneName.c_str()), 0);
+        camera->setInitialDrawCallback(begin.get());
+        camera->setFinalDrawCallback(new RenderPassTimer(begin->_zone, begin.get()));
+    }
+
+    virtual void operator()(osg::RenderInfo&) const
+    {
+        if(!_begin.valid())
+            _start = Profiler::now();
+        else
+            Profiler::instance()->record(_zone, _begin->_start, Profiler::now() - _begin->_start);
+    }
+
+private:
+    RenderPassTimer(int zone, const RenderPassTimer* begin) : _zone(zone), _begin(begin), _start(0) {}
+
+    int _zone;
+    osg::ref_ptr<const RenderPassTimer> _begin;
+    mutable qint64 _start;
+};
+
+// osgOcean creates its reflection/refraction/godray/DOF/glare cameras
+// internally and only hands them to the cull visitor, so pick them up from
+// the render stages after the ocean scene has been culled.
+class PassTimerCullCallback : public osg::NodeCallback
+{
+public:
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        traverse(node, nv);
+
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        if(!cv || !cv->getCurrentRenderStage()) return;
+
+        osgUtil::RenderStage* stage = cv->getCurrentRenderStage();
+        instrument(stage->getPreRenderList(), "periscope.pre");
+        instrument(stage->getPostRenderList(), "periscope.post");
+    }
+
+private:
+    void instrument(osgUtil::RenderStage::RenderStageList& stages, const std::string& prefix)
+    {
+        int n = 0;
+        for(osgUtil::RenderStage::RenderStageList::iterator it = stages.begin(); it != stages.end(); ++it, ++n)
+        {
+            osg::Camera* camera = it->second->getCamera();
+            if(!camera || camera->getInitialDrawCallback()) continue;
+            std::string name = camera->getName();
+            if(name.empty()) name = QString::number(n).toStdString();
+            RenderPassTimer::install(camera, prefix + "." + name);
+        }
+    }
+};
+
+// Reads the main camera's image back after it has been drawn: once into
+// the file asked for with PeriscopeView::captureFrame(), and every frame
+// into the video recorder while recording.
+//
+// Recording reads into a ring of pixel buffer objects, so glReadPixels
+// returns at once and the copy happens while later frames render; a frame
+// is mapped and handed to the recorder VIDEO_PBO_COUNT - 1 frames late.
+class FrameCapture : public osg::Camera::DrawCallback
+{
+public:
+    FrameCapture() : _recorder(0), _pboSize(0), _next(0), _filled(0)
+    {
+        for(int i=0;i<VIDEO_PBO_COUNT;i++) _pbos[i] = 0;
+    }
+
+    void capture(const std::string& fileName)
+    {
+        _fileName = fileName;
+    }
+
+    void setRecorder(VideoRecorder* recorder)
+    {
+        _recorder = recorder;
+    }
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        const osg::Viewport* viewport = renderInfo.getCurrentCamera()->getViewport();
+        if(!_fileName.empty())
+        {
+            osg::ref_ptr<osg::Image> image = new osg::Image;
+            image->readPixels(viewport->x(), viewport->y(), viewport->width(), viewport->height(), GL_RGB, GL_UNSIGNED_BYTE);
+            if(!osgDB::writeImageFile(*image, _fileName))
+                osg::notify(osg::WARN) << "Cannot write " << _fileName << std::endl;
+            _fileName.clear();
+        }
+        if(_recorder && _recorder->isRecording())
+            record(renderInfo, viewport);
+        else
+            _filled = 0;
+    }
+
+private:
+    void record(osg::RenderInfo& renderInfo, const osg::Viewport* viewport) const
+    {
+        if((int) viewport->width() != _recorder->frameWidth() || (int) viewport->height() != _recorder->frameHeight())
+            return;
+        osg::GLBufferObject::Extensions* ext = osg::GLBufferObject::getExtensions(renderInfo.getContextID(), true);
+        if(!ext->isPBOSupported())
+        {
+            osg::notify(osg::WARN) << "No pixel buffer objects, can't record video" << std::endl;
+            _recorder = 0;
+            return;
+        }
+        unsigned int size = _recorder->frameWidth() * _recorder->frameHeight() * 3;
+        if(size != _pboSize)
+        {
+            if(_pbos[0]) ext->glDeleteBuffers(VIDEO_PBO_COUNT, _pbos);
+            ext->glGenBuffers(VIDEO_PBO_COUNT, _pbos);
+            for(int i=0;i<VIDEO_PBO_COUNT;i++)
+            {
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, _pbos[i]);
+                ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, 0, GL_STREAM_READ_ARB);
+            }
+            _pboSize = size;
+            _filled = 0;
+        }
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, _pbos[_next]);
+        glReadPixels(viewport->x(), viewport->y(), viewport->width(), viewport->height(), GL_RGB, GL_UNSIGNED_BYTE, 0);
+        _next = (_next + 1) % VIDEO_PBO_COUNT;
+        _filled++;
+        // The buffer read the longest ago is the one written next
+        if(_filled >= VIDEO_PBO_COUNT)
+        {
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, _pbos[_next]);
+            const uchar* pixels = (const uchar*) ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+            if(pixels)
+            {
+                _recorder->addFrame(pixels);
+                ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+            }
+        }
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+
+    mutable std::string _fileName;
+    mutable VideoRecorder* _recorder;
+    mutable GLuint _pbos[VIDEO_PBO_COUNT];
+    mutable unsigned int _pboSize;
+    mutable int _next, _filled;
+};
 
 // ----------------------------------------------------
 //                  Scene Model
@@ -359,6 +552,10 @@ public:
         return _scene.get();
     }
 
+    SkyDome* getSkyDome(void){
+        return _skyDome.get();
+    }
+
     osgOcean::OceanScene* getOceanScene()
     {
         return _oceanScene.get();
@@ -425,37 +622,6 @@ public:
         return islandpat;
     }
 */
-    osg::ref_ptr<osg::TextureCubeMap> loadCubeMapTextures( const std::string& dir )
-    {
-        enum {POS_X, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z};
-
-        std::string filenames[6];
-
-        filenames[POS_X] = "resources/textures/" + dir + "/east.png";
-        filenames[NEG_X] = "resources/textures/" + dir + "/west.png";
-        filenames[POS_Z] = "resources/textures/" + dir + "/north.png";
-        filenames[NEG_Z] = "resources/textures/" + dir + "/south.png";
-        filenames[POS_Y] = "resources/textures/" + dir + "/down.png";
-        filenames[NEG_Y] = "resources/textures/" + dir + "/up.png";
-
-        osg::ref_ptr<osg::TextureCubeMap> cubeMap = new osg::TextureCubeMap;
-        cubeMap->setInternalFormat(GL_RGBA);
-
-        cubeMap->setFilter( osg::Texture::MIN_FILTER,    osg::Texture::LINEAR_MIPMAP_LINEAR);
-        cubeMap->setFilter( osg::Texture::MAG_FILTER,    osg::Texture::LINEAR);
-        cubeMap->setWrap  ( osg::Texture::WRAP_S,        osg::Texture::CLAMP_TO_EDGE);
-        cubeMap->setWrap  ( osg::Texture::WRAP_T,        osg::Texture::CLAMP_TO_EDGE);
-
-        cubeMap->setImage(osg::TextureCubeMap::NEGATIVE_X, osgDB::readImageFile( filenames[NEG_X] ) );
-        cubeMap->setImage(osg::TextureCubeMap::POSITIVE_X, osgDB::readImageFile( filenames[POS_X] ) );
-        cubeMap->setImage(osg::TextureCubeMap::NEGATIVE_Y, osgDB::readImageFile( filenames[NEG_Y] ) );
-        cubeMap->setImage(osg::TextureCubeMap::POSITIVE_Y, osgDB::readImageFile( filenames[POS_Y] ) );
-        cubeMap->setImage(osg::TextureCubeMap::NEGATIVE_Z, osgDB::readImageFile( filenames[NEG_Z] ) );
-        cubeMap->setImage(osg::TextureCubeMap::POSITIVE_Z, osgDB::readImageFile( filenames[POS_Z] ) );
-
-        return cubeMap;
-    }
-
     osg::Geode* sunDebug( const osg::Vec3f& position )
     {
         osg::ShapeDrawable* sphereDraw = new osg::ShapeDrawable( new osg::Sphere( position, 15.f ) );
@@ -549,13 +715,20 @@ private:
     bool toggleZoom;
 };
 
-PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
+PeriscopeView::PeriscopeView(QObject *parent, bool offscreen, int width, int height, int slices) :
+    QObject(parent), offscreen(offscreen)
 {
     periscopeDir = 0;
+    originX = originY = 0;
+    subX = subY = 0;
+    eyeHorizon = sqrt(2 * EARTH_RADIUS_EFFECTIVE * 5);
+    explosionX = explosionY = 0;
     osg::notify(osg::NOTICE) << "osgOcean " << osgOceanGetVersion() << std::endl << std::endl;
     float windx = 1.1f, windy = 1.1f;
     osg::Vec2f windDirection(windx, windy);
     subPitch = subRoll = subYaw = 0;
+    medium = AboveWater;
+    underShown = false;
 
     float windSpeed = 12.f;
     float depth = 1000.f;
@@ -569,9 +742,37 @@ PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
     bool testCollision = false;
     bool disableShaders = false;
     //    osg::ref_ptr<osg::Node> loadedModel = osgDB::readNodeFiles(parser);
-    int width = 400;
-    int height = 300;
-    viewer.setUpViewInWindow( 640,150,width,height, 0 );
+    if(slices > 1) {
+        setUpPanorama(slices, width, height);
+    } else if(offscreen) {
+        // A pbuffer needs no window to show, so frames can be timed on a
+        // machine with only a software GL (e.g. Mesa llvmpipe under Xvfb).
+        // osg's own stats give the traversal times, see tick().
+        osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+        traits->width = width;
+        traits->height = height;
+        traits->pbuffer = true;
+        traits->doubleBuffer = false;
+        traits->windowDecoration = false;
+        osg::ref_ptr<osg::GraphicsContext> context = osg::GraphicsContext::createGraphicsContext(traits.get());
+        if(!context.valid()) {
+            qWarning() << Q_FUNC_INFO << "can't create a pbuffer, rendering to a window";
+            viewer.setUpViewInWindow( 640,150,width,height, 0 );
+        } else {
+            viewer.getCamera()->setGraphicsContext(context.get());
+            viewer.getCamera()->setViewport(new osg::Viewport(0, 0, width, height));
+            viewer.getCamera()->setDrawBuffer(GL_FRONT);
+            viewer.getCamera()->setReadBuffer(GL_FRONT);
+        }
+    } else {
+        viewer.setUpViewInWindow( 640,150,width,height, 0 );
+    }
+    if(offscreen)
+        viewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
+    if(offscreen || slices > 1) {
+        viewer.getViewerStats()->collectStats("update", true);
+        viewer.getCamera()->getStats()->collectStats("rendering", true);
+    }
     viewer.addEventHandler( new osgViewer::StatsHandler );
     hud = new TextHUD(this);
     osgOcean::ShaderManager::instance().enableShaders(!disableShaders);
@@ -579,12 +780,25 @@ PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
 
     scene->getOceanScene()->setOceanSurfaceHeight(oceanSurfaceHeight);
     _oceanScene = scene->getOceanScene();
+    sceneRoot = scene->getScene();
+    skyDome = scene->getSkyDome();
+    applyMedium();
     viewer.addEventHandler(scene->getOceanSceneEventHandler());
     viewer.addEventHandler(scene->getOceanSurface()->getEventHandler());
 
 //    viewer.addEventHandler( new osgViewer::HelpHandler );
     viewer.getCamera()->setName("MainCamera");
-    viewer.getCamera()->setProjectionMatrixAsPerspective(32, (float)width/(float)height, 2, WORLD_RADIUS);
+    // Panorama slices have draw zones and a viewport of their own, the
+    // master camera only draws without them
+    unsigned int slaves = viewer.getNumSlaves();
+    if(!slaves)
+        RenderPassTimer::install(viewer.getCamera(), "periscope.draw");
+    captureCamera = slaves ? viewer.getSlave(slaves / 2)._camera.get() : viewer.getCamera();
+    frameCapture = new FrameCapture;
+    captureCamera->setPostDrawCallback(frameCapture.get());
+    _oceanScene->setCullCallback(new PassTimerCullCallback);
+    aspect = (double) width / height;
+    setFov(32);
     eventHandler = new SceneEventHandler(viewer, _oceanScene, hud);
     viewer.addEventHandler( eventHandler );
     osg::Group* root = new osg::Group;
@@ -624,6 +838,10 @@ PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
     }
         */
     root->addChild( hud->getHudCamera() );
+    RenderPassTimer::install(hud->getHudCamera(), "periscope.hud");
+    // The rangefinder's ray picks go through kd-trees built once per model
+    // and shared by every vessel using it
+    osg::ref_ptr<osg::KdTreeBuilder> kdTreeBuilder = new osg::KdTreeBuilder;
     ship = osgDB::readNodeFile("resources/models/ship.obj");
     if(!ship.valid()) {
         qDebug() << Q_FUNC_INFO << "can't load ship resources/models/ship.obj";
@@ -631,6 +849,7 @@ PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
         ship->setNodeMask( _oceanScene->getNormalSceneMask() |
                            _oceanScene->getReflectedSceneMask() |
                            _oceanScene->getRefractedSceneMask() );
+        ship->accept(*kdTreeBuilder);
     }
     torpedo = osgDB::readNodeFile("resources/models/torpedo.obj");
     if(!torpedo.valid()) {
@@ -639,11 +858,16 @@ PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
         torpedo->setNodeMask( _oceanScene->getNormalSceneMask() |
                               _oceanScene->getReflectedSceneMask() |
                               _oceanScene->getRefractedSceneMask() );
+        torpedo->accept(*kdTreeBuilder);
     }
 
     _oceanScene->addChild(&explosion.getGroup());
     _oceanScene->addChild(&explosion.getPat());
     explosion.getPat().setPosition(osg::Vec3f(0, 50, 0));
+    // Foam is only seen from above the surface
+    wakes.getGeode().setNodeMask(_oceanScene->getNormalSceneMask());
+    _oceanScene->addChild(&wakes.getGeode());
+    _oceanScene->addChild(&seabed.getGroup());
 
     viewer.setSceneData( root );
     viewer.realize();
@@ -651,33 +875,224 @@ PeriscopeView::PeriscopeView(QObject *parent) : QObject(parent)
 }
 
 void PeriscopeView::tick(double dt, int total) {
+    PROFILE_SCOPE("periscope.tick");
     double totalD = (double)total / 1000.0d;
     subRoll = sin(totalD)*0.4;
     subYaw = sin(totalD*1.1)*0.3;
     subPitch = sin(totalD*0.9)*0.3;
+    wakes.setTime(totalD);
     pollKeyboard();
     periscopeDir += 50*eventHandler->getRotation()*dt;
 
     QMap<Vessel *, Vessel *> collidedVessels;
-    foreach(Vessel *v, vesselsTransforms.keys()) {
-        osg::MatrixTransform* t =vesselsTransforms[v];
+    {
+        PROFILE_SCOPE("periscope.collisions");
+        findCollisions(vesselsTransforms, collidedVessels);
+    }
+    foreach(Vessel *t, collidedVessels.keys()) {
+        emit collisionBetween(t, collidedVessels.value(t));
+    }
+
+    // With the periscope under there is nothing to see; one frame shows the
+    // status and after that only window events are handled
+    if(medium == PeriscopeUnder && underShown) {
+        viewer.eventTraversal();
+        return;
+    }
+    {
+        PROFILE_SCOPE("periscope.rangefinder");
+        hud->setDistance(medium == AboveWater ? rangeAlongSight() : 0);
+    }
+    if( !viewer.done() ) {
+        PROFILE_SCOPE("periscope.frame");
+        viewer.frame();
+        underShown = medium == PeriscopeUnder;
+    }
+    if(offscreen || viewer.getNumSlaves() > 0)
+        recordOsgStats();
+}
+
+// One slave camera per slice of the panorama, side by side windows (or
+// pbuffers) each turned by a slice's field of view from the master camera.
+// The slices share the scene graph and its update traversal, the FFT ocean
+// animation included. osgOcean culls its reflection and refraction
+// cameras against each slice's own frustum, so those passes run per slice.
+void PeriscopeView::setUpPanorama(int slices, int width, int height) {
+    for(int i=0;i<slices;i++) {
+        osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+        traits->x = i * width;
+        traits->y = 150;
+        traits->width = width;
+        traits->height = height;
+        traits->pbuffer = offscreen;
+        traits->doubleBuffer = !offscreen;
+        traits->windowDecoration = false;
+        osg::ref_ptr<osg::GraphicsContext> context = osg::GraphicsContext::createGraphicsContext(traits.get());
+        if(!context.valid()) {
+            qWarning() << Q_FUNC_INFO << "can't create the context for slice" << i;
+            continue;
+        }
+        osg::ref_ptr<osg::Camera> camera = new osg::Camera;
+        camera->setName("Slice" + QString::number(i).toStdString());
+        camera->setGraphicsContext(context.get());
+        camera->setViewport(new osg::Viewport(0, 0, width, height));
+        GLenum buffer = traits->doubleBuffer ? GL_BACK : GL_FRONT;
+        camera->setDrawBuffer(buffer);
+        camera->setReadBuffer(buffer);
+        camera->setStats(new osg::Stats("Slice"));
+        camera->getStats()->collectStats("rendering", true);
+        // Turned by setFov()
+        viewer.addSlave(camera.get());
+        slicePositions.append(i - (slices - 1) / 2.0);
+        RenderPassTimer::install(camera.get(), "periscope.slice" + QString::number(i).toStdString() + ".draw");
+        QByteArray zone = "periscope.slice" + QByteArray::number(i);
+        sliceCullZones.append(Profiler::instance()->zone(zone + ".cull"));
+        sliceDrawZones.append(Profiler::instance()->zone(zone + ".osgdraw"));
+    }
+    if(viewer.getNumSlaves() == 0)
+        viewer.setUpViewInWindow( 640,150,width,height, 0 );
+}
+
+// Copies the traversal times osg measured for the last frame into the
+// profiler, next to the render pass zones
+void PeriscopeView::recordOsgStats() {
+    static const int updateZone = Profiler::instance()->zone("periscope.osg.update");
+    static const int cullZone = Profiler::instance()->zone("periscope.osg.cull");
+    static const int drawZone = Profiler::instance()->zone("periscope.osg.draw");
+    osg::Stats *viewerStats = viewer.getViewerStats();
+    osg::Stats *cameraStats = viewer.getCamera()->getStats();
+    unsigned int frame = viewerStats->getLatestFrameNumber();
+    qint64 now = Profiler::now();
+    double seconds;
+    if(viewerStats->getAttribute(frame, "Update traversal time taken", seconds))
+        Profiler::instance()->record(updateZone, now, seconds * 1e9);
+    frame = cameraStats->getLatestFrameNumber();
+    if(cameraStats->getAttribute(frame, "Cull traversal time taken", seconds))
+        Profiler::instance()->record(cullZone, now, seconds * 1e9);
+    if(cameraStats->getAttribute(frame, "Draw traversal time taken", seconds))
+        Profiler::instance()->record(drawZone, now, seconds * 1e9);
+    for(unsigned int i=0;i<viewer.getNumSlaves() && (int) i<sliceCullZones.size();i++) {
+        osg::Stats *sliceStats = viewer.getSlave(i)._camera->getStats();
+        frame = sliceStats->getLatestFrameNumber();
+        if(sliceStats->getAttribute(frame, "Cull traversal time taken", seconds))
+            Profiler::instance()->record(sliceCullZones[i], now, seconds * 1e9);
+        if(sliceStats->getAttribute(frame, "Draw traversal time taken", seconds))
+            Profiler::instance()->record(sliceDrawZones[i], now, seconds * 1e9);
+    }
+}
+
+// Picks the medium the eye is in against the wave-displaced surface and
+// enables only the passes that show in it. osgOcean rebuilds its shaders
+// when passes are toggled, so this only happens on a change of medium.
+void PeriscopeView::updateMedium(double x, double y, double eyeHeight) {
+    double surface = _oceanScene->getOceanSurfaceHeightAt(x, y);
+    Medium newMedium = medium;
+    if(eyeHeight < surface - PERISCOPE_UNDER_DEPTH && !seabed.isLoaded())
+        newMedium = PeriscopeUnder;
+    else if(eyeHeight < surface - MEDIUM_HYSTERESIS)
+        newMedium = Underwater;
+    else if(eyeHeight > surface + MEDIUM_HYSTERESIS)
+        newMedium = AboveWater;
+    else if(medium == PeriscopeUnder)
+        newMedium = Underwater;
+    if(newMedium == medium) return;
+    qDebug() << Q_FUNC_INFO << medium << "->" << newMedium;
+    medium = newMedium;
+    applyMedium();
+}
+
+void PeriscopeView::applyMedium() {
+    bool above = medium == AboveWater;
+    _oceanScene->enableReflections(above);
+    _oceanScene->enableGlare(above);
+    _oceanScene->enableGodRays(!above);
+    _oceanScene->enableSilt(!above);
+    _oceanScene->enableUnderwaterDOF(!above);
+    _oceanScene->enableDistortion(!above);
+    skyDome->setNodeMask(above ? _oceanScene->getReflectedSceneMask() | _oceanScene->getNormalSceneMask() : 0);
+
+    sceneRoot->setNodeMask(medium == PeriscopeUnder ? 0 : ~0u);
+    seabed.getGroup().setNodeMask(medium == Underwater ? _oceanScene->getNormalSceneMask() : 0);
+    hud->setStatus(medium == PeriscopeUnder ? "Periscope under" : "");
+    underShown = false;
+}
+
+// Range to the first vessel on the periscope's line of sight, 0 if none.
+// Vessel bounding spheres filter out everything the ray misses; the hit
+// candidates are then picked in order of distance against their model's
+// kd-tree, stopping once no nearer hit is possible.
+double PeriscopeView::rangeAlongSight() {
+    osg::Vec3d eye, center, up;
+    viewer.getCamera()->getViewMatrixAsLookAt(eye, center, up);
+    osg::Vec3d direction = center - eye;
+    direction.normalize();
+
+    QMap<double, osg::MatrixTransform*> candidates;
+    foreach(osg::MatrixTransform *transform, vesselsTransforms) {
+        if(!transform->getNodeMask()) continue;
+        const osg::BoundingSphere &bound = transform->getBound();
+        if(!bound.valid()) continue;
+        osg::Vec3d toCenter = osg::Vec3d(bound.center()) - eye;
+        double along = toCenter * direction;
+        double offAxis2 = toCenter.length2() - along * along;
+        double radius2 = bound.radius() * bound.radius();
+        if(offAxis2 > radius2) continue;
+        double entry = along - sqrt(radius2 - offAxis2);
+        if(along + bound.radius() < 0 || entry > RANGEFINDER_MAX_RANGE) continue;
+        candidates.insertMulti(qMax(entry, 0.0), transform);
+    }
+
+    double range = 0;
+    QMap<double, osg::MatrixTransform*>::const_iterator i;
+    for(i = candidates.constBegin(); i != candidates.constEnd(); ++i) {
+        if(range > 0 && i.key() > range) break;
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector =
+                new osgUtil::LineSegmentIntersector(eye, eye + direction * RANGEFINDER_MAX_RANGE);
+        osgUtil::IntersectionVisitor visitor(intersector.get());
+        i.value()->accept(visitor);
+        if(!intersector->containsIntersections()) continue;
+        double hit = (intersector->getFirstIntersection().getWorldIntersectPoint() - eye).length();
+        if(range == 0 || hit < range)
+            range = hit;
+    }
+    return range;
+}
+
+void PeriscopeView::captureFrame(const QString &fileName) {
+    static_cast<FrameCapture*>(frameCapture.get())->capture(fileName.toStdString());
+}
+
+bool PeriscopeView::startRecording(const QString &fileName, int fps) {
+    const osg::Viewport *viewport = captureCamera->getViewport();
+    if(!viewport) {
+        qWarning() << Q_FUNC_INFO << "no viewport to record";
+        return false;
+    }
+    if(!recorder.open(fileName, viewport->width(), viewport->height(), fps))
+        return false;
+    static_cast<FrameCapture*>(frameCapture.get())->setRecorder(&recorder);
+    return true;
+}
+
+void PeriscopeView::stopRecording() {
+    recorder.close();
+}
+
+void PeriscopeView::findCollisions(const QMap<Vessel *, osg::MatrixTransform*> &transforms,
+                                   QMap<Vessel *, Vessel *> &collided) {
+    foreach(Vessel *v, transforms.keys()) {
+        osg::MatrixTransform* t =transforms.value(v);
         if(v->type==2) {
-            foreach(Vessel *v2, vesselsTransforms.keys()) {
+            foreach(Vessel *v2, transforms.keys()) {
                 if(v != v2 && v2->type != 2) {
-                    osg::MatrixTransform* t2 =vesselsTransforms[v2];
+                    osg::MatrixTransform* t2 =transforms.value(v2);
                     if(t->getBound().intersects(t2->getBound())) {
-                        collidedVessels.insert(v, v2);
+                        collided.insert(v, v2);
                     }
                 }
             }
         }
     }
-    foreach(Vessel *t, collidedVessels.keys()) {
-        emit collisionBetween(t, collidedVessels.value(t));
-    }
-
-    if( !viewer.done() )
-        viewer.frame();
 }
 
 void PeriscopeView::setPeriscopeDirection(double dir) {
@@ -685,10 +1100,12 @@ void PeriscopeView::setPeriscopeDirection(double dir) {
 }
 
 void PeriscopeView::vesselUpdated(Vessel *vessel) {
+    PROFILE_SCOPE("periscope.update");
     if(vessel->id==0) {
-        osg::Vec3f eye(vessel->x,vessel->y,20.f);
-        osg::Vec3f centre = eye+osg::Vec3f(0.f,1.f,0.f);
-        osg::Vec3f up(0.f, 0.f, 1.f);
+        // The sub comes first in every update, so the vessels that follow are
+        // placed against the new origin
+        if(fabs(vessel->x - originX) > ORIGIN_REBASE_DISTANCE || fabs(vessel->y - originY) > ORIGIN_REBASE_DISTANCE)
+            rebaseOrigin(vessel->x, vessel->y);
         double periscopeDirection = vessel->heading + periscopeDir + subYaw;
         while(periscopeDirection >= 360) periscopeDirection -=360;
         while(periscopeDirection < 0) periscopeDirection +=360;
@@ -696,7 +1113,8 @@ void PeriscopeView::vesselUpdated(Vessel *vessel) {
 
         osg::Matrixd cameraRotation;
         osg::Matrixd cameraTrans;
-        cameraTrans.makeTranslate( -vessel->x,vessel->y, -5 + vessel->depth);
+        osg::Vec3d eye = toRender(vessel->x, vessel->y, 0);
+        cameraTrans.makeTranslate(-eye.x(), -eye.y(), -5 + vessel->depth);
 
         cameraRotation.makeRotate(
                     osg::DegreesToRadians(0.0), osg::Vec3(0,1,0), // roll
@@ -708,16 +1126,34 @@ void PeriscopeView::vesselUpdated(Vessel *vessel) {
                                   osg::DegreesToRadians(subRoll), osg::Vec3(0,0,1) ); //
         myCameraMatrix = myCameraMatrix*cameraRotation;
         viewer.getCamera()->setViewMatrix(myCameraMatrix);
+        updateMedium(eye.x(), eye.y(), 5 - vessel->depth);
+        subX = vessel->x;
+        subY = vessel->y;
+        eyeHorizon = sqrt(2 * EARTH_RADIUS_EFFECTIVE * qMax(5 - vessel->depth, 0.5));
         hud->setHeading(periscopeDirection);
     } else {
         double zeroDepth = 0;
         if(vessel->type==2) zeroDepth -= 0.5;
         osg::MatrixTransform *transform = vesselsTransforms[vessel];
+        // Past the eye's horizon the earth's curve hides the lower part of
+        // the vessel. Sinking it by that much lets the flat ocean clip it;
+        // once even the top is hidden it is left out of every pass. It is
+        // still placed: findCollisions() tests every transform's bounds.
+        double distance = sqrt((vessel->x - subX) * (vessel->x - subX) + (vessel->y - subY) * (vessel->y - subY));
+        double beyond = qMax(distance - eyeHorizon, 0.0);
+        double hidden = beyond * beyond / (2 * EARTH_RADIUS_EFFECTIVE);
+        double height = vessel->type == 2 ? TORPEDO_VISIBLE_HEIGHT : SHIP_MAST_HEIGHT;
+        bool visible = distance < WORLD_RADIUS && hidden < height;
+        // Wakes follow every vessel, seen or not, so they are whole when it
+        // comes into view
+        wakes.update(vessel, toRender(vessel->x, vessel->y, 0), vessel->heading, vessel->speed);
+        osg::Vec3d position = toRender(vessel->x, vessel->y, -vessel->depth + zeroDepth - hidden);
         osg::Matrixd shipMatrix = osg::Matrix::rotate(osg::DegreesToRadians(0.0), osg::Vec3(0,1,0), // roll
                                                       osg::DegreesToRadians(0.0), osg::Vec3(1,0,0) , // pitch
                                                       osg::DegreesToRadians(- vessel->heading), osg::Vec3(0,0,1) );
-        shipMatrix *= shipMatrix.translate(osg::Vec3f(vessel->x, -vessel->y, -vessel->depth + zeroDepth));
+        shipMatrix *= shipMatrix.translate(position);
         transform->setMatrix(shipMatrix);
+        transform->setNodeMask(visible ? ~0u : 0u);
     }
 }
 
@@ -735,24 +1171,76 @@ void PeriscopeView::createVessel(Vessel *sub) {
     vesselsTransforms[sub]=vesselTransform.get();
 }
 
-void PeriscopeView::vesselDeleted(Vessel *sub) {
-    qDebug() << Q_FUNC_INFO;
-    _oceanScene->removeChild(vesselsTransforms[sub]);
-    vesselsTransforms[sub]->unref();
-    Q_ASSERT(vesselsTransforms.remove(sub));
+void PeriscopeView::createVessels(const QVector<Vessel*> &vessels) {
+    foreach(Vessel *v, vessels)
+        createVessel(v);
+}
+
+// Drops all the transforms in one pass over the scene's children instead of
+// a removeChild() search per vessel
+void PeriscopeView::vesselsDeleted(const QVector<Vessel*> &vessels) {
+    qDebug() << Q_FUNC_INFO << vessels.size();
+    std::set<osg::Node*> removed;
+    foreach(Vessel *v, vessels) {
+        QMap<Vessel *, osg::MatrixTransform*>::iterator i = vesselsTransforms.find(v);
+        if(i == vesselsTransforms.end()) continue;
+        removed.insert(i.value());
+        vesselsTransforms.erase(i);
+        wakes.remove(v);
+    }
+    std::vector<osg::ref_ptr<osg::Node> > kept;
+    kept.reserve(_oceanScene->getNumChildren());
+    for(unsigned int i=0;i<_oceanScene->getNumChildren();i++) {
+        osg::Node *child = _oceanScene->getChild(i);
+        if(!removed.count(child))
+            kept.push_back(child);
+    }
+    _oceanScene->removeChildren(0, _oceanScene->getNumChildren());
+    for(unsigned int i=0;i<kept.size();i++)
+        _oceanScene->addChild(kept[i].get());
 }
 
 void PeriscopeView::pollKeyboard() {
     static bool zoomHigh = false;
     if(eventHandler->zoomToggled()) {
         zoomHigh = !zoomHigh;
-        float fov = 32;
-        if(zoomHigh) fov = 8;
-        viewer.getCamera()->setProjectionMatrixAsPerspective(fov, 16.f/9.f, 0.3, WORLD_RADIUS);
+        setFov(zoomHigh ? 8 : 32);
     }
 }
+
+// The slices of a panorama share the master's projection, so each is
+// turned by as many horizontal fields of view as it is from the middle
+void PeriscopeView::setFov(double fov) {
+    viewer.getCamera()->setProjectionMatrixAsPerspective(fov, aspect, 2, WORLD_RADIUS);
+    double sliceFov = 2 * atan(tan(osg::DegreesToRadians(fov / 2)) * aspect);
+    for(unsigned int i=0;i<viewer.getNumSlaves() && (int) i<slicePositions.size();i++)
+        viewer.getSlave(i)._viewOffset = osg::Matrixd::rotate(slicePositions[i] * sliceFov, 0, 1, 0);
+}
+
+// World coordinates in doubles, relative to the floating origin only when
+// handed to OSG
+osg::Vec3d PeriscopeView::toRender(double x, double y, double z) const {
+    return osg::Vec3d(x - originX, -(y - originY), z);
+}
+
+void PeriscopeView::rebaseOrigin(double x, double y) {
+    qDebug() << Q_FUNC_INFO << x << y;
+    wakes.shift(osg::Vec3d(originX - x, y - originY, 0));
+    originX = x;
+    originY = y;
+    seabed.rebuild(x, y);
+    explosion.getPat().setPosition(toRender(explosionX, explosionY, 0));
+}
+
+void PeriscopeView::setBathymetry(Bathymetry *bathymetry) {
+    seabed.setBathymetry(bathymetry);
+    seabed.rebuild(originX, originY);
+}
+
 void PeriscopeView::addExplosion(double x, double y, double intensity) {
-    explosion.getPat().setPosition(osg::Vec3f(x, -y, 0));
+    explosionX = x;
+    explosionY = y;
+    explosion.getPat().setPosition(toRender(x, y, 0));
     killExplosionTimer.setInterval(500);
     killExplosionTimer.start();
     explosion.setEnabled(true);
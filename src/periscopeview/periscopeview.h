@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QVector>
 #include <QTimer>
 
 #include <osg/Node>
@@ -26,28 +27,78 @@
 #include "../simulation/vessel.h"
 #include "explosion.h"
 #include "TextHUD.h"
+#include "videorecorder.h"
+#include "wakes.h"
+#include "seabed.h"
 
 class SceneEventHandler;
+class SkyDome;
 
 class PeriscopeView : public QObject
 {
     Q_OBJECT
 public:
-    explicit PeriscopeView(QObject *parent = 0);
+    // Offscreen views render to a pbuffer of width x height and record
+    // osg's cull and draw times as profiler zones. With several slices the
+    // view is a panorama of that many width x height displays side by side.
+    explicit PeriscopeView(QObject *parent = 0, bool offscreen = false, int width = 400, int height = 300,
+                           int slices = 1);
+    // Writes the next frame drawn to an image file. A panorama's master
+    // camera draws nothing, so there the middle slice is captured, as it is
+    // for recording.
+    void captureFrame(const QString &fileName);
+    // Records every frame drawn to a .y4m video, see VideoRecorder
+    bool startRecording(const QString &fileName, int fps = 20);
+    void stopRecording();
+    // Draws the seabed in the underwater view, see Seabed, which then also
+    // goes on below periscope depth. Not owned.
+    void setBathymetry(Bathymetry *bathymetry);
+    // Torpedoes whose bounds touch a vessel, torpedo -> vessel hit
+    static void findCollisions(const QMap<Vessel *, osg::MatrixTransform*> &transforms,
+                               QMap<Vessel *, Vessel *> &collided);
 signals:
     void collisionBetween(Vessel *v, Vessel *v2);
 public slots:
     void tick(double dt, int total);
     void vesselUpdated(Vessel *v);
     void createVessel(Vessel *v);
-    void vesselDeleted(Vessel *v);
+    void createVessels(const QVector<Vessel*> &vessels);
+    void vesselsDeleted(const QVector<Vessel*> &vessels);
     void setPeriscopeDirection(double dir);
     void addExplosion(double x, double y, double intensity);
 private slots:
     void killExplosion();
 private:
     void pollKeyboard();
+    osg::Vec3d toRender(double x, double y, double z) const;
+    void rebaseOrigin(double x, double y);
+    void recordOsgStats();
+    void setUpPanorama(int slices, int width, int height);
+    // Vertical field of view in degrees, of each slice in a panorama
+    void setFov(double fov);
+    void updateMedium(double x, double y, double eyeHeight);
+    void applyMedium();
+    double rangeAlongSight();
+    bool offscreen;
+    // Profiler zones of each panorama slice's cull and draw traversals
+    QVector<int> sliceCullZones, sliceDrawZones;
+    // Each slave's place in the panorama, in slices from the middle
+    QVector<double> slicePositions;
+    // Of the window, or of each slice
+    double aspect;
+    // Where the eye is; only the passes for its medium are rendered
+    enum Medium { AboveWater, Underwater, PeriscopeUnder };
+    Medium medium;
+    bool underShown;
+    osg::Node *sceneRoot;
+    SkyDome *skyDome;
     double periscopeDir;
+    // World position of the render space origin, see toRender()
+    double originX, originY;
+    // The sub's position and how far the periscope's horizon is, for
+    // hiding vessels hull down beyond it
+    double subX, subY, eyeHorizon;
+    double explosionX, explosionY;
     double subPitch, subRoll, subYaw;
     osg::Vec4f intColor(unsigned int r, unsigned int g, unsigned int b, unsigned int a = 255 );
 
@@ -71,8 +122,14 @@ private:
     QMap<Vessel *, osg::MatrixTransform*> vesselsTransforms;
     osg::ref_ptr<osg::Node> ship, torpedo;
     Explosion explosion;
+    Wakes wakes;
+    Seabed seabed;
     QTimer killExplosionTimer;
     TextHUD *hud;
+    osg::ref_ptr<osg::Camera::DrawCallback> frameCapture;
+    // The camera frames are captured from, owned by the viewer
+    osg::Camera *captureCamera;
+    VideoRecorder recorder;
 };
 
 #endif // PERISCOPEVIEW_H
@@ -11,10 +11,18 @@ LIBS += -L/usr/local/lib -losgOcean
 SOURCES += periscopeview.cpp \
     SkyDome.cpp \
     SphereSegment.cpp \
+    cubemap.cpp \
+    videorecorder.cpp \
+    wakes.cpp \
+    seabed.cpp \
     explosion.cpp
 
 HEADERS += periscopeview.h \
     explosion.h\
+    cubemap.h \
+    videorecorder.h \
+    wakes.h \
+    seabed.h \
     TextHUD.h
 
 
@@ -0,0 +1,129 @@
+#include "seabed.h"
+#include "../simulation/bathymetry.h"
+#include <osg/Geode>
+#include <osg/LOD>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <QVector>
+#include <float.h>
+#include <math.h>
+
+// Levels used, and the distance to a patch up to which level 0 is drawn;
+// every coarser level is drawn out to twice the previous one's distance
+#define SEABED_LEVELS 3
+#define SEABED_FINE_RANGE 1500
+// Most quads along a patch side, whatever the bathymetry's resolution
+#define SEABED_MAX_QUADS 64
+// Meters of seabed the sand texture covers, and its size in texels
+#define SEABED_TEXTURE_SIZE 20.0
+#define SEABED_TEXELS 64
+
+// osgOcean's scene shader modulates a texture on unit 0 with its lighting
+// and underwater fog; there is no sand texture among the resources, so a
+// speckled one is made here
+static osg::Image *sandImage() {
+    osg::Image *image = new osg::Image;
+    image->allocateImage(SEABED_TEXELS, SEABED_TEXELS, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    unsigned char *p = image->data();
+    quint32 seed = 12345;
+    for(int i=0;i<SEABED_TEXELS * SEABED_TEXELS;i++) {
+        seed = seed * 1103515245u + 12345u;
+        double shade = 0.75 + 0.25 * ((seed >> 16) & 0xff) / 255.0;
+        *p++ = 194 * shade;
+        *p++ = 178 * shade;
+        *p++ = 128 * shade;
+    }
+    return image;
+}
+
+Seabed::Seabed() : group(new osg::Group), stateSet(new osg::StateSet), bathymetry(0)
+{
+    group->setDataVariance(osg::Object::DYNAMIC);
+    osg::Texture2D *texture = new osg::Texture2D(sandImage());
+    texture->setWrap(osg::Texture2D::WRAP_S, osg::Texture2D::REPEAT);
+    texture->setWrap(osg::Texture2D::WRAP_T, osg::Texture2D::REPEAT);
+    texture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR_MIPMAP_LINEAR);
+    stateSet->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+    group->setStateSet(stateSet.get());
+}
+
+osg::Group& Seabed::getGroup() {
+    return *group;
+}
+
+void Seabed::setBathymetry(Bathymetry *b) {
+    bathymetry = b;
+    if(!bathymetry)
+        group->removeChildren(0, group->getNumChildren());
+}
+
+void Seabed::rebuild(double originX, double originY) {
+    group->removeChildren(0, group->getNumChildren());
+    if(!bathymetry || !bathymetry->isOpen()) return;
+    int levels = qMin(SEABED_LEVELS, bathymetry->levels());
+    for(double py=-SEABED_RADIUS;py<SEABED_RADIUS;py+=SEABED_PATCH) {
+        for(double px=-SEABED_RADIUS;px<SEABED_RADIUS;px+=SEABED_PATCH) {
+            osg::LOD *lod = new osg::LOD;
+            for(int level=0;level<levels;level++) {
+                osg::Geode *geode = new osg::Geode;
+                geode->addDrawable(buildMesh(originX + px, originY + py, level, originX, originY));
+                float nearest = level ? SEABED_FINE_RANGE * (1 << (level - 1)) : 0;
+                float farthest = level == levels - 1 ? FLT_MAX : SEABED_FINE_RANGE * (1 << level);
+                lod->addChild(geode, nearest, farthest);
+            }
+            group->addChild(lod);
+        }
+    }
+}
+
+// One patch from x0, y0 on, sampled from a level's grid. Render space has y
+// flipped, see PeriscopeView::toRender(), which the winding and normals
+// account for.
+osg::Geometry *Seabed::buildMesh(double x0, double y0, int level, double originX, double originY) {
+    int quads = qBound(1, (int) (SEABED_PATCH / bathymetry->cellSize(level) + 0.5), SEABED_MAX_QUADS);
+    int side = quads + 1;
+    double step = (double) SEABED_PATCH / quads;
+    // One sample of margin around the patch for the normals
+    QVector<float> depths((side + 2) * (side + 2));
+    for(int j=-1;j<=side;j++)
+        for(int i=-1;i<=side;i++)
+            depths[(j + 1) * (side + 2) + i + 1] = bathymetry->depthAt(x0 + i * step, y0 + j * step, level);
+
+    osg::Vec3Array *vertices = new osg::Vec3Array(side * side);
+    osg::Vec3Array *normals = new osg::Vec3Array(side * side);
+    osg::Vec2Array *texCoords = new osg::Vec2Array(side * side);
+    for(int j=0;j<side;j++) {
+        for(int i=0;i<side;i++) {
+            const float *d = &depths[(j + 1) * (side + 2) + i + 1];
+            double x = x0 + i * step, y = y0 + j * step;
+            int n = j * side + i;
+            (*vertices)[n] = osg::Vec3(x - originX, -(y - originY), -d[0]);
+            osg::Vec3 normal((d[1] - d[-1]) / (2 * step), -(d[side + 2] - d[-(side + 2)]) / (2 * step), 1);
+            normal.normalize();
+            (*normals)[n] = normal;
+            (*texCoords)[n] = osg::Vec2(x / SEABED_TEXTURE_SIZE, y / SEABED_TEXTURE_SIZE);
+        }
+    }
+    osg::DrawElementsUInt *indices = new osg::DrawElementsUInt(GL_TRIANGLES);
+    indices->reserve(quads * quads * 6);
+    for(int j=0;j<quads;j++) {
+        for(int i=0;i<quads;i++) {
+            unsigned int a = j * side + i;
+            indices->push_back(a);
+            indices->push_back(a + side);
+            indices->push_back(a + side + 1);
+            indices->push_back(a);
+            indices->push_back(a + side + 1);
+            indices->push_back(a + 1);
+        }
+    }
+    osg::Geometry *geometry = new osg::Geometry;
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(vertices);
+    geometry->setNormalArray(normals);
+    geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+    geometry->setTexCoordArray(0, texCoords);
+    geometry->addPrimitiveSet(indices);
+    return geometry;
+}
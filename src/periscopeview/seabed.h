@@ -0,0 +1,44 @@
+#ifndef SEABED_H
+#define SEABED_H
+
+#include <osg/Group>
+#include <osg/Geometry>
+#include <osg/StateSet>
+
+class Bathymetry;
+
+// Meters of seabed drawn each way from the render space origin; more than
+// the underwater visibility plus the distance the origin lags the eye by
+#define SEABED_RADIUS 6400
+// Side of a patch, the unit the detail level is picked for
+#define SEABED_PATCH 1600
+
+/*
+ * The seabed around the render space origin, from a Bathymetry file.
+ *
+ * The area is split into square patches, each an osg::LOD with one mesh
+ * per bathymetry level: near patches use level 0's full resolution, far
+ * ones the coarser levels with a quarter of the vertices each step. The
+ * meshes are built when the origin moves, not per frame.
+ */
+class Seabed
+{
+public:
+    Seabed();
+    osg::Group& getGroup();
+    // Not owned; 0 removes the seabed
+    void setBathymetry(Bathymetry *b);
+    bool isLoaded() const { return bathymetry != 0; }
+    // Rebuilds the patches around the world position the render space
+    // origin is at
+    void rebuild(double originX, double originY);
+
+private:
+    osg::Geometry *buildMesh(double x0, double y0, int level, double originX, double originY);
+
+    osg::ref_ptr<osg::Group> group;
+    osg::ref_ptr<osg::StateSet> stateSet;
+    Bathymetry *bathymetry;
+};
+
+#endif // SEABED_H
@@ -0,0 +1,110 @@
+#include "videorecorder.h"
+#include <QDebug>
+#include <string.h>
+
+VideoRecorder::VideoRecorder(QObject *parent) : QThread(parent),
+    width(0), height(0), stopping(true), written(0), dropped(0)
+{
+}
+
+VideoRecorder::~VideoRecorder() {
+    close();
+    qDeleteAll(freeFrames);
+}
+
+bool VideoRecorder::open(const QString &fileName, int w, int h, int fps) {
+    close();
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Can't record video to" << fileName << file.errorString();
+        return false;
+    }
+    width = w;
+    height = h;
+    QByteArray header = QByteArray("YUV4MPEG2 W") + QByteArray::number(width) + " H" + QByteArray::number(height)
+            + " F" + QByteArray::number(fps) + ":1 Ip A1:1 C444\n";
+    file.write(header);
+    mutex.lock();
+    qDeleteAll(freeFrames);
+    freeFrames.clear();
+    for(int i=0;i<VIDEO_QUEUE_FRAMES;i++)
+        freeFrames.append(new QByteArray(width * height * 3, 0));
+    written = dropped = 0;
+    stopping = false;
+    mutex.unlock();
+    start(QThread::LowPriority);
+    return true;
+}
+
+// Once stopping is set under the mutex addFrame() queues nothing more, so
+// after the writer has drained the queue every buffer is back in the pool
+void VideoRecorder::close() {
+    mutex.lock();
+    stopping = true;
+    frameQueued.wakeOne();
+    mutex.unlock();
+    wait();
+    QMutexLocker locker(&mutex);
+    freeFrames += queuedFrames;
+    queuedFrames.clear();
+    if(!file.isOpen()) return;
+    file.close();
+    qDebug() << Q_FUNC_INFO << written << "frames written," << dropped << "dropped";
+}
+
+// The copy is made under the mutex so that close() and open() can't swap
+// the pool out from under a frame being filled. The writer only holds the
+// mutex to take and return buffers, so it is never kept waiting for long.
+bool VideoRecorder::addFrame(const uchar *rgb) {
+    QMutexLocker locker(&mutex);
+    if(stopping) return false;
+    if(freeFrames.isEmpty()) {
+        dropped++;
+        return false;
+    }
+    QByteArray *frame = freeFrames.takeLast();
+    memcpy(frame->data(), rgb, frame->size());
+    queuedFrames.append(frame);
+    frameQueued.wakeOne();
+    return true;
+}
+
+void VideoRecorder::run() {
+    forever {
+        mutex.lock();
+        while(queuedFrames.isEmpty() && !stopping)
+            frameQueued.wait(&mutex);
+        if(queuedFrames.isEmpty()) {
+            mutex.unlock();
+            break;
+        }
+        QByteArray *frame = queuedFrames.takeFirst();
+        mutex.unlock();
+
+        encode(*frame);
+        file.write(buffer);
+
+        mutex.lock();
+        freeFrames.append(frame);
+        written++;
+        mutex.unlock();
+    }
+    file.flush();
+}
+
+// BT.601 studio range, rows flipped to top-down
+void VideoRecorder::encode(const QByteArray &rgb) {
+    int plane = width * height;
+    buffer.resize(6 + plane * 3);
+    memcpy(buffer.data(), "FRAME\n", 6);
+    uchar *y = (uchar*) buffer.data() + 6, *u = y + plane, *v = u + plane;
+    for(int row=0;row<height;row++) {
+        const uchar *p = (const uchar*) rgb.constData() + (height - 1 - row) * width * 3;
+        for(int col=0;col<width;col++, p+=3) {
+            int r = p[0], g = p[1], b = p[2];
+            *y++ = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            *u++ = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            *v++ = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
+}
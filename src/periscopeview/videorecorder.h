@@ -0,0 +1,61 @@
+#ifndef VIDEORECORDER_H
+#define VIDEORECORDER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QList>
+#include <QByteArray>
+
+// Frames waiting for the encoder; more than this and new frames are dropped
+#define VIDEO_QUEUE_FRAMES 8
+
+/*
+ * Writes rendered frames to a YUV4MPEG2 (.y4m) file, uncompressed 4:4:4,
+ * which ffmpeg and most players read as is.
+ *
+ * The render thread only copies the frame into a free buffer and queues
+ * it; colour conversion and file IO run on the recorder's own thread. The
+ * buffers are a fixed pool, so when the encoder falls behind frames are
+ * dropped instead of stalling rendering.
+ */
+class VideoRecorder : public QThread
+{
+    Q_OBJECT
+public:
+    explicit VideoRecorder(QObject *parent = 0);
+    ~VideoRecorder();
+
+    bool open(const QString &fileName, int width, int height, int fps = 20);
+    void close();
+    bool isRecording() const { return isRunning(); }
+    int frameWidth() const { return width; }
+    int frameHeight() const { return height; }
+
+    // Queues a bottom-up RGB frame as glReadPixels returns it. False if
+    // the frame was dropped.
+    bool addFrame(const uchar *rgb);
+    int framesWritten() const { return written; }
+    int framesDropped() const { return dropped; }
+
+protected:
+    virtual void run();
+
+private:
+    void encode(const QByteArray &rgb);
+
+    QFile file;
+    int width, height;
+
+    QMutex mutex;
+    QWaitCondition frameQueued;
+    QList<QByteArray*> queuedFrames, freeFrames;
+    bool stopping;
+    int written, dropped;
+
+    // Writer thread only
+    QByteArray buffer;
+};
+
+#endif // VIDEORECORDER_H
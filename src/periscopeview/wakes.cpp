@@ -0,0 +1,216 @@
+#include "wakes.h"
+#include "../simulation/vessel.h"
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Texture2D>
+#include <osg/BlendFunc>
+#include <osg/Depth>
+#include <osgDB/ReadFile>
+#include <QDebug>
+#include <math.h>
+
+// Slots allocated at first, doubled when they run out
+#define WAKE_SLOTS 32
+// Seconds a point takes to fade out, and how fast the wake widens: the
+// half width grows by WAKE_SPREAD of its starting value per second
+#define WAKE_LIFETIME (WAKE_POINTS * WAKE_INTERVAL)
+#define WAKE_SPREAD 0.05
+// Starting half widths, the bow's distance ahead of the vessel's position,
+// and the height of the foam over mean sea level
+#define WAKE_SHIP_WIDTH 6.0
+#define WAKE_TORPEDO_WIDTH 0.6
+#define WAKE_SHIP_BOW 40.0
+#define WAKE_TORPEDO_BOW 3.0
+#define WAKE_HEIGHT 0.3
+// Speed at which the foam is fully opaque, and meters of wake per texture
+#define WAKE_FULL_SPEED 10.0
+#define WAKE_TEXTURE_LENGTH 60.0
+// Birth time of points that are not part of a wake
+#define WAKE_UNUSED -1e6
+
+// Points widen and fade with age; unused points are so old they are
+// fully transparent
+static const char *wakeVertexShader =
+        "uniform float wakeTime;\n"
+        "uniform float wakeSpread;\n"
+        "uniform float wakeLifetime;\n"
+        "varying vec2 texCoord;\n"
+        "varying float alpha;\n"
+        "void main() {\n"
+        "    float age = max(wakeTime - gl_MultiTexCoord0.z, 0.0);\n"
+        "    vec3 position = gl_Vertex.xyz + gl_Normal * (1.0 + wakeSpread * min(age, wakeLifetime));\n"
+        "    alpha = gl_Color.a * clamp(1.0 - age / wakeLifetime, 0.0, 1.0);\n"
+        "    texCoord = gl_MultiTexCoord0.xy;\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 1.0);\n"
+        "}\n";
+
+// The foam texture's brightness is the foam's coverage
+static const char *wakeFragmentShader =
+        "uniform sampler2D foam;\n"
+        "varying vec2 texCoord;\n"
+        "varying float alpha;\n"
+        "void main() {\n"
+        "    vec4 texel = texture2D(foam, texCoord);\n"
+        "    float coverage = dot(texel.rgb, vec3(0.333));\n"
+        "    gl_FragColor = vec4(0.92, 0.95, 0.97, coverage * alpha);\n"
+        "}\n";
+
+Wakes::Wakes() :
+    geode(new osg::Geode), geometry(new osg::Geometry),
+    centers(new osg::Vec3Array), sides(new osg::Vec3Array), texCoords(new osg::Vec3Array), colors(new osg::Vec4Array),
+    indices(new osg::DrawElementsUInt(GL_TRIANGLES)), timeUniform(new osg::Uniform("wakeTime", 0.f)),
+    time(0), capacity(0)
+{
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setDataVariance(osg::Object::DYNAMIC);
+    geometry->setVertexArray(centers.get());
+    geometry->setNormalArray(sides.get());
+    geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+    geometry->setTexCoordArray(0, texCoords.get());
+    geometry->setColorArray(colors.get());
+    geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(indices.get());
+    // Wakes move with their vessels anywhere in the world
+    geometry->setInitialBound(osg::BoundingBox(-1e6, -1e6, -10, 1e6, 1e6, 10));
+    grow();
+    geode->addDrawable(geometry.get());
+
+    osg::StateSet *stateSet = geode->getOrCreateStateSet();
+    osg::Program *program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, wakeVertexShader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, wakeFragmentShader));
+    stateSet->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+    stateSet->addUniform(timeUniform.get());
+    stateSet->addUniform(new osg::Uniform("foam", 0));
+    stateSet->addUniform(new osg::Uniform("wakeSpread", (float) WAKE_SPREAD));
+    stateSet->addUniform(new osg::Uniform("wakeLifetime", (float) WAKE_LIFETIME));
+    osg::Image *foam = osgDB::readImageFile("resources/textures/sea_foam.png");
+    if(!foam) {
+        qDebug() << Q_FUNC_INFO << "can't load resources/textures/sea_foam.png";
+    } else {
+        osg::Texture2D *texture = new osg::Texture2D(foam);
+        texture->setWrap(osg::Texture2D::WRAP_S, osg::Texture2D::REPEAT);
+        texture->setWrap(osg::Texture2D::WRAP_T, osg::Texture2D::REPEAT);
+        stateSet->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+    }
+    stateSet->setAttributeAndModes(new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), osg::StateAttribute::ON);
+    stateSet->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0, 1, false), osg::StateAttribute::ON);
+    stateSet->setMode(GL_CULL_FACE, osg::StateAttribute::OFF);
+    stateSet->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+}
+
+osg::Geode& Wakes::getGeode() {
+    return *geode;
+}
+
+void Wakes::setTime(double seconds) {
+    time = seconds;
+    timeUniform->set((float) time);
+}
+
+// Doubles the slots; the new ones go to the free list with their points
+// unused, and their quads are added to the index array
+void Wakes::grow() {
+    int newCapacity = capacity ? capacity * 2 : WAKE_SLOTS;
+    int vertices = newCapacity * WAKE_POINTS * 2;
+    centers->resize(vertices);
+    sides->resize(vertices);
+    texCoords->resize(vertices);
+    colors->resize(vertices);
+    trails.resize(newCapacity);
+    for(int slot=newCapacity-1;slot>=capacity;slot--) {
+        for(int point=0;point<WAKE_POINTS;point++)
+            writePoint(slot, point, osg::Vec3d(), osg::Vec3(), WAKE_UNUSED, 0, 0);
+        for(int point=0;point<WAKE_POINTS;point++) {
+            unsigned int a = (slot * WAKE_POINTS + point) * 2;
+            unsigned int b = (slot * WAKE_POINTS + (point + 1) % WAKE_POINTS) * 2;
+            indices->push_back(a);
+            indices->push_back(a + 1);
+            indices->push_back(b);
+            indices->push_back(b);
+            indices->push_back(a + 1);
+            indices->push_back(b + 1);
+        }
+        freeSlots.append(slot);
+    }
+    capacity = newCapacity;
+    indices->dirty();
+}
+
+int Wakes::allocateSlot() {
+    if(freeSlots.isEmpty())
+        grow();
+    return freeSlots.takeLast();
+}
+
+void Wakes::writePoint(int slot, int point, const osg::Vec3d &bow, const osg::Vec3 &side, double birth,
+                       float along, float intensity) {
+    int i = (slot * WAKE_POINTS + point) * 2;
+    osg::Vec3 center(bow.x(), bow.y(), WAKE_HEIGHT);
+    (*centers)[i] = (*centers)[i + 1] = center;
+    (*sides)[i] = side;
+    (*sides)[i + 1] = -side;
+    (*texCoords)[i] = osg::Vec3(0, along, birth);
+    (*texCoords)[i + 1] = osg::Vec3(1, along, birth);
+    (*colors)[i] = (*colors)[i + 1] = osg::Vec4(1, 1, 1, intensity);
+}
+
+void Wakes::update(Vessel *vessel, const osg::Vec3d &position, double heading, double speed) {
+    QMap<Vessel*, int>::iterator found = slots.find(vessel);
+    bool fresh = found == slots.end();
+    int slot = fresh ? allocateSlot() : found.value();
+    if(fresh) slots.insert(vessel, slot);
+    Trail &trail = trails[slot];
+
+    bool torpedo = vessel->type == 2;
+    double h = osg::DegreesToRadians(heading);
+    osg::Vec3d direction(sin(h), cos(h), 0);
+    osg::Vec3 side = osg::Vec3(cos(h), -sin(h), 0) * (torpedo ? WAKE_TORPEDO_WIDTH : WAKE_SHIP_WIDTH);
+    osg::Vec3d bow = position + direction * (torpedo ? WAKE_TORPEDO_BOW : WAKE_SHIP_BOW);
+    float intensity = qMin(fabs(speed) / WAKE_FULL_SPEED, 1.0);
+
+    if(fresh) {
+        trail.head = 0;
+        trail.pointTime = time;
+        trail.along = 0;
+    } else {
+        trail.along += (bow - trail.lastBow).length();
+        // The head point stays where it is and a new one starts at the bow
+        if(time - trail.pointTime >= WAKE_INTERVAL) {
+            trail.head = (trail.head + 1) % WAKE_POINTS;
+            trail.pointTime = time;
+        }
+    }
+    trail.lastBow = bow;
+    float along = trail.along / WAKE_TEXTURE_LENGTH;
+    writePoint(slot, trail.head, bow, side, time, along, intensity);
+    // The oldest point sits on the head unseen, so the ring doesn't close
+    // back to the end of the wake
+    writePoint(slot, (trail.head + 1) % WAKE_POINTS, bow, side, WAKE_UNUSED, along, 0);
+    centers->dirty();
+    sides->dirty();
+    texCoords->dirty();
+    colors->dirty();
+}
+
+void Wakes::remove(Vessel *vessel) {
+    QMap<Vessel*, int>::iterator found = slots.find(vessel);
+    if(found == slots.end()) return;
+    int slot = found.value();
+    slots.erase(found);
+    for(int point=0;point<WAKE_POINTS;point++)
+        writePoint(slot, point, osg::Vec3d(), osg::Vec3(), WAKE_UNUSED, 0, 0);
+    freeSlots.append(slot);
+    texCoords->dirty();
+    colors->dirty();
+}
+
+void Wakes::shift(const osg::Vec3d &offset) {
+    osg::Vec3 delta(offset.x(), offset.y(), 0);
+    for(unsigned int i=0;i<centers->size();i++)
+        (*centers)[i] += delta;
+    for(int i=0;i<trails.size();i++)
+        trails[i].lastBow += offset;
+    centers->dirty();
+}
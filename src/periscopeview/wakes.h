@@ -0,0 +1,66 @@
+#ifndef WAKES_H
+#define WAKES_H
+
+#include <QMap>
+#include <QVector>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Uniform>
+
+class Vessel;
+
+// Trail points kept per vessel, and seconds between them; a wake is as
+// long as the vessel sailed in WAKE_POINTS * WAKE_INTERVAL seconds
+#define WAKE_POINTS 48
+#define WAKE_INTERVAL 2.0
+
+/*
+ * Foam wakes behind every moving vessel, all drawn as one geometry.
+ *
+ * Each vessel owns a slot of WAKE_POINTS trail points in shared vertex
+ * arrays, used as a ring: the newest point rides on the bow and a new one
+ * starts every WAKE_INTERVAL seconds, overwriting the oldest. The index
+ * array never changes. Widening and fading by age happen in the vertex
+ * shader, so a tick only writes the two points at the head of each ring
+ * and the cost doesn't grow with how long the vessels have sailed.
+ */
+class Wakes
+{
+public:
+    Wakes();
+    osg::Geode& getGeode();
+    // Seconds of simulated time, the clock wake ages are measured with
+    void setTime(double seconds);
+    // Position in render space, heading in degrees
+    void update(Vessel *vessel, const osg::Vec3d &position, double heading, double speed);
+    void remove(Vessel *vessel);
+    // Moves every trail point, when the render space origin moves
+    void shift(const osg::Vec3d &offset);
+
+private:
+    struct Trail
+    {
+        int head;
+        double pointTime, along;
+        osg::Vec3d lastBow;
+    };
+    int allocateSlot();
+    void grow();
+    void writePoint(int slot, int point, const osg::Vec3d &bow, const osg::Vec3 &side, double birth,
+                    float along, float intensity);
+
+    osg::ref_ptr<osg::Geode> geode;
+    osg::ref_ptr<osg::Geometry> geometry;
+    osg::ref_ptr<osg::Vec3Array> centers, sides, texCoords;
+    osg::ref_ptr<osg::Vec4Array> colors;
+    osg::ref_ptr<osg::DrawElementsUInt> indices;
+    osg::ref_ptr<osg::Uniform> timeUniform;
+    double time;
+    int capacity;
+    QMap<Vessel*, int> slots;
+    QVector<Trail> trails;
+    QVector<int> freeSlots;
+};
+
+#endif // WAKES_H
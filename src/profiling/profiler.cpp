@@ -0,0 +1,197 @@
+#include "profiler.h"
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+#include <time.h>
+
+struct TraceEvent
+{
+    qint64 start, duration;
+    int zone;
+};
+
+class ThreadProfile
+{
+public:
+    explicit ThreadProfile(int id) : id(id), traceHead(0) {
+        memset(buckets, 0, sizeof(buckets));
+        memset(totalNs, 0, sizeof(totalNs));
+        memset(maxNs, 0, sizeof(maxNs));
+    }
+
+    // Only the owning thread writes these
+    int id;
+    quint32 buckets[PROFILER_MAX_ZONES][PROFILER_BUCKETS];
+    qint64 totalNs[PROFILER_MAX_ZONES];
+    qint64 maxNs[PROFILER_MAX_ZONES];
+    TraceEvent trace[PROFILER_TRACE_EVENTS];
+    // Number of events ever written, trace[head % size] is the next slot
+    QAtomicInt traceHead;
+};
+
+// QThreadStorage deletes its data when the thread exits, but the samples
+// must outlive the thread, so it only owns this handle.
+struct ThreadProfileHandle
+{
+    ThreadProfile *profile;
+};
+
+Profiler::Profiler() : zoneCount(0)
+{
+}
+
+Profiler *Profiler::instance() {
+    static Profiler profiler;
+    return &profiler;
+}
+
+qint64 Profiler::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Bucket b holds durations below 2^b microseconds
+int Profiler::bucketFor(qint64 durationNs) {
+    quint64 us = durationNs >> 10;
+    int b = 0;
+    if(us >= (Q_UINT64_C(1) << 16)) { us >>= 16; b += 16; }
+    if(us >= (1 << 8)) { us >>= 8; b += 8; }
+    if(us >= (1 << 4)) { us >>= 4; b += 4; }
+    if(us >= (1 << 2)) { us >>= 2; b += 2; }
+    if(us >= (1 << 1)) { us >>= 1; b += 1; }
+    b += us;
+    return qMin(b, PROFILER_BUCKETS - 1);
+}
+
+int Profiler::zone(const char *name) {
+    QMutexLocker locker(&mutex);
+    int count = zoneCount;
+    for(int i=0;i<count;i++) {
+        if(zoneNames[i] == name)
+            return i;
+    }
+    Q_ASSERT(count < PROFILER_MAX_ZONES);
+    if(count >= PROFILER_MAX_ZONES)
+        return PROFILER_MAX_ZONES - 1;
+    zoneNames[count] = name;
+    zoneCount.fetchAndStoreRelease(count + 1);
+    return count;
+}
+
+QString Profiler::zoneName(int zone) {
+    if(zone < 0 || zone >= (int) zoneCount) return QString();
+    return QString::fromLatin1(zoneNames[zone].constData());
+}
+
+ThreadProfile *Profiler::threadProfile() {
+    if(!current.hasLocalData()) {
+        ThreadProfileHandle *handle = new ThreadProfileHandle;
+        QMutexLocker locker(&mutex);
+        handle->profile = new ThreadProfile(threads.size() + 1);
+        threads.append(handle->profile);
+        current.setLocalData(handle);
+    }
+    return current.localData()->profile;
+}
+
+void Profiler::record(int zone, qint64 startNs, qint64 durationNs) {
+    ThreadProfile *tp = threadProfile();
+    tp->buckets[zone][bucketFor(durationNs)]++;
+    tp->totalNs[zone] += durationNs;
+    if(durationNs > tp->maxNs[zone])
+        tp->maxNs[zone] = durationNs;
+
+    int head = tp->traceHead;
+    TraceEvent &e = tp->trace[(quint32)head % PROFILER_TRACE_EVENTS];
+    e.start = startNs;
+    e.duration = durationNs;
+    e.zone = zone;
+    tp->traceHead.fetchAndStoreRelease(head + 1);
+}
+
+static double percentile(const quint64 *buckets, quint64 count, double p) {
+    quint64 target = (quint64)(count * p);
+    quint64 seen = 0;
+    for(int b=0;b<PROFILER_BUCKETS;b++) {
+        seen += buckets[b];
+        if(seen > target) {
+            // Geometric middle of [2^(b-1), 2^b) microseconds
+            if(b == 0) return 0.0005;
+            return (1 << (b - 1)) * 1.41421356 / 1000.0;
+        }
+    }
+    return 0;
+}
+
+QList<ProfileZoneStats> Profiler::stats() {
+    QList<ProfileZoneStats> result;
+    QMutexLocker locker(&mutex);
+    int count = zoneCount;
+    for(int z=0;z<count;z++) {
+        quint64 buckets[PROFILER_BUCKETS];
+        memset(buckets, 0, sizeof(buckets));
+        quint64 samples = 0;
+        qint64 totalNs = 0, maxNs = 0;
+        foreach(ThreadProfile *tp, threads) {
+            for(int b=0;b<PROFILER_BUCKETS;b++) {
+                buckets[b] += tp->buckets[z][b];
+                samples += tp->buckets[z][b];
+            }
+            totalNs += tp->totalNs[z];
+            maxNs = qMax(maxNs, tp->maxNs[z]);
+        }
+        if(!samples) continue;
+        ProfileZoneStats s;
+        s.name = QString::fromLatin1(zoneNames[z].constData());
+        s.count = samples;
+        s.totalMs = totalNs / 1e6;
+        s.maxMs = maxNs / 1e6;
+        s.p50Ms = percentile(buckets, samples, 0.5);
+        s.p95Ms = percentile(buckets, samples, 0.95);
+        s.p99Ms = percentile(buckets, samples, 0.99);
+        result.append(s);
+    }
+    return result;
+}
+
+QString Profiler::summary() {
+    QString text;
+    foreach(const ProfileZoneStats &s, stats()) {
+        text += QString("%1  avg %2  p95 %3  max %4 ms\n")
+                .arg(s.name)
+                .arg(s.totalMs / s.count, 0, 'f', 3)
+                .arg(s.p95Ms, 0, 'f', 3)
+                .arg(s.maxMs, 0, 'f', 3);
+    }
+    return text;
+}
+
+bool Profiler::writeChromeTrace(const QString &fileName) {
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Profiler: can't write %s", qPrintable(fileName));
+        return false;
+    }
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    QMutexLocker locker(&mutex);
+    foreach(ThreadProfile *tp, threads) {
+        quint32 head = (int) tp->traceHead;
+        // The oldest events may be overwritten while we read, skip a margin
+        quint32 n = qMin<quint32>(head, PROFILER_TRACE_EVENTS - 64);
+        for(quint32 i=head-n;i!=head;i++) {
+            const TraceEvent &e = tp->trace[i % PROFILER_TRACE_EVENTS];
+            if(!first) out << ",\n";
+            first = false;
+            out << "{\"name\":\"" << zoneNames[e.zone].constData()
+                << "\",\"cat\":\"vesikko\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tp->id
+                << ",\"ts\":" << QString::number(e.start / 1000.0, 'f', 3)
+                << ",\"dur\":" << QString::number(e.duration / 1000.0, 'f', 3) << "}";
+        }
+    }
+    out << "\n]}\n";
+    qDebug() << Q_FUNC_INFO << "wrote" << fileName;
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThreadStorage>
+
+/*
+ * Always-on timing of named zones (sim tick, view updates, render passes).
+ *
+ * Every thread records into its own ThreadProfile, so the hot path never
+ * takes a lock: a scope costs two clock reads, one histogram bucket
+ * increment and one store into the thread's trace ring. Readers (the
+ * overlay, the trace dump) only look at the data and tolerate a sample
+ * being in flight.
+ */
+
+#define PROFILER_MAX_ZONES 64
+#define PROFILER_BUCKETS 32
+#define PROFILER_TRACE_EVENTS 16384
+
+struct ProfileZoneStats
+{
+    QString name;
+    qint64 count;
+    double totalMs, maxMs;
+    double p50Ms, p95Ms, p99Ms;
+};
+
+class ThreadProfile;
+struct ThreadProfileHandle;
+
+class Profiler
+{
+public:
+    static Profiler *instance();
+
+    // Returns the id for the zone, creating it on first use. Cheap enough to
+    // call every time, but PROFILE_SCOPE caches it in a static.
+    int zone(const char *name);
+    QString zoneName(int zone);
+
+    // Records a duration measured elsewhere, e.g. by osg's own stats.
+    void record(int zone, qint64 startNs, qint64 durationNs);
+
+    // Histogram summary of every zone that has samples, merged over threads.
+    QList<ProfileZoneStats> stats();
+    // Multiline text summary for overlays.
+    QString summary();
+    // Writes the trace rings as Chrome trace (chrome://tracing) JSON.
+    bool writeChromeTrace(const QString &fileName);
+
+    static qint64 now();
+    static int bucketFor(qint64 durationNs);
+
+private:
+    Profiler();
+    ThreadProfile *threadProfile();
+
+    QMutex mutex;
+    QAtomicInt zoneCount;
+    QByteArray zoneNames[PROFILER_MAX_ZONES];
+    QList<ThreadProfile*> threads;
+    QThreadStorage<ThreadProfileHandle*> current;
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(int zone) : zone(zone), start(Profiler::now()) {}
+    ~ProfileScope() {
+        Profiler::instance()->record(zone, start, Profiler::now() - start);
+    }
+private:
+    int zone;
+    qint64 start;
+};
+
+#define PROFILER_CAT2(a, b) a##b
+#define PROFILER_CAT(a, b) PROFILER_CAT2(a, b)
+
+// Times the rest of the enclosing block as zone "name" (a string literal).
+#define PROFILE_SCOPE(name) \
+    static const int PROFILER_CAT(profileZone_, __LINE__) = Profiler::instance()->zone(name); \
+    ProfileScope PROFILER_CAT(profileScope_, __LINE__)(PROFILER_CAT(profileZone_, __LINE__))
+
+#endif // PROFILER_H
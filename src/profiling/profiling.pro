@@ -0,0 +1,7 @@
+TEMPLATE=lib
+TARGET=profiling
+CONFIG += staticlib
+QT -= gui
+
+SOURCES += profiler.cpp
+HEADERS += profiler.h
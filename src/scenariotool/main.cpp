@@ -0,0 +1,221 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QTime>
+#include <QVector>
+#include <QDir>
+#include <QFile>
+#include <stdlib.h>
+#include <math.h>
+#include "../simulation/scenario.h"
+#include "../simulation/vessel.h"
+#include "../simulation/bathymetry.h"
+
+static QTextStream out(stdout);
+
+static int usage() {
+    out << "Usage: vesikko-scenario compile <in.txt> <out.vsc>\n"
+           "       vesikko-scenario decompile <in.vsc> <out.txt>\n"
+           "       vesikko-scenario generate <count> <out.vsc|out.txt> [radius]\n"
+           "       vesikko-scenario bench <scenario> [rounds]\n"
+           "       vesikko-scenario bathymetry <out.vbt> [size] [cell]\n"
+           "       vesikko-scenario check\n";
+    return 1;
+}
+
+static bool isBinaryName(const QString &fileName) {
+    return fileName.endsWith(".vsc");
+}
+
+static bool write(const QString &fileName, const ScenarioRecord *records, int count) {
+    bool ok = isBinaryName(fileName) ? Scenario::writeBinary(fileName, records, count)
+                                     : Scenario::writeText(fileName, records, count);
+    if(!ok) out << "Can't write " << fileName << "\n";
+    return ok;
+}
+
+static int convert(const QString &in, const QString &outName) {
+    Scenario scenario;
+    if(!scenario.open(in)) {
+        out << in << ": " << scenario.errorString() << "\n";
+        return 1;
+    }
+    if(!write(outName, scenario.records(), scenario.count())) return 1;
+    out << "Wrote " << scenario.count() << " vessels to " << outName << "\n";
+    return 0;
+}
+
+// Convoys spread evenly over a disc, on random courses: a guide, four
+// merchants in formation behind it and a zig-zagging escort
+static int generate(int count, const QString &outName, double radius) {
+    QVector<ScenarioRecord> records(count);
+    for(int i=0;i<count;i++) {
+        ScenarioRecord &r = records[i];
+        memset(&r, 0, sizeof(r));
+        r.type = 1;
+        int member = i % 6;
+        if(member == 0) {
+            double a = drand48() * 2 * M_PI;
+            double d = sqrt(drand48()) * radius;
+            r.x = sin(a) * d;
+            r.y = cos(a) * d;
+            r.heading = drand48() * 360;
+            r.speed = r.speedCommand = 5 + 5 * drand48();
+            r.behaviour = ShipTransit;
+            continue;
+        }
+        const ScenarioRecord &guide = records[i - member];
+        double h = guide.heading * (M_PI/180.0);
+        // Meters to the right of and ahead of the guide
+        double right = member < 5 ? ((member & 1) ? -300 : 300) : 800;
+        double ahead = member < 5 ? -400 * ((member + 1) / 2) : 0;
+        r.x = guide.x + right * cos(h) + ahead * sin(h);
+        r.y = guide.y + right * sin(h) - ahead * cos(h);
+        r.heading = guide.heading;
+        r.speed = r.speedCommand = guide.speed;
+        r.behaviour = member < 5 ? ShipConvoy : ShipZigZag;
+    }
+    if(!write(outName, records.constData(), count)) return 1;
+    out << "Wrote " << count << " vessels to " << outName << "\n";
+    return 0;
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &data) {
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+}
+
+// Scenarios that must not load: anything but ships would be constructed as
+// a plain Vessel and then used as a torpedo or a sub by the simulation.
+// Writes each case to a temporary file, text and binary, and opens it.
+static int check() {
+    QString dir = QDir::tempPath();
+    int failures = 0;
+    const char *badLines[] = {
+        "torpedo 0 0 0 0 0 0\n",
+        "sub 0 0 0 0 0 0\n",
+        "7 0 0 0 0 0 0\n",
+        "ship 0 0 0 0 0 0 0 sideways\n"
+    };
+    for(int i=0;i<4;i++) {
+        QString fileName = dir + "/vesikko-check.txt";
+        writeFile(fileName, QByteArray("ship 0 0 0 0 0 0\n") + badLines[i]);
+        Scenario scenario;
+        bool loaded = scenario.open(fileName);
+        out << "text " << QString(badLines[i]).trimmed() << ": " << (loaded ? "LOADED" : "rejected") << "\n";
+        if(loaded) failures++;
+        QFile::remove(fileName);
+    }
+    ScenarioRecord records[2];
+    memset(records, 0, sizeof(records));
+    records[0].type = records[1].type = 1;
+    const int badTypes[] = { 0, 2, 1 }, badBehaviours[] = { ShipTransit, ShipTransit, 7 };
+    for(int i=0;i<3;i++) {
+        QString fileName = dir + "/vesikko-check.vsc";
+        records[1].type = badTypes[i];
+        records[1].behaviour = badBehaviours[i];
+        Scenario::writeBinary(fileName, records, 2);
+        Scenario scenario;
+        bool loaded = scenario.open(fileName);
+        out << "binary type=" << badTypes[i] << " ai=" << badBehaviours[i] << ": "
+            << (loaded ? "LOADED" : "rejected") << "\n";
+        if(loaded) failures++;
+        QFile::remove(fileName);
+    }
+    out << (failures ? "FAIL" : "ok") << "\n";
+    return failures ? 1 : 0;
+}
+
+// Smoothed random lattice, 0..1
+static double valueNoise(double x, double y, int seed) {
+    int ix = (int) floor(x), iy = (int) floor(y);
+    double fx = x - ix, fy = y - iy;
+    fx = fx * fx * (3 - 2 * fx);
+    fy = fy * fy * (3 - 2 * fy);
+    double corner[4];
+    for(int i=0;i<4;i++) {
+        quint32 h = (quint32) (ix + (i & 1)) * 73856093u ^ (quint32) (iy + (i >> 1)) * 19349663u ^ (quint32) seed * 83492791u;
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        corner[i] = (h & 0xffff) / 65535.0;
+    }
+    double south = corner[0] + (corner[1] - corner[0]) * fx;
+    double north = corner[2] + (corner[3] - corner[2]) * fx;
+    return south + (north - south) * fy;
+}
+
+// A size x size meter seabed centered on the origin: deep basins, shoals
+// and the odd island, kept deep around the origin where the sub starts
+static int generateBathymetry(const QString &outName, double size, double cell) {
+    const double wavelengths[] = { 20000, 8000, 3000, 1200, 500 };
+    const double amplitudes[] = { 60, 30, 15, 6, 3 };
+    BathymetryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.tileSize = 64;
+    header.levels = 3;
+    header.tilesX = header.tilesY = qMax(1, (int) ceil(size / cell / header.tileSize));
+    header.cellSize = cell;
+    header.originX = header.originY = -(double) header.tilesX * header.tileSize * cell / 2;
+    header.openSeaDepth = 80;
+    int samples = header.tilesX * header.tileSize + 1;
+    QVector<float> depths(samples * samples);
+    for(int j=0;j<samples;j++) {
+        double y = header.originY + j * cell;
+        for(int i=0;i<samples;i++) {
+            double x = header.originX + i * cell;
+            double d = 70;
+            for(int o=0;o<5;o++)
+                d += amplitudes[o] * (valueNoise(x / wavelengths[o], y / wavelengths[o], o) - 0.5) * 2;
+            double r = sqrt(x * x + y * y);
+            d = qMax(d, 60 * qBound(0.0, (4000 - r) / 1000, 1.0));
+            depths[j * samples + i] = d;
+        }
+    }
+    if(!Bathymetry::write(outName, header, depths)) return 1;
+    out << "Wrote " << samples << "x" << samples << " depths in " << header.tilesX * header.tilesY
+        << " tiles to " << outName << "\n";
+    return 0;
+}
+
+// Times what Simulation::loadScenario does: map/parse and construct the vessels
+static int bench(const QString &fileName, int rounds) {
+    qint64 vessels = 0;
+    QTime time;
+    time.start();
+    for(int i=0;i<rounds;i++) {
+        Scenario scenario;
+        if(!scenario.open(fileName)) {
+            out << fileName << ": " << scenario.errorString() << "\n";
+            return 1;
+        }
+        Vessel *block = scenario.createVessels(1);
+        vessels += scenario.count();
+        delete[] block;
+    }
+    int ms = qMax(1, time.elapsed());
+    out << fileName << ": " << vessels / rounds << " vessels, " << rounds << " rounds, "
+        << (double) ms / rounds << " ms/round, "
+        << QString::number(vessels * 1000.0 / ms, 'f', 0) << " vessels/s\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    if(args.size() == 2 && args[1] == "check")
+        return check();
+    if(args.size() < 3) return usage();
+    QString command = args[1];
+    if((command == "compile" || command == "decompile") && args.size() == 4)
+        return convert(args[2], args[3]);
+    if(command == "generate" && args.size() >= 4)
+        return generate(args[2].toInt(), args[3], args.size() > 4 ? args[4].toDouble() : 50000);
+    if(command == "bathymetry")
+        return generateBathymetry(args[2], args.size() > 3 ? args[3].toDouble() : 102400,
+                                  args.size() > 4 ? qMax(1.0, args[4].toDouble()) : 50);
+    if(command == "bench")
+        return bench(args[2], args.size() > 3 ? qMax(1, args[3].toInt()) : 10);
+    return usage();
+}
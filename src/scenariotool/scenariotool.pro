@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Converts scenarios between the text and the
+# memory-mapped binary form, measures loading and
+# generates bathymetry files
+#
+#-------------------------------------------------
+
+QT -= gui
+
+TARGET = vesikko-scenario
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    ../simulation/scenario.cpp \
+    ../simulation/vessel.cpp \
+    ../simulation/bathymetry.cpp
+HEADERS += ../simulation/scenario.h \
+    ../simulation/vessel.h \
+    ../simulation/bathymetry.h
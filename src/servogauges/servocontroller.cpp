@@ -46,14 +46,14 @@ int ServoController::currentPos(int servo) {
 }
 
 
-bool ServoController::openSerial() {
+bool ServoController::openSerial(const char *device) {
     qDebug() << Q_FUNC_INFO;
     struct termios newtio;
 
     //open the device(com port) to be non-blocking (read will return immediately)
-    fd = open(DEVICENAME, O_WRONLY | O_NOCTTY);
+    fd = open(device, O_WRONLY | O_NOCTTY);
     if (fd < 0) {
-        perror(DEVICENAME);
+        perror(device);
         return false;
     } else {
         // set new port settings for canonical input processing
@@ -69,6 +69,6 @@ bool ServoController::openSerial() {
             setPosRaw(i, 127);
     }
 
-    qDebug() << Q_FUNC_INFO << DEVICENAME << "opened successfully";
+    qDebug() << Q_FUNC_INFO << device << "opened successfully";
     return true;
 }
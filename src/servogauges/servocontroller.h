@@ -19,7 +19,7 @@ public:
     void setPosRaw(int servo, int pos);
     void setPosScaled(int servo, double pos);
     int currentPos(int servo);
-    bool openSerial();
+    bool openSerial(const char *device = DEVICENAME);
 signals:
 
 public slots:
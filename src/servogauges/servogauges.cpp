@@ -1,5 +1,6 @@
 #include "servogauges.h"
 #include "../simulation/vessel.h"
+#include "../profiling/profiler.h"
 
 ServoGauges::ServoGauges(QObject *parent) :
     QObject(parent)
@@ -21,5 +22,6 @@ void ServoGauges::vesselUpdated(Vessel* vessel) {
 }
 
 void ServoGauges::updateServos() {
+    PROFILE_SCOPE("servo.update");
     controller.setPosScaled(0, 1.0d-speed / 30.0d);
 }
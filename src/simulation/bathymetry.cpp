@@ -0,0 +1,238 @@
+#include "bathymetry.h"
+#include "vessel.h"
+#include <QDebug>
+#include <QtAlgorithms>
+#include <math.h>
+#include <string.h>
+
+// Key of vessels outside the covered area in depthsAt()
+#define BATHYMETRY_NO_TILE 0xffffffffu
+
+static quint32 tileKey(int level, int tx, int ty) {
+    return ((quint32) level << 28) | ((quint32) ty << 14) | (quint32) tx;
+}
+
+static qint64 alignUp(qint64 offset) {
+    return (offset + BATHYMETRY_TILE_ALIGN - 1) / BATHYMETRY_TILE_ALIGN * BATHYMETRY_TILE_ALIGN;
+}
+
+Bathymetry::Bathymetry() : entryMap(0), entries(0), mapped(BATHYMETRY_MAPPED_TILES)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+Bathymetry::~Bathymetry() {
+    close();
+}
+
+void Bathymetry::close() {
+    QMutexLocker locker(&mutex);
+    mapped.clear();
+    if(entryMap)
+        file.unmap(entryMap);
+    entryMap = 0;
+    entries = 0;
+    levelStart.clear();
+    file.close();
+}
+
+bool Bathymetry::open(const QString &fileName) {
+    close();
+    error.clear();
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    if(file.read((char*) &header, sizeof(header)) != sizeof(header) || header.magic != BATHYMETRY_MAGIC) {
+        error = "not a bathymetry file";
+        close();
+        return false;
+    }
+    if(header.version != BATHYMETRY_VERSION || !header.tileSize || header.cellSize <= 0
+            || header.levels < 1 || header.levels > BATHYMETRY_MAX_LEVELS
+            || !header.tilesX || header.tilesX > BATHYMETRY_MAX_TILES
+            || !header.tilesY || header.tilesY > BATHYMETRY_MAX_TILES) {
+        error = "unsupported bathymetry file";
+        close();
+        return false;
+    }
+    int count = 0;
+    for(int level=0;level<levels();level++) {
+        levelStart.append(count);
+        count += tilesX(level) * tilesY(level);
+    }
+    qint64 size = (qint64) count * sizeof(BathymetryTileEntry);
+    if(file.size() < (qint64) sizeof(header) + size) {
+        error = "truncated bathymetry file";
+        close();
+        return false;
+    }
+    entryMap = file.map(sizeof(header), size);
+    if(!entryMap) {
+        error = file.errorString();
+        close();
+        return false;
+    }
+    entries = reinterpret_cast<const BathymetryTileEntry*>(entryMap);
+    return true;
+}
+
+int Bathymetry::tilesX(int level) const {
+    return (header.tilesX + (1 << level) - 1) >> level;
+}
+
+int Bathymetry::tilesY(int level) const {
+    return (header.tilesY + (1 << level) - 1) >> level;
+}
+
+const qint16 *Bathymetry::tile(int level, int tx, int ty) {
+    quint32 key = tileKey(level, tx, ty);
+    MappedTile *t = mapped.object(key);
+    if(t) return reinterpret_cast<const qint16*>(t->data);
+    qint64 bytes = (qint64) (header.tileSize + 1) * (header.tileSize + 1) * sizeof(qint16);
+    qint64 offset = entries[levelStart[level] + ty * tilesX(level) + tx].offset;
+    if(offset < 0 || offset + bytes > file.size()) {
+        error = "truncated bathymetry file";
+        return 0;
+    }
+    uchar *data = file.map(offset, bytes);
+    if(!data) {
+        error = file.errorString();
+        return 0;
+    }
+    t = new MappedTile(&file, data);
+    // Unmaps the least recently used tile when full
+    mapped.insert(key, t);
+    return reinterpret_cast<const qint16*>(data);
+}
+
+bool Bathymetry::locate(double x, double y, int level, int &tx, int &ty, double &fx, double &fy) const {
+    double width = (double) header.tilesX * header.tileSize * header.cellSize;
+    double height = (double) header.tilesY * header.tileSize * header.cellSize;
+    x -= header.originX;
+    y -= header.originY;
+    if(!(x >= 0 && x <= width && y >= 0 && y <= height)) return false;
+    double cell = cellSize(level);
+    double gx = x / cell, gy = y / cell;
+    int size = header.tileSize;
+    tx = qMin((int) gx / size, tilesX(level) - 1);
+    ty = qMin((int) gy / size, tilesY(level) - 1);
+    fx = qMin(gx - tx * size, (double) size);
+    fy = qMin(gy - ty * size, (double) size);
+    return true;
+}
+
+float Bathymetry::sample(const qint16 *samples, double fx, double fy) const {
+    int size = header.tileSize, stride = size + 1;
+    int ix = qMin((int) fx, size - 1), iy = qMin((int) fy, size - 1);
+    double ax = fx - ix, ay = fy - iy;
+    const qint16 *row = samples + iy * stride + ix;
+    double south = row[0] + (row[1] - row[0]) * ax;
+    double north = row[stride] + (row[stride + 1] - row[stride]) * ax;
+    return (south + (north - south) * ay) * 0.1;
+}
+
+float Bathymetry::depthAt(double x, double y, int level) {
+    if(!isOpen()) return header.openSeaDepth;
+    level = qBound(0, level, levels() - 1);
+    int tx, ty;
+    double fx, fy;
+    if(!locate(x, y, level, tx, ty, fx, fy)) return header.openSeaDepth;
+    QMutexLocker locker(&mutex);
+    const qint16 *samples = tile(level, tx, ty);
+    return samples ? sample(samples, fx, fy) : header.openSeaDepth;
+}
+
+void Bathymetry::depthsAt(const QVector<Vessel*> &vessels, QVector<float> &depths) {
+    depths.resize(vessels.size());
+    if(!isOpen()) {
+        depths.fill(header.openSeaDepth);
+        return;
+    }
+    QMutexLocker locker(&mutex);
+    order.resize(vessels.size());
+    for(int i=0;i<vessels.size();i++) {
+        int tx, ty;
+        double fx, fy;
+        quint32 key = locate(vessels[i]->x, vessels[i]->y, 0, tx, ty, fx, fy) ? tileKey(0, tx, ty) : BATHYMETRY_NO_TILE;
+        order[i] = ((quint64) key << 32) | (quint32) i;
+    }
+    qSort(order.begin(), order.end());
+    quint32 current = BATHYMETRY_NO_TILE;
+    const qint16 *samples = 0;
+    for(int n=0;n<order.size();n++) {
+        quint32 key = order[n] >> 32;
+        int i = (int) (order[n] & 0xffffffffu);
+        if(key == BATHYMETRY_NO_TILE) {
+            depths[i] = header.openSeaDepth;
+            continue;
+        }
+        int tx, ty;
+        double fx, fy;
+        locate(vessels[i]->x, vessels[i]->y, 0, tx, ty, fx, fy);
+        if(key != current) {
+            samples = tile(0, tx, ty);
+            current = key;
+        }
+        depths[i] = samples ? sample(samples, fx, fy) : header.openSeaDepth;
+    }
+}
+
+bool Bathymetry::write(const QString &fileName, const BathymetryHeader &h, const QVector<float> &depths) {
+    int size = h.tileSize;
+    int columns = h.tilesX * size + 1, rows = h.tilesY * size + 1;
+    if(!size || h.levels < 1 || h.levels > BATHYMETRY_MAX_LEVELS || h.tilesX > BATHYMETRY_MAX_TILES
+            || h.tilesY > BATHYMETRY_MAX_TILES || depths.size() != columns * rows) {
+        qWarning() << "Bathymetry::write: inconsistent header and depths";
+        return false;
+    }
+    QFile out(fileName);
+    if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Can't write" << fileName << out.errorString();
+        return false;
+    }
+    BathymetryHeader header = h;
+    header.magic = BATHYMETRY_MAGIC;
+    header.version = BATHYMETRY_VERSION;
+    header.reserved = 0;
+    out.write((const char*) &header, sizeof(header));
+
+    QVector<BathymetryTileEntry> entries;
+    for(quint32 level=0;level<header.levels;level++) {
+        int tilesX = (header.tilesX + (1 << level) - 1) >> level;
+        int tilesY = (header.tilesY + (1 << level) - 1) >> level;
+        entries.resize(entries.size() + tilesX * tilesY);
+    }
+    qint64 tileBytes = (qint64) (size + 1) * (size + 1) * sizeof(qint16);
+    qint64 offset = alignUp(sizeof(header) + entries.size() * sizeof(BathymetryTileEntry));
+    for(int i=0;i<entries.size();i++) {
+        entries[i].offset = offset;
+        offset = alignUp(offset + tileBytes);
+    }
+    out.write((const char*) entries.constData(), entries.size() * sizeof(BathymetryTileEntry));
+
+    // Samples past the edge of level 0 repeat its last row or column
+    QVector<qint16> tile((size + 1) * (size + 1));
+    int entry = 0;
+    for(quint32 level=0;level<header.levels;level++) {
+        int step = 1 << level;
+        int tilesX = (header.tilesX + step - 1) >> level;
+        int tilesY = (header.tilesY + step - 1) >> level;
+        for(int ty=0;ty<tilesY;ty++) {
+            for(int tx=0;tx<tilesX;tx++) {
+                for(int j=0;j<=size;j++) {
+                    int row = qMin((ty * size + j) * step, rows - 1);
+                    for(int i=0;i<=size;i++) {
+                        int column = qMin((tx * size + i) * step, columns - 1);
+                        double d = qBound(-3276.7, (double) depths[row * columns + column], 3276.7);
+                        tile[j * (size + 1) + i] = (qint16) qRound(d * 10);
+                    }
+                }
+                out.seek(entries[entry++].offset);
+                out.write((const char*) tile.constData(), tileBytes);
+            }
+        }
+    }
+    return out.error() == QFile::NoError;
+}
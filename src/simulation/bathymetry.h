@@ -0,0 +1,115 @@
+#ifndef BATHYMETRY_H
+#define BATHYMETRY_H
+
+#include <QString>
+#include <QFile>
+#include <QCache>
+#include <QMutex>
+#include <QVector>
+#include <QtGlobal>
+
+class Vessel;
+
+#define BATHYMETRY_MAGIC 0x48544256 // "VBTH"
+#define BATHYMETRY_VERSION 1
+// Tiles kept mapped at once; the least recently used one is unmapped
+#define BATHYMETRY_MAPPED_TILES 256
+// Tiles start at multiples of this in the file, so each maps on its own pages
+#define BATHYMETRY_TILE_ALIGN 4096
+// Most tiles per side and levels a file can have
+#define BATHYMETRY_MAX_TILES 16384
+#define BATHYMETRY_MAX_LEVELS 8
+
+// Bathymetry file layout (host byte order): a BathymetryHeader, then a
+// BathymetryTileEntry for every tile of every level, finest level first and
+// rows of tiles by increasing y. Each tile is (tileSize + 1)^2 qint16 depths
+// in decimeters below sea level (negative on land), rows by increasing y;
+// the extra row and column repeat the neighbours' first ones so a bilinear
+// lookup never needs two tiles. Level n has 2^n times the cell size.
+struct BathymetryHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 tileSize, levels;
+    quint32 tilesX, tilesY;
+    // Corner of the covered area with the smallest x and y, and level 0's
+    // sample spacing in meters
+    double originX, originY, cellSize;
+    // Depth reported outside the covered area
+    float openSeaDepth;
+    quint32 reserved;
+};
+
+struct BathymetryTileEntry
+{
+    quint64 offset;
+};
+
+/*
+ * Seabed depths from a tiled, multi-resolution heightfield file.
+ *
+ * Tiles are memory-mapped one at a time when first needed and kept in an
+ * LRU cache of mappings, so a large file costs address space and page
+ * cache only for the area the vessels are in. Lookups are bilinear.
+ * Thread safe.
+ */
+class Bathymetry
+{
+public:
+    Bathymetry();
+    ~Bathymetry();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return entries != 0; }
+    QString errorString() const { return error; }
+
+    int levels() const { return header.levels; }
+    double cellSize(int level) const { return header.cellSize * (1 << level); }
+
+    // Depth of the seabed in meters below sea level at x, y, sampled from a
+    // level's grid
+    float depthAt(double x, double y, int level = 0);
+    // depths[i] is the seabed under vessels[i]. Vessels are looked up in
+    // tile order, so every tile is fetched once per call.
+    void depthsAt(const QVector<Vessel*> &vessels, QVector<float> &depths);
+
+    // Writes a file from level 0's depths in meters, a grid of
+    // (tilesX * tileSize + 1) x (tilesY * tileSize + 1) samples in rows by
+    // increasing y; the coarser levels are decimated from it
+    static bool write(const QString &fileName, const BathymetryHeader &header, const QVector<float> &depths);
+
+private:
+    Q_DISABLE_COPY(Bathymetry)
+
+    struct MappedTile
+    {
+        MappedTile(QFile *f, uchar *d) : file(f), data(d) {}
+        ~MappedTile() { file->unmap(data); }
+        QFile *file;
+        uchar *data;
+    };
+
+    int tilesX(int level) const;
+    int tilesY(int level) const;
+    // The tile's samples, or 0 if it can't be mapped. Called with the mutex
+    // held.
+    const qint16 *tile(int level, int tx, int ty);
+    float sample(const qint16 *samples, double fx, double fy) const;
+    // Grid position of x, y on a level, and the tile it falls in; false
+    // outside the covered area
+    bool locate(double x, double y, int level, int &tx, int &ty, double &fx, double &fy) const;
+
+    QFile file;
+    BathymetryHeader header;
+    uchar *entryMap;
+    const BathymetryTileEntry *entries;
+    QVector<int> levelStart;
+    QCache<quint32, MappedTile> mapped;
+    QMutex mutex;
+    QString error;
+    // depthsAt() scratch
+    QVector<quint64> order;
+};
+
+#endif // BATHYMETRY_H
@@ -0,0 +1,20 @@
+#ifndef COMMANDLINK_H
+#define COMMANDLINK_H
+
+#include "simulationstate.h"
+
+/*
+ * Inputs from views in other processes. A client writes SimulationCommands
+ * as they are in memory (both ends are built from the same tree and run on
+ * the same machine) to a local socket; the server queues them into the
+ * simulation. Neither end ever blocks on the other.
+ */
+#define COMMAND_SOCKET_NAME "vesikko-commands"
+// Wire only: asks the simulation to rewind, see Simulation::rewind()
+#define COMMAND_REWIND 100
+// Wire only, for the torpedo data computer running next to the simulation:
+// select the next target, and fire a salvo of value2 torpedoes in mode value
+#define COMMAND_NEXT_TARGET 101
+#define COMMAND_FIRE_SALVO 102
+
+#endif // COMMANDLINK_H
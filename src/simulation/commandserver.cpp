@@ -0,0 +1,56 @@
+#include "commandserver.h"
+#include "simulation.h"
+#include <QDebug>
+
+CommandServer::CommandServer(Simulation *s, QObject *parent) :
+    QObject(parent), simulation(s)
+{
+    connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+bool CommandServer::listen(const QString &name) {
+    // The socket of a crashed simulation would be in the way
+    QLocalServer::removeServer(name);
+    if(!server.listen(name)) {
+        qWarning() << Q_FUNC_INFO << "can't listen on" << name << server.errorString();
+        return false;
+    }
+    return true;
+}
+
+void CommandServer::newConnection() {
+    while(server.hasPendingConnections()) {
+        QLocalSocket *client = server.nextPendingConnection();
+        connect(client, SIGNAL(readyRead()), this, SLOT(readCommands()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(disconnected()));
+        clients.append(client);
+        qDebug() << Q_FUNC_INFO << clients.size() << "view clients";
+    }
+}
+
+void CommandServer::readCommands() {
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+    SimulationCommand command;
+    while(client->bytesAvailable() >= (qint64) sizeof(command)) {
+        client->read((char*) &command, sizeof(command));
+        if(command.type == COMMAND_REWIND)
+            simulation->rewind();
+        else if(command.type == COMMAND_NEXT_TARGET)
+            emit nextTarget();
+        else if(command.type == COMMAND_FIRE_SALVO)
+            emit fireSalvo(command.value, command.value2);
+        else if(command.type >= SimulationCommand::Helm && command.type <= SimulationCommand::Collision)
+            simulation->submitCommand(command);
+        else
+            qWarning() << Q_FUNC_INFO << "unknown command" << command.type;
+    }
+}
+
+void CommandServer::disconnected() {
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+    clients.removeAll(client);
+    client->deleteLater();
+    qDebug() << Q_FUNC_INFO << clients.size() << "view clients";
+}
@@ -0,0 +1,33 @@
+#ifndef COMMANDSERVER_H
+#define COMMANDSERVER_H
+
+#include <QObject>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "commandlink.h"
+
+class Simulation;
+
+// Takes commands from view clients, see commandlink.h
+class CommandServer : public QObject
+{
+    Q_OBJECT
+public:
+    CommandServer(Simulation *simulation, QObject *parent = 0);
+    bool listen(const QString &name = COMMAND_SOCKET_NAME);
+signals:
+    // For the torpedo data computer
+    void nextTarget();
+    void fireSalvo(int mode, int count);
+private slots:
+    void newConnection();
+    void readCommands();
+    void disconnected();
+private:
+    Simulation *simulation;
+    QLocalServer server;
+    QList<QLocalSocket*> clients;
+};
+
+#endif // COMMANDSERVER_H
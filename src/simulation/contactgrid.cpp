@@ -0,0 +1,136 @@
+#include "contactgrid.h"
+#include "vessel.h"
+#include <math.h>
+
+// Contacts scored per inner loop, kept on the stack
+#define CONTACTGRID_BATCH 64
+
+ContactGrid::ContactGrid(double size, int hashBits) : cellSize(size), originX(0), originY(0),
+    hashMask((1 << hashBits) - 1)
+{
+    cellStart.resize(hashMask + 2);
+}
+
+int ContactGrid::cellOf(double v) const {
+    return (int) floor(v / cellSize);
+}
+
+int ContactGrid::cellHash(int cx, int cy) const {
+    return ((unsigned) cx * 73856093u ^ (unsigned) cy * 19349663u) & hashMask;
+}
+
+void ContactGrid::build(const QVector<Vessel*> &vessels) {
+    contacts.resize(0);
+    contactCell.resize(0);
+    cellStart.fill(0);
+    for(int i=0;i<vessels.size();i++) {
+        Vessel *v = vessels[i];
+        if(v->type != 1 || v->pendingRemoval) continue;
+        int cell = cellHash(cellOf(v->x), cellOf(v->y));
+        contacts.append(v);
+        contactCell.append(cell);
+        cellStart[cell + 1]++;
+    }
+    int n = contacts.size();
+    if(n) {
+        originX = contacts[0]->x;
+        originY = contacts[0]->y;
+    }
+    for(int c=0;c<=hashMask;c++)
+        cellStart[c + 1] += cellStart[c];
+
+    // Counting sort into cell order
+    unsorted.resize(n);
+    qCopy(contacts.constBegin(), contacts.constEnd(), unsorted.begin());
+    xs.resize(n);
+    ys.resize(n);
+    noise.resize(n);
+    ids.resize(n);
+    cellNext.resize(cellStart.size());
+    qCopy(cellStart.constBegin(), cellStart.constEnd(), cellNext.begin());
+    for(int i=0;i<n;i++) {
+        Vessel *v = unsorted[i];
+        int j = cellNext[contactCell[i]]++;
+        contacts[j] = v;
+        xs[j] = v->x - originX;
+        ys[j] = v->y - originY;
+        // Radiated noise grows with speed, a stopped ship is silent
+        noise[j] = v->speed * v->speed;
+        ids[j] = v->id;
+    }
+}
+
+bool ContactGrid::acquire(const SeekerCone &cone, SeekerContact &contact) const {
+    if(contacts.isEmpty()) return false;
+    const float qx = cone.x - originX;
+    const float qy = cone.y - originY;
+    const float dirX = sin(cone.heading * (M_PI/180.0));
+    const float dirY = -cos(cone.heading * (M_PI/180.0));
+    const float range2 = cone.range * cone.range;
+    const float cosHalf = cos(cone.halfAngle * (M_PI/180.0));
+    const float cos2 = cosHalf * cosHalf;
+    const float *px = xs.constData();
+    const float *py = ys.constData();
+    const float *pn = noise.constData();
+
+    float bestScore = 0;
+    int best = -1;
+    int cx0 = cellOf(cone.x - cone.range), cx1 = cellOf(cone.x + cone.range);
+    int cy0 = cellOf(cone.y - cone.range), cy1 = cellOf(cone.y + cone.range);
+    for(int cy=cy0;cy<=cy1;cy++) {
+        for(int cx=cx0;cx<=cx1;cx++) {
+            int cell = cellHash(cx, cy);
+            int end = cellStart[cell + 1];
+            for(int start=cellStart[cell];start<end;start+=CONTACTGRID_BATCH) {
+                int count = qMin(end - start, CONTACTGRID_BATCH);
+                float score[CONTACTGRID_BATCH];
+                // Cone test without branches or square roots: in range, in
+                // front and within the half angle of the seeker axis
+                for(int i=0;i<count;i++) {
+                    float dx = px[start + i] - qx;
+                    float dy = py[start + i] - qy;
+                    float d2 = dx*dx + dy*dy;
+                    float along = dx*dirX + dy*dirY;
+                    bool inside = d2 <= range2 && along > 0 && along*along >= cos2*d2;
+                    float s = cone.active ? range2 - d2 + 1 : pn[start + i] / (d2 + 1);
+                    score[i] = inside ? s : 0;
+                }
+                for(int i=0;i<count;i++) {
+                    if(score[i] > bestScore) {
+                        bestScore = score[i];
+                        best = start + i;
+                    }
+                }
+            }
+        }
+    }
+    if(best < 0) return false;
+    contact.id = ids[best];
+    contact.x = xs[best] + originX;
+    contact.y = ys[best] + originY;
+    return true;
+}
+
+Vessel *ContactGrid::closest(double x, double y, double radius, double slack) const {
+    double reach = radius + slack;
+    double best = radius * radius;
+    Vessel *closest = 0;
+    int cx0 = cellOf(x - reach), cx1 = cellOf(x + reach);
+    int cy0 = cellOf(y - reach), cy1 = cellOf(y + reach);
+    for(int cy=cy0;cy<=cy1;cy++) {
+        for(int cx=cx0;cx<=cx1;cx++) {
+            int cell = cellHash(cx, cy);
+            for(int i=cellStart[cell];i<cellStart[cell + 1];i++) {
+                Vessel *v = contacts[i];
+                double dx = v->x - x;
+                double dy = v->y - y;
+                double d2 = dx*dx + dy*dy;
+                if(d2 <= best) {
+                    best = d2;
+                    closest = v;
+                }
+            }
+        }
+    }
+    return closest;
+}
@@ -0,0 +1,60 @@
+#ifndef CONTACTGRID_H
+#define CONTACTGRID_H
+
+#include <QVector>
+
+class Vessel;
+
+// A torpedo seeker's field of view, angles in degrees
+struct SeekerCone
+{
+    double x, y, heading, halfAngle, range;
+    // Active seekers lock on the nearest contact, passive ones on the loudest
+    bool active;
+};
+
+// A contact as it was when the grid was built. Seekers steer on this
+// rather than on the live vessel, which other threads may be moving.
+struct SeekerContact
+{
+    int id;
+    double x, y;
+};
+
+/*
+ * Seeker contacts binned into a hashed uniform grid, rebuilt once per tick.
+ * Positions are stored as flat float arrays sorted by cell, relative to an
+ * origin near the contacts, so a cone query runs a branch-free loop over
+ * each cell's contiguous run.
+ */
+class ContactGrid
+{
+public:
+    explicit ContactGrid(double cellSize = 1000, int hashBits = 12);
+    // Ships only; subs, torpedoes and vessels being removed are left out
+    void build(const QVector<Vessel*> &vessels);
+    // The contact the seeker would lock on, at its position at build();
+    // false if there is none
+    bool acquire(const SeekerCone &cone, SeekerContact &contact) const;
+    // Nearest contact within radius of x, y at its current position, or 0.
+    // slack covers how far contacts may have moved since build().
+    Vessel *closest(double x, double y, double radius, double slack) const;
+    int count() const { return contacts.size(); }
+
+private:
+    int cellHash(int cx, int cy) const;
+    int cellOf(double v) const;
+
+    double cellSize, originX, originY;
+    int hashMask;
+    QVector<int> cellStart;
+    // Structure of arrays, indexed by sorted contact
+    QVector<float> xs, ys, noise;
+    QVector<int> ids;
+    QVector<Vessel*> contacts;
+    // Build scratch, kept to avoid allocating every tick
+    QVector<int> contactCell, cellNext;
+    QVector<Vessel*> unsorted;
+};
+
+#endif // CONTACTGRID_H
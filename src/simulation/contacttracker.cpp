@@ -0,0 +1,115 @@
+#include "contacttracker.h"
+#include "simulation.h"
+#include <QDebug>
+
+ContactTracker::ContactTracker(const Simulation *s, QObject *parent) : QThread(parent),
+    simulation(s), budget(TRACKER_TICK_BUDGET), stopping(false), now(0), clockMoved(false), lastDropCheck(0)
+{
+}
+
+ContactTracker::~ContactTracker() {
+    stop();
+    qDeleteAll(solvers);
+}
+
+void ContactTracker::stop() {
+    if(!isRunning()) return;
+    mutex.lock();
+    stopping = true;
+    workQueued.wakeOne();
+    mutex.unlock();
+    wait();
+}
+
+void ContactTracker::addDetections(const QVector<SensorDetection> &detections) {
+    if(detections.isEmpty()) return;
+    QMutexLocker locker(&mutex);
+    for(int i=0;i<detections.size();i++)
+        queued.append(detections[i]);
+    if(queued.size() > TRACKER_MAX_QUEUED) {
+        qWarning() << Q_FUNC_INFO << "solver behind, dropping" << queued.size() - TRACKER_MAX_QUEUED << "detections";
+        while(queued.size() > TRACKER_MAX_QUEUED)
+            queued.removeFirst();
+    }
+    workQueued.wakeOne();
+}
+
+void ContactTracker::tick() {
+    updated.resize(0);
+    dropped.resize(0);
+    mutex.lock();
+    budget = TRACKER_TICK_BUDGET;
+    now = simulation->simulatedTime();
+    clockMoved = true;
+    QHash<int, TrackEstimate>::const_iterator it;
+    for(it=solved.constBegin();it!=solved.constEnd();++it)
+        updated.append(it.value());
+    solved.clear();
+    dropped = lost;
+    lost.resize(0);
+    workQueued.wakeOne();
+    mutex.unlock();
+    for(int i=0;i<dropped.size();i++)
+        emit trackLost(dropped[i]);
+    if(!updated.isEmpty())
+        emit tracksUpdated(updated);
+}
+
+void ContactTracker::run() {
+    forever {
+        mutex.lock();
+        while((queued.isEmpty() || budget <= 0) && !clockMoved && !stopping)
+            workQueued.wait(&mutex);
+        if(stopping) {
+            mutex.unlock();
+            break;
+        }
+        if(clockMoved) {
+            clockMoved = false;
+            double time = now;
+            mutex.unlock();
+            dropStale(time);
+            continue;
+        }
+        SensorDetection d = queued.takeFirst();
+        budget -= TMA_PARTICLES;
+        mutex.unlock();
+
+        TmaSolver *&solver = solvers[d.contact];
+        // Heard again after a rewind to before the track's last detection
+        if(solver && d.time < solver->lastTime()) {
+            delete solver;
+            solver = 0;
+        }
+        if(!solver)
+            solver = new TmaSolver(d.contact);
+        solver->update(d);
+        TrackEstimate e;
+        e.contact = d.contact;
+        solver->estimate(e);
+        mutex.lock();
+        solved.insert(d.contact, e);
+        mutex.unlock();
+    }
+}
+
+// Once per simulated second is often enough. A time earlier than the last
+// check means the simulation was rewound: tracks last heard after it go.
+void ContactTracker::dropStale(double time) {
+    if(time >= lastDropCheck && time - lastDropCheck < 1) return;
+    lastDropCheck = time;
+    QVector<int> stale;
+    QHash<int, TmaSolver*>::const_iterator it;
+    for(it=solvers.constBegin();it!=solvers.constEnd();++it) {
+        double age = time - it.value()->lastTime();
+        if(age > TRACKER_TIMEOUT || age < 0)
+            stale.append(it.key());
+    }
+    if(stale.isEmpty()) return;
+    for(int i=0;i<stale.size();i++)
+        delete solvers.take(stale[i]);
+    QMutexLocker locker(&mutex);
+    for(int i=0;i<stale.size();i++)
+        solved.remove(stale[i]);
+    lost += stale;
+}
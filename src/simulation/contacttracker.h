@@ -0,0 +1,74 @@
+#ifndef CONTACTTRACKER_H
+#define CONTACTTRACKER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include "sensors.h"
+#include "tmasolver.h"
+
+// Particle updates the solver thread may spend per simulation tick, and
+// simulated seconds without a detection before a track is dropped
+#define TRACKER_TICK_BUDGET (32 * TMA_PARTICLES)
+#define TRACKER_TIMEOUT 180
+#define TRACKER_MAX_QUEUED 4096
+
+class Simulation;
+
+/*
+ * Keeps a track per sensor contact and solves it with a TmaSolver on a
+ * thread of its own.
+ *
+ * Detections are queued from the simulation thread; each tick grants the
+ * solver thread TRACKER_TICK_BUDGET particle updates, so a crowded sea
+ * makes the solutions lag rather than the tick. The solutions reached since
+ * the last tick are passed on from the simulation thread with
+ * tracksUpdated(). Tracks time out on the simulation's clock, so they do
+ * also while nothing is heard; a rewind drops the tracks built on what was
+ * heard after the time rewound to.
+ */
+class ContactTracker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ContactTracker(const Simulation *simulation, QObject *parent = 0);
+    ~ContactTracker();
+    void stop();
+public slots:
+    // Simulation::detections
+    void addDetections(const QVector<SensorDetection> &detections);
+    // Simulation::tickTime
+    void tick();
+signals:
+    void tracksUpdated(const QVector<TrackEstimate> &tracks);
+    void trackLost(int contact);
+protected:
+    virtual void run();
+private:
+    void dropStale(double time);
+
+    const Simulation *simulation;
+    QMutex mutex;
+    QWaitCondition workQueued;
+    QList<SensorDetection> queued;
+    int budget;
+    bool stopping;
+    // Simulated time of the latest tick, and whether the solver thread has
+    // yet to check the tracks against it
+    double now;
+    bool clockMoved;
+    QHash<int, TrackEstimate> solved;
+    QVector<int> lost;
+
+    // Solver thread only
+    QHash<int, TmaSolver*> solvers;
+    double lastDropCheck;
+    // Simulation thread only
+    QVector<TrackEstimate> updated;
+    QVector<int> dropped;
+};
+
+#endif // CONTACTTRACKER_H
@@ -0,0 +1,292 @@
+#include "firecontrol.h"
+#include "simulation.h"
+#include "torpedo.h"
+#include <math.h>
+
+#define TURN_RATE (TORPEDO_HELM * 3 * (M_PI/180.0))
+// Refinement stops when the gyro moves less than this, in radians
+#define INTERCEPT_TOLERANCE 1e-5
+#define INTERCEPT_ITERATIONS 16
+
+static double launchSpeed(const TorpedoLaunch &launch) {
+    return launch.speed + TORPEDO_LAUNCH_SPEED;
+}
+
+// Seconds until full speed, and the distance covered by t
+static double rampTime(double v0) {
+    return qMax(0.0, (TORPEDO_SPEED - v0) / TORPEDO_ACCELERATION);
+}
+
+static double runDistance(double v0, double t) {
+    double tr = rampTime(v0);
+    if(t <= tr)
+        return v0 * t + 0.5 * TORPEDO_ACCELERATION * t * t;
+    return v0 * tr + 0.5 * TORPEDO_ACCELERATION * tr * tr + TORPEDO_SPEED * (t - tr);
+}
+
+static double runSpeed(double v0, double t) {
+    return qMin((double) TORPEDO_SPEED, v0 + TORPEDO_ACCELERATION * t);
+}
+
+// Headings in radians from north, clockwise; the shortest turn from h0 to h
+static double turnAngle(double h0, double h) {
+    double d = fmod(h - h0, 2 * M_PI);
+    if(d > M_PI) d -= 2 * M_PI;
+    if(d < -M_PI) d += 2 * M_PI;
+    return d;
+}
+
+// Path of a turn at rate w (signed) from heading h0 with the speed going
+// v0 -> v0 + a*t: integrates v sin(h), -v cos(h) by parts
+static void turnSegment(double h0, double w, double v0, double a, double t, double &x, double &y) {
+    double h1 = h0 + w * t, v1 = v0 + a * t;
+    x += -(v1 * cos(h1) - v0 * cos(h0)) / w + a / (w * w) * (sin(h1) - sin(h0));
+    y -= (v1 * sin(h1) - v0 * sin(h0)) / w + a / (w * w) * (cos(h1) - cos(h0));
+}
+
+// The first t seconds of the turn onto gyro, which takes tau
+static void turnPath(const TorpedoLaunch &launch, double h0, double gyro, double t, double &x, double &y,
+                     double &tau) {
+    double v0 = launchSpeed(launch);
+    double delta = turnAngle(h0, gyro);
+    x = launch.x;
+    y = launch.y;
+    tau = fabs(delta) / TURN_RATE;
+    t = qMin(t, tau);
+    if(t < 1e-9) return;
+    double w = delta > 0 ? TURN_RATE : -TURN_RATE;
+    double tr = rampTime(v0);
+    if(t <= tr) {
+        turnSegment(h0, w, v0, TORPEDO_ACCELERATION, t, x, y);
+    } else {
+        if(tr > 0)
+            turnSegment(h0, w, v0, TORPEDO_ACCELERATION, tr, x, y);
+        turnSegment(h0 + w * tr, w, runSpeed(v0, tr), 0, t - tr, x, y);
+    }
+}
+
+void torpedoPosition(const TorpedoLaunch &launch, double gyro, double t, double &x, double &y) {
+    double h0 = launch.heading * (M_PI/180.0), g = gyro * (M_PI/180.0);
+    double tau;
+    turnPath(launch, h0, g, t, x, y, tau);
+    if(t <= tau) return;
+    double v0 = launchSpeed(launch);
+    double d = runDistance(v0, t) - runDistance(v0, tau);
+    x += sin(g) * d;
+    y -= cos(g) * d;
+}
+
+// Earliest t >= t0 at which a runner leaving p at time t0 at speed s
+// reaches the target: |w + vt| = s (t - t0) with w the target's offset
+// from p at 0. Negative when it never does.
+static double leadTime(double wx, double wy, double vx, double vy, double s, double t0) {
+    double a = vx * vx + vy * vy - s * s;
+    double b = 2 * (wx * vx + wy * vy + s * s * t0);
+    double c = wx * wx + wy * wy - s * s * t0 * t0;
+    double t;
+    if(fabs(a) < 1e-9) {
+        if(fabs(b) < 1e-12) return -1;
+        t = -c / b;
+    } else {
+        double disc = b * b - 4 * a * c;
+        if(disc < 0) return -1;
+        double root = sqrt(disc);
+        double t1 = (-b - root) / (2 * a), t2 = (-b + root) / (2 * a);
+        if(t1 > t2) qSwap(t1, t2);
+        t = t1 >= t0 ? t1 : t2;
+    }
+    return t >= t0 ? t : -1;
+}
+
+namespace {
+
+struct InterceptProblem
+{
+    const TorpedoLaunch *launch;
+    double h0, v0, x, y, vx, vy;
+};
+
+// For a gyro course g: when the torpedo, turning onto g and running
+// straight, meets the target and where; returns the course from the end of
+// the turn to that point, or false when it never meets it
+bool interceptOn(const InterceptProblem &p, double g, double &t, double &aimX, double &aimY, double &next) {
+    double qx, qy, tau;
+    turnPath(*p.launch, p.h0, g, INFINITY, qx, qy, tau);
+    // Closed form once at full speed: the straight run is as long as a full
+    // speed one starting when the ramp has caught up
+    double full = qMax(tau, rampTime(p.v0));
+    double start = full - (runDistance(p.v0, full) - runDistance(p.v0, tau)) / TORPEDO_SPEED;
+    t = leadTime(p.x - qx, p.y - qy, p.vx, p.vy, TORPEDO_SPEED, start);
+    if(t < 0) return false;
+    // Newton on the ramp when the intercept comes before full speed
+    if(t < rampTime(p.v0)) {
+        t = qMax(t, tau);
+        for(int n=0;n<4;n++) {
+            double dx = p.x + p.vx * t - qx, dy = p.y + p.vy * t - qy;
+            double r = sqrt(dx * dx + dy * dy);
+            double f = runDistance(p.v0, t) - runDistance(p.v0, tau) - r;
+            double df = runSpeed(p.v0, t) - (r > 0 ? (dx * p.vx + dy * p.vy) / r : 0);
+            if(df <= 0) break;
+            t = qMax(tau, t - f / df);
+        }
+    }
+    aimX = p.x + p.vx * t;
+    aimY = p.y + p.vy * t;
+    next = atan2(aimX - qx, -(aimY - qy));
+    return true;
+}
+
+}
+
+// The gyro is a root of r(g) = course from the end of the turn onto g to
+// the intercept, less g. Far targets converge by simply re-aiming; near
+// ones, where the end of the turn swings with g, need the secant steps.
+bool solveIntercept(const TorpedoLaunch &launch, const TargetMotion &target, FiringSolution &out) {
+    out.valid = false;
+    out.iterations = 0;
+    double c = target.course * (M_PI/180.0);
+    InterceptProblem p;
+    p.launch = &launch;
+    p.h0 = launch.heading * (M_PI/180.0);
+    p.v0 = launchSpeed(launch);
+    p.x = target.x;
+    p.y = target.y;
+    p.vx = sin(c) * target.speed;
+    p.vy = -cos(c) * target.speed;
+
+    // Lead at full speed from the launch point, ignoring turn and ramp
+    double t = leadTime(p.x - launch.x, p.y - launch.y, p.vx, p.vy, TORPEDO_SPEED, 0);
+    if(t < 0) return false;
+    double g = atan2(p.x + p.vx * t - launch.x, -(p.y + p.vy * t - launch.y));
+
+    double aimX, aimY, next, r, lastG = 0, lastR = 0;
+    bool converged = false;
+    for(int i=0;i<INTERCEPT_ITERATIONS;i++) {
+        out.iterations++;
+        if(!interceptOn(p, g, t, aimX, aimY, next)) return false;
+        r = turnAngle(g, next);
+        if(fabs(r) < INTERCEPT_TOLERANCE) {
+            converged = true;
+            break;
+        }
+        double step = r;
+        if(i > 0 && fabs(r - lastR) > 1e-12)
+            step = -r * turnAngle(lastG, g) / (r - lastR);
+        lastG = g;
+        lastR = r;
+        g += qBound(-M_PI / 4, step, M_PI / 4);
+    }
+    if(!converged) return false;
+    out.runTime = t;
+    out.x = aimX;
+    out.y = aimY;
+    out.gyro = fmod(g * (180.0/M_PI) + 720, 360);
+    out.gyroAngle = turnAngle(p.h0, g) * (180.0/M_PI);
+    out.valid = out.runTime <= TORPEDO_RUN_TIME;
+    return out.valid;
+}
+
+void solveSpread(const TorpedoLaunch &launch, const TargetMotion &target, int count, double spacing,
+                 FiringSolution *out) {
+    double c = target.course * (M_PI/180.0);
+    for(int i=0;i<count;i++) {
+        double along = (i - (count - 1) / 2.0) * spacing;
+        TargetMotion aim = target;
+        aim.x += sin(c) * along;
+        aim.y -= cos(c) * along;
+        solveIntercept(launch, aim, out[i]);
+    }
+}
+
+TorpedoDataComputer::TorpedoDataComputer(Simulation *s, QObject *parent) :
+    QObject(parent), simulation(s), target(0), solutions(1)
+{
+    solutions[0].valid = false;
+}
+
+void TorpedoDataComputer::tracksUpdated(const QVector<TrackEstimate> &updated) {
+    foreach(const TrackEstimate &e, updated) {
+        int i = 0;
+        while(i < tracks.size() && tracks[i].contact < e.contact)
+            i++;
+        if(i < tracks.size() && tracks[i].contact == e.contact)
+            tracks[i] = e;
+        else
+            tracks.insert(i, e);
+    }
+    if(!target && !tracks.isEmpty())
+        selectNextTarget();
+}
+
+void TorpedoDataComputer::trackLost(int contact) {
+    for(int i=0;i<tracks.size();i++) {
+        if(tracks[i].contact == contact) {
+            tracks.remove(i);
+            break;
+        }
+    }
+    if(contact == target) {
+        target = 0;
+        selectNextTarget();
+    }
+}
+
+void TorpedoDataComputer::selectNextTarget() {
+    int next = 0;
+    for(int i=0;i<tracks.size() && !next;i++) {
+        if(tracks[i].contact > target)
+            next = tracks[i].contact;
+    }
+    if(!next && !tracks.isEmpty())
+        next = tracks[0].contact;
+    target = next;
+    update();
+}
+
+// The track moved on to now, and the launch from the sub as it is
+bool TorpedoDataComputer::currentTarget(TargetMotion &motion, TorpedoLaunch &launch) const {
+    for(int i=0;i<tracks.size();i++) {
+        const TrackEstimate &e = tracks[i];
+        if(e.contact != target) continue;
+        double age = simulation->simulatedTime() - e.time;
+        double c = e.course * (M_PI/180.0);
+        motion.x = e.x + sin(c) * e.speed * age;
+        motion.y = e.y - cos(c) * e.speed * age;
+        motion.course = e.course;
+        motion.speed = e.speed;
+        const Vessel *sub = simulation->getSub();
+        launch.x = sub->x;
+        launch.y = sub->y;
+        launch.heading = sub->heading;
+        launch.speed = sub->speed;
+        return true;
+    }
+    return false;
+}
+
+void TorpedoDataComputer::update() {
+    TargetMotion motion;
+    TorpedoLaunch launch;
+    FiringSolution &s = solutions[0];
+    if(!currentTarget(motion, launch)) {
+        s.valid = false;
+        emit solutionChanged(0, false, 0, 0);
+        return;
+    }
+    solveIntercept(launch, motion, s);
+    emit solutionChanged(target, s.valid, s.gyroAngle, s.runTime);
+}
+
+void TorpedoDataComputer::fireSalvo(int mode, int count, double spacing) {
+    TargetMotion motion;
+    TorpedoLaunch launch;
+    if(count < 1 || !currentTarget(motion, launch)) return;
+    solutions.resize(count);
+    solveSpread(launch, motion, count, spacing, solutions.data());
+    for(int i=0;i<count;i++) {
+        if(solutions[i].valid)
+            emit fireTorpedo(solutions[i].gyro, mode);
+    }
+    // The middle one is the main solution again on the next update
+    solutions.resize(1);
+}
@@ -0,0 +1,86 @@
+#ifndef FIRECONTROL_H
+#define FIRECONTROL_H
+
+#include <QObject>
+#include <QVector>
+#include "tmasolver.h"
+
+class Simulation;
+class Vessel;
+
+// Where a torpedo starts its run: the launching sub's position, heading
+// and speed
+struct TorpedoLaunch
+{
+    double x, y, heading, speed;
+};
+
+// A target at x, y at launch, holding course and speed
+struct TargetMotion
+{
+    double x, y, course, speed;
+};
+
+struct FiringSolution
+{
+    bool valid;
+    // Course ordered to the torpedo, and relative to the launch heading
+    double gyro, gyroAngle;
+    // Seconds from launch to intercept, and where it happens
+    double runTime, x, y;
+    int iterations;
+};
+
+/*
+ * Intercept of a straight-running torpedo: it turns at TORPEDO_HELM from
+ * the launch heading onto the gyro course while speeding up from the
+ * launch speed, then runs straight. The turn is integrated in closed form;
+ * the gyro course comes from a constant speed lead solution refined until
+ * it points from the end of the turn to the target's position at the
+ * intercept. Invalid when the torpedo can't get there within
+ * TORPEDO_RUN_TIME.
+ */
+bool solveIntercept(const TorpedoLaunch &launch, const TargetMotion &target, FiringSolution &out);
+// Where the torpedo is t seconds after launch on gyro course
+void torpedoPosition(const TorpedoLaunch &launch, double gyro, double t, double &x, double &y);
+// count solutions aimed at points spacing meters apart along the target's
+// track, centered on it
+void solveSpread(const TorpedoLaunch &launch, const TargetMotion &target, int count, double spacing,
+                 FiringSolution *out);
+
+/*
+ * The torpedo data computer: keeps a solution on the selected contact
+ * track, re-solved every tick from the sub's current position and the
+ * track extrapolated to the present, and fires salvos on it.
+ */
+class TorpedoDataComputer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TorpedoDataComputer(Simulation *simulation, QObject *parent = 0);
+    const FiringSolution &solution() const { return solutions[0]; }
+public slots:
+    // ContactTracker::tracksUpdated/trackLost
+    void tracksUpdated(const QVector<TrackEstimate> &tracks);
+    void trackLost(int contact);
+    // Steps through the tracked contacts in id order
+    void selectNextTarget();
+    // Simulation::tickTime
+    void update();
+    // Fires count torpedoes spread spacing meters apart along the target's
+    // track; nothing without a valid solution
+    void fireSalvo(int mode, int count = 1, double spacing = 100);
+signals:
+    void fireTorpedo(double direction, int mode);
+    // target 0 when none is selected
+    void solutionChanged(int target, bool valid, double gyroAngle, double runTime);
+private:
+    bool currentTarget(TargetMotion &motion, TorpedoLaunch &launch) const;
+
+    Simulation *simulation;
+    QVector<TrackEstimate> tracks;
+    int target;
+    QVector<FiringSolution> solutions;
+};
+
+#endif // FIRECONTROL_H
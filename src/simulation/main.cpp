@@ -2,7 +2,15 @@
 #include <QDebug>
 #include <QMainWindow>
 #include <QTimer>
+#include <QStringList>
 #include "simulation.h"
+#include "simulationrecorder.h"
+#include "simulationplayer.h"
+#include "worldpublisher.h"
+#include "commandserver.h"
+#include "sessionserver.h"
+#include "contacttracker.h"
+#include "firecontrol.h"
 #include "../mapview/mapqmlupdater.h"
 #include "../mapview/mapview.h"
 #include "../periscopeview/periscopeview.h"
@@ -14,30 +22,116 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
     Simulation simulation;
-    MapView mapView;
-    WeaponsView weaponsView;
-    HydrophoneView hydrophoneView;
-    ServoGauges servoGauges;
-    QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), &mapView.mqu, SLOT(vesselUpdated(Vessel*)));
-    QObject::connect(&simulation, SIGNAL(vesselCreated(Vessel*)), &mapView.mqu, SLOT(createVessel(Vessel*)));
-    QObject::connect(&simulation, SIGNAL(vesselDeleted(Vessel*)), &mapView.mqu, SLOT(vesselDeleted(Vessel*)));
-    QObject::connect(&mapView, SIGNAL(setHelm(int)), simulation.getSub(), SLOT(setHelm(int)));
-    QObject::connect(&mapView, SIGNAL(setSpeed(int)), simulation.getSub(), SLOT(setSpeed(int)));
-    QObject::connect(&mapView, SIGNAL(setDepthChange(int)), simulation.getSub(), SLOT(setDepthChange(int)));
-    QObject::connect(&weaponsView, SIGNAL(fireTorpedo(double)), &simulation, SLOT(fireTorpedo(double)));
-    QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), &hydrophoneView, SLOT(vesselUpdated(Vessel*)));
-    QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), &servoGauges, SLOT(vesselUpdated(Vessel*)));
+    QStringList args = app.arguments();
+    int scenarioArg = args.indexOf("--scenario");
+    if(scenarioArg > 0 && scenarioArg + 1 < args.size())
+        simulation.setScenarioFile(args[scenarioArg + 1]);
+    int bathymetryArg = args.indexOf("--bathymetry");
+    if(bathymetryArg > 0 && bathymetryArg + 1 < args.size())
+        simulation.loadBathymetry(args[bathymetryArg + 1]);
+    // Two minutes of rewind at one snapshot every five seconds
+    simulation.setSnapshots(24, 100);
+    SimulationRecorder recorder;
+    int recordArg = args.indexOf("--record");
+    if(recordArg > 0 && recordArg + 1 < args.size()) {
+        if(recorder.open(args[recordArg + 1], 200, args.contains("--record-states")))
+            simulation.setRecorder(&recorder);
+    }
+    SimulationPlayer *player = 0;
+    int replayArg = args.indexOf("--replay");
+    if(replayArg > 0 && replayArg + 1 < args.size()) {
+        player = new SimulationPlayer(&simulation, &app);
+        if(!player->open(args[replayArg + 1]))
+            return 1;
+        int speedArg = args.indexOf("--replay-speed");
+        if(speedArg > 0 && speedArg + 1 < args.size())
+            player->setSpeed(args[speedArg + 1].toDouble());
+    }
+    // With --publish the world goes to shared memory and commands come in
+    // over a local socket, for views started separately with vesikko-view
+    SharedWorldPublisher publisher(&simulation);
+    CommandServer commandServer(&simulation);
+    if(args.contains("--publish")) {
+        if(publisher.open()) {
+            QObject::connect(&simulation, SIGNAL(tickTime(double, int)), &publisher, SLOT(publish(double, int)));
+            QObject::connect(&simulation, SIGNAL(explosion(double,double,double)), &publisher, SLOT(explosion(double,double,double)));
+        }
+        commandServer.listen();
+    }
+    // With --session players join with subs of their own, see sessionserver.h
+    SessionServer sessionServer(&simulation);
+    if(args.contains("--session")) {
+        int portArg = args.indexOf("--session-port");
+        quint16 port = portArg > 0 && portArg + 1 < args.size() ? args[portArg + 1].toUShort() : 0;
+        if(sessionServer.listen(SESSION_SOCKET_NAME, port))
+            QObject::connect(&simulation, SIGNAL(tickTime(double, int)), &sessionServer, SLOT(replicate()));
+    }
+    // The map shows the tracker's solutions unless --truth; the torpedo data
+    // computer solves on the tracks either way. Both run next to the
+    // simulation, also for a weapons view in another process.
+    ContactTracker tracker(&simulation);
+    TorpedoDataComputer dataComputer(&simulation);
+    if(!args.contains("--no-views") || args.contains("--publish")) {
+        QObject::connect(&simulation, SIGNAL(detections(QVector<SensorDetection>)), &tracker, SLOT(addDetections(QVector<SensorDetection>)));
+        QObject::connect(&simulation, SIGNAL(tickTime(double, int)), &tracker, SLOT(tick()));
+        QObject::connect(&tracker, SIGNAL(tracksUpdated(QVector<TrackEstimate>)), &dataComputer, SLOT(tracksUpdated(QVector<TrackEstimate>)));
+        QObject::connect(&tracker, SIGNAL(trackLost(int)), &dataComputer, SLOT(trackLost(int)));
+        QObject::connect(&simulation, SIGNAL(tickTime(double, int)), &dataComputer, SLOT(update()));
+        QObject::connect(&dataComputer, SIGNAL(fireTorpedo(double, int)), &simulation, SLOT(fireTorpedo(double, int)));
+        tracker.start(QThread::LowPriority);
+    }
+    if(args.contains("--publish")) {
+        QObject::connect(&dataComputer, SIGNAL(solutionChanged(int, bool, double, double)), &publisher, SLOT(solutionChanged(int, bool, double, double)));
+        QObject::connect(&commandServer, SIGNAL(nextTarget()), &dataComputer, SLOT(selectNextTarget()));
+        QObject::connect(&commandServer, SIGNAL(fireSalvo(int, int)), &dataComputer, SLOT(fireSalvo(int, int)));
+    }
+    if(!args.contains("--no-views")) {
+        MapView *mapView = new MapView(&app);
+        WeaponsView *weaponsView = new WeaponsView(&app);
+        HydrophoneView *hydrophoneView = new HydrophoneView(&app);
+        ServoGauges *servoGauges = new ServoGauges(&app);
+        if(bathymetryArg > 0 && bathymetryArg + 1 < args.size())
+            mapView->setChart(args[bathymetryArg + 1]);
+        QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), &mapView->mqu, SLOT(vesselUpdated(Vessel*)));
+        QObject::connect(&simulation, SIGNAL(vesselCreated(Vessel*)), &mapView->mqu, SLOT(createVessel(Vessel*)));
+        QObject::connect(&simulation, SIGNAL(vesselsCreated(QVector<Vessel*>)), &mapView->mqu, SLOT(createVessels(QVector<Vessel*>)));
+        QObject::connect(&simulation, SIGNAL(vesselsDeleted(QVector<Vessel*>)), &mapView->mqu, SLOT(vesselsDeleted(QVector<Vessel*>)));
+        QObject::connect(mapView, SIGNAL(setHelm(int)), &simulation, SLOT(setHelm(int)));
+        QObject::connect(mapView, SIGNAL(setSpeed(int)), &simulation, SLOT(setSpeed(int)));
+        QObject::connect(mapView, SIGNAL(setDepthChange(int)), &simulation, SLOT(setDepthChange(int)));
+        QObject::connect(mapView, SIGNAL(rewind()), &simulation, SLOT(rewind()));
+        QObject::connect(weaponsView, SIGNAL(fireTorpedo(double, int)), &simulation, SLOT(fireTorpedo(double, int)));
+        mapView->mqu.setShowTruth(args.contains("--truth"));
+        QObject::connect(&tracker, SIGNAL(tracksUpdated(QVector<TrackEstimate>)), &mapView->mqu, SLOT(tracksUpdated(QVector<TrackEstimate>)));
+        QObject::connect(&tracker, SIGNAL(trackLost(int)), &mapView->mqu, SLOT(trackLost(int)));
+        QObject::connect(&dataComputer, SIGNAL(solutionChanged(int, bool, double, double)), weaponsView, SLOT(showSolution(int, bool, double, double)));
+        QObject::connect(weaponsView, SIGNAL(nextTarget()), &dataComputer, SLOT(selectNextTarget()));
+        QObject::connect(weaponsView, SIGNAL(fireSalvo(int, int)), &dataComputer, SLOT(fireSalvo(int, int)));
+        QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), hydrophoneView, SLOT(vesselUpdated(Vessel*)));
+        QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), servoGauges, SLOT(vesselUpdated(Vessel*)));
+    }
 
     PeriscopeView *periscope = 0;
     // periscope = new PeriscopeView(&app);
     if(periscope) {
         QObject::connect(&simulation, SIGNAL(vesselUpdated(Vessel*)), periscope, SLOT(vesselUpdated(Vessel*)));
         QObject::connect(&simulation, SIGNAL(vesselCreated(Vessel*)), periscope, SLOT(createVessel(Vessel*)));
-        QObject::connect(&simulation, SIGNAL(vesselDeleted(Vessel*)), periscope, SLOT(vesselDeleted(Vessel*)));
+        QObject::connect(&simulation, SIGNAL(vesselsCreated(QVector<Vessel*>)), periscope, SLOT(createVessels(QVector<Vessel*>)));
+        QObject::connect(&simulation, SIGNAL(vesselsDeleted(QVector<Vessel*>)), periscope, SLOT(vesselsDeleted(QVector<Vessel*>)));
         QObject::connect(&simulation, SIGNAL(tickTime(double, int)), periscope, SLOT(tick(double, int)));
         QObject::connect(periscope, SIGNAL(collisionBetween(Vessel*,Vessel*)), &simulation, SLOT(collisionBetween(Vessel*,Vessel*)));
         QObject::connect(&simulation, SIGNAL(explosion(double,double,double)), periscope, SLOT(addExplosion(double,double,double)));
     }
-    QTimer::singleShot(1, &simulation, SLOT(startSimulation()));
-    return app.exec();
+    if(player) {
+        int seekArg = args.indexOf("--seek");
+        if(seekArg > 0 && seekArg + 1 < args.size())
+            player->setStartTick(args[seekArg + 1].toInt());
+        QTimer::singleShot(1, player, SLOT(start()));
+    } else {
+        QTimer::singleShot(1, &simulation, SLOT(startSimulation()));
+    }
+    int ret = app.exec();
+    tracker.stop();
+    recorder.close();
+    return ret;
 }
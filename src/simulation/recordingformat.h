@@ -0,0 +1,67 @@
+#ifndef RECORDINGFORMAT_H
+#define RECORDINGFORMAT_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+/*
+ * Simulation recording (.vrec), append-only:
+ *
+ *   "VREC" u32 version
+ *   then chunks, each starting with a tag byte:
+ *
+ *   KEYFRAME  varint tick, varint total, varint size, qCompress'd raw
+ *             SimulationState.
+ *             Written before the commands of that tick, restores exactly.
+ *   COMMAND   varint type, zigzag value, zigzag value2,
+ *             zigzag direction in 1/1000 degrees
+ *   TICK      zigzag dt delta in microseconds, varint total delta in ms.
+ *             Both deltas restart from zero after a keyframe.
+ *   STATES    varint size, then optional per-tick vessel states: varint
+ *             count, per vessel varint id and zigzag deltas of x, y, depth
+ *             (cm), heading (1/100 deg), speed (cm/s) against the previous
+ *             STATES of the same id. Only for analysis, replay skips it.
+ *   REWIND    as KEYFRAME, written when the simulation was rewound. Unlike
+ *             a keyframe it does not match the replayed state and must be
+ *             applied.
+ */
+
+#define RECORDING_MAGIC "VREC"
+#define RECORDING_VERSION 4
+
+enum RecordingTag {
+    RecordingKeyframe = 1,
+    RecordingCommand = 2,
+    RecordingTick = 3,
+    RecordingStates = 4,
+    RecordingRewind = 5
+};
+
+inline quint64 zigzag(qint64 v) {
+    return ((quint64) v << 1) ^ (quint64)(v >> 63);
+}
+
+inline qint64 unzigzag(quint64 v) {
+    return (qint64)(v >> 1) ^ -(qint64)(v & 1);
+}
+
+inline void appendVarint(QByteArray &out, quint64 v) {
+    while(v >= 0x80) {
+        out.append((char)(v | 0x80));
+        v >>= 7;
+    }
+    out.append((char) v);
+}
+
+// Returns false when the varint runs past end
+inline bool readVarint(const uchar *&p, const uchar *end, quint64 &v) {
+    v = 0;
+    for(int shift=0;p<end && shift<64;shift+=7) {
+        uchar b = *p++;
+        v |= (quint64)(b & 0x7f) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+#endif // RECORDINGFORMAT_H
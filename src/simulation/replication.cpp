@@ -0,0 +1,206 @@
+#include "replication.h"
+#include "recordingformat.h"
+#include "vessel.h"
+#include <string.h>
+
+#define HEADING_STEPS 36000
+
+ReplicaHistory::ReplicaHistory(int c) : capacity(c)
+{
+}
+
+void ReplicaHistory::clear() {
+    ring.clear();
+}
+
+const ReplicaSnapshot *ReplicaHistory::find(int sequence) const {
+    for(int i=0;i<ring.size();i++) {
+        if(ring[i].sequence == sequence)
+            return &ring[i];
+    }
+    return 0;
+}
+
+void ReplicaHistory::add(const ReplicaSnapshot &snapshot) {
+    // Oldest first, so a client that stops acking loses its oldest baselines
+    if(ring.size() >= capacity)
+        ring.remove(0);
+    ring.append(snapshot);
+}
+
+void ReplicaHistory::dropBefore(int sequence) {
+    int n = 0;
+    while(n < ring.size() && ring[n].sequence < sequence)
+        n++;
+    ring.remove(0, n);
+}
+
+void quantizeVessel(const Vessel *v, ReplicatedVessel &r) {
+    r.id = v->id;
+    r.x = qRound(v->x * 10);
+    r.y = qRound(v->y * 10);
+    r.depth = qRound(v->depth * 10);
+    r.heading = ((qRound(v->heading * 100) % HEADING_STEPS) + HEADING_STEPS) % HEADING_STEPS;
+    r.speed = qRound(v->speed * 100);
+    r.type = v->type;
+}
+
+double dequantizePosition(qint32 v) {
+    return v / 10.0;
+}
+
+double dequantizeHeading(qint32 v) {
+    return v / 100.0;
+}
+
+double dequantizeSpeed(qint32 v) {
+    return v / 100.0;
+}
+
+void appendMessage(QByteArray &out, int type, const QByteArray &payload) {
+    out.append((char) type);
+    appendVarint(out, payload.size());
+    out.append(payload);
+}
+
+bool takeMessage(QByteArray &buffer, int &type, QByteArray &payload) {
+    const uchar *begin = (const uchar*) buffer.constData();
+    const uchar *end = begin + buffer.size();
+    if(begin == end) return false;
+    const uchar *p = begin + 1;
+    quint64 size;
+    if(!readVarint(p, end, size) || size > (quint64)(end - p))
+        return false;
+    type = *begin;
+    payload = QByteArray((const char*) p, size);
+    buffer.remove(0, (p - begin) + size);
+    return true;
+}
+
+namespace {
+
+// Heading deltas go the short way round
+qint64 headingDelta(qint32 to, qint32 from) {
+    qint32 d = (to - from) % HEADING_STEPS;
+    if(d >= HEADING_STEPS / 2) d -= HEADING_STEPS;
+    if(d < -HEADING_STEPS / 2) d += HEADING_STEPS;
+    return d;
+}
+
+int changes(const ReplicatedVessel &v, const ReplicatedVessel &base) {
+    int mask = 0;
+    if(v.x != base.x) mask |= ReplicatedX;
+    if(v.y != base.y) mask |= ReplicatedY;
+    if(v.depth != base.depth) mask |= ReplicatedDepth;
+    if(v.heading != base.heading) mask |= ReplicatedHeading;
+    if(v.speed != base.speed) mask |= ReplicatedSpeed;
+    if(v.type != base.type) mask |= ReplicatedType;
+    return mask;
+}
+
+void appendEntry(QByteArray &out, int &lastId, int id, int mask, const ReplicatedVessel *v, const ReplicatedVessel &base) {
+    appendVarint(out, id - lastId);
+    lastId = id;
+    out.append((char) mask);
+    if(mask & ReplicatedX) appendVarint(out, zigzag(v->x - base.x));
+    if(mask & ReplicatedY) appendVarint(out, zigzag(v->y - base.y));
+    if(mask & ReplicatedDepth) appendVarint(out, zigzag(v->depth - base.depth));
+    if(mask & ReplicatedHeading) appendVarint(out, zigzag(headingDelta(v->heading, base.heading)));
+    if(mask & ReplicatedSpeed) appendVarint(out, zigzag(v->speed - base.speed));
+    if(mask & ReplicatedType) appendVarint(out, zigzag(v->type - base.type));
+}
+
+bool readDelta(const uchar *&p, const uchar *end, qint32 &field) {
+    quint64 v;
+    if(!readVarint(p, end, v)) return false;
+    field += (qint32) unzigzag(v);
+    return true;
+}
+
+}
+
+void encodeSnapshot(const ReplicaSnapshot &current, const ReplicaSnapshot *baseline, QByteArray &out) {
+    static const QVector<ReplicatedVessel> none;
+    const QVector<ReplicatedVessel> &base = baseline ? baseline->vessels : none;
+    ReplicatedVessel zero;
+    memset(&zero, 0, sizeof(zero));
+    QByteArray entries;
+    int count = 0, lastId = 0;
+    int j = 0;
+    for(int i=0;i<current.vessels.size();i++) {
+        const ReplicatedVessel &v = current.vessels[i];
+        for(;j<base.size() && base[j].id < v.id;j++, count++)
+            appendEntry(entries, lastId, base[j].id, ReplicatedRemoved, 0, zero);
+        if(j < base.size() && base[j].id == v.id) {
+            int mask = changes(v, base[j]);
+            if(mask) {
+                appendEntry(entries, lastId, v.id, mask, &v, base[j]);
+                count++;
+            }
+            j++;
+        } else {
+            appendEntry(entries, lastId, v.id, ReplicatedAll, &v, zero);
+            count++;
+        }
+    }
+    for(;j<base.size();j++, count++)
+        appendEntry(entries, lastId, base[j].id, ReplicatedRemoved, 0, zero);
+
+    out.resize(0);
+    appendVarint(out, current.sequence);
+    appendVarint(out, baseline ? baseline->sequence + 1 : 0);
+    appendVarint(out, current.tick);
+    appendVarint(out, count);
+    out.append(entries);
+}
+
+bool decodeSnapshot(const QByteArray &payload, const ReplicaHistory &history, ReplicaSnapshot &out) {
+    const uchar *p = (const uchar*) payload.constData();
+    const uchar *end = p + payload.size();
+    quint64 sequence, baselineSequence, tick, count;
+    if(!readVarint(p, end, sequence) || !readVarint(p, end, baselineSequence)
+            || !readVarint(p, end, tick) || !readVarint(p, end, count))
+        return false;
+    static const QVector<ReplicatedVessel> none;
+    const QVector<ReplicatedVessel> *base = &none;
+    if(baselineSequence) {
+        const ReplicaSnapshot *baseline = history.find(baselineSequence - 1);
+        if(!baseline) return false;
+        base = &baseline->vessels;
+    }
+    out.sequence = sequence;
+    out.tick = tick;
+    out.vessels.resize(0);
+    out.vessels.reserve(base->size() + count);
+    int j = 0, id = 0;
+    for(quint64 i=0;i<count;i++) {
+        quint64 idDelta;
+        if(!readVarint(p, end, idDelta) || p >= end) return false;
+        id += idDelta;
+        int mask = *p++;
+        for(;j<base->size() && base->at(j).id < id;j++)
+            out.vessels.append(base->at(j));
+        ReplicatedVessel v;
+        if(j < base->size() && base->at(j).id == id) {
+            v = base->at(j);
+            j++;
+        } else {
+            memset(&v, 0, sizeof(v));
+            v.id = id;
+        }
+        if(mask & ReplicatedRemoved) continue;
+        if((mask & ReplicatedX) && !readDelta(p, end, v.x)) return false;
+        if((mask & ReplicatedY) && !readDelta(p, end, v.y)) return false;
+        if((mask & ReplicatedDepth) && !readDelta(p, end, v.depth)) return false;
+        if(mask & ReplicatedHeading) {
+            if(!readDelta(p, end, v.heading)) return false;
+            v.heading = ((v.heading % HEADING_STEPS) + HEADING_STEPS) % HEADING_STEPS;
+        }
+        if((mask & ReplicatedSpeed) && !readDelta(p, end, v.speed)) return false;
+        if((mask & ReplicatedType) && !readDelta(p, end, v.type)) return false;
+        out.vessels.append(v);
+    }
+    for(;j<base->size();j++)
+        out.vessels.append(base->at(j));
+    return true;
+}
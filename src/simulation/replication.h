@@ -0,0 +1,95 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+class Vessel;
+
+/*
+ * Session wire format, used by SessionServer and SessionClient over local
+ * or TCP sockets. Messages are a type byte, a varint payload size and the
+ * payload:
+ *
+ *   HELLO     client asks to join, empty
+ *   WELCOME   varint id of the player's sub
+ *   COMMAND   varint type, zigzag value, zigzag direction in 1/1000
+ *             degrees; the server fills in the player
+ *   ACK       zigzag sequence number of the newest snapshot the client
+ *             decoded, -1 asks for a full snapshot
+ *   SNAPSHOT  varint sequence number, varint baseline sequence number + 1
+ *             (0: none), varint tick, varint entry count, then per entry
+ *             varint id delta to the previous
+ *             entry, a change mask byte and zigzag deltas against the
+ *             baseline for the fields in the mask. A vessel missing from
+ *             the entries is as in the baseline; REMOVED drops it.
+ *
+ * Fields are quantized: positions and depth in decimeters, heading in
+ * 1/100 degrees (deltas wrap around), speed in cm/s.
+ */
+enum ReplicationMessage {
+    ReplicationHello = 1,
+    ReplicationWelcome = 2,
+    ReplicationCommand = 3,
+    ReplicationAck = 4,
+    ReplicationSnapshot = 5
+};
+
+enum ReplicatedField {
+    ReplicatedX = 1,
+    ReplicatedY = 2,
+    ReplicatedDepth = 4,
+    ReplicatedHeading = 8,
+    ReplicatedSpeed = 16,
+    ReplicatedType = 32,
+    ReplicatedAll = 63,
+    ReplicatedRemoved = 128
+};
+
+struct ReplicatedVessel
+{
+    qint32 id;
+    qint32 x, y, depth, heading, speed, type;
+};
+
+// Vessels in id order. The server numbers the snapshots it sends each
+// client in order and baselines are found by that number; the tick is only
+// carried along, it repeats after Simulation::rewind().
+struct ReplicaSnapshot
+{
+    qint32 sequence, tick;
+    QVector<ReplicatedVessel> vessels;
+};
+
+// The snapshots a delta can be against: sent and not yet acknowledged on
+// the server, received on the client
+class ReplicaHistory
+{
+public:
+    explicit ReplicaHistory(int capacity = 64);
+    void clear();
+    const ReplicaSnapshot *find(int sequence) const;
+    void add(const ReplicaSnapshot &snapshot);
+    // Drops the snapshots numbered before sequence
+    void dropBefore(int sequence);
+private:
+    QVector<ReplicaSnapshot> ring;
+    int capacity;
+};
+
+void quantizeVessel(const Vessel *v, ReplicatedVessel &r);
+double dequantizePosition(qint32 v);
+double dequantizeHeading(qint32 v);
+double dequantizeSpeed(qint32 v);
+
+void appendMessage(QByteArray &out, int type, const QByteArray &payload);
+// Takes the first whole message off the front of buffer
+bool takeMessage(QByteArray &buffer, int &type, QByteArray &payload);
+
+void encodeSnapshot(const ReplicaSnapshot &current, const ReplicaSnapshot *baseline, QByteArray &out);
+// Finds the baseline in history; false if it is not there or the payload is
+// broken
+bool decodeSnapshot(const QByteArray &payload, const ReplicaHistory &history, ReplicaSnapshot &out);
+
+#endif // REPLICATION_H
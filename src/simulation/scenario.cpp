@@ -0,0 +1,239 @@
+#include "scenario.h"
+#include "vessel.h"
+#include <QTextStream>
+#include <QStringList>
+#include <QDebug>
+#include <string.h>
+#include <math.h>
+
+static int typeFromName(const QString &name) {
+    if(name == "sub") return 0;
+    if(name == "ship") return 1;
+    if(name == "torpedo") return 2;
+    bool ok;
+    int type = name.toInt(&ok);
+    return ok ? type : -1;
+}
+
+static const char *typeName(int type) {
+    switch(type) {
+    case 0: return "sub";
+    case 1: return "ship";
+    case 2: return "torpedo";
+    }
+    return 0;
+}
+
+static int behaviourFromName(const QString &name) {
+    if(name == "transit") return ShipTransit;
+    if(name == "zigzag") return ShipZigZag;
+    if(name == "convoy") return ShipConvoy;
+    return -1;
+}
+
+static const char *behaviourName(int behaviour) {
+    switch(behaviour) {
+    case ShipZigZag: return "zigzag";
+    case ShipConvoy: return "convoy";
+    }
+    return "transit";
+}
+
+Scenario::Scenario() : mapped(0), recordData(0), recordCount(0)
+{
+}
+
+Scenario::~Scenario() {
+    close();
+}
+
+void Scenario::close() {
+    if(mapped)
+        file.unmap(mapped);
+    mapped = 0;
+    file.close();
+    parsed.clear();
+    recordData = 0;
+    recordCount = 0;
+}
+
+bool Scenario::open(const QString &fileName) {
+    close();
+    error.clear();
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    ScenarioHeader header;
+    if(file.read((char*) &header, sizeof(header)) == sizeof(header)
+            && header.magic == SCENARIO_MAGIC) {
+        if(header.version != SCENARIO_VERSION || header.recordSize != sizeof(ScenarioRecord)) {
+            error = "unsupported scenario version";
+            close();
+            return false;
+        }
+        qint64 size = sizeof(ScenarioHeader) + (qint64) header.count * sizeof(ScenarioRecord);
+        if(file.size() < size) {
+            error = "truncated scenario";
+            close();
+            return false;
+        }
+        mapped = file.map(0, size);
+        if(!mapped) {
+            error = file.errorString();
+            close();
+            return false;
+        }
+        const ScenarioRecord *records = reinterpret_cast<const ScenarioRecord*>(mapped + sizeof(ScenarioHeader));
+        for(quint32 i=0;i<header.count;i++) {
+            if(!isValidRecord(records[i])) {
+                error = QString("record %1 is not a valid ship").arg(i);
+                close();
+                return false;
+            }
+        }
+        recordData = records;
+        recordCount = header.count;
+        return true;
+    }
+    file.close();
+    if(!parseText(fileName, parsed, &error)) {
+        close();
+        return false;
+    }
+    recordData = parsed.constData();
+    recordCount = parsed.size();
+    return true;
+}
+
+Vessel *Scenario::createVessels(int firstId) const {
+    if(!recordCount) return 0;
+    Vessel *vessels = new Vessel[recordCount];
+    for(int i=0;i<recordCount;i++) {
+        const ScenarioRecord &r = recordData[i];
+        Vessel &v = vessels[i];
+        v.id = firstId + i;
+        v.type = r.type;
+        v.x = r.x;
+        v.y = r.y;
+        v.heading = r.heading;
+        v.speed = r.speed;
+        v.speedCommand = r.speedCommand;
+        v.depth = r.depth;
+        v.helm = r.helm;
+        v.ai.behaviour = r.behaviour;
+        v.ai.baseCourse = r.heading;
+        v.ai.baseSpeed = r.speedCommand;
+        v.ai.baseHelm = r.helm;
+    }
+    // Convoy ships keep the station they start at, relative to their guide
+    int guide = -1;
+    for(int i=0;i<recordCount;i++) {
+        Vessel &v = vessels[i];
+        if(v.ai.behaviour != ShipConvoy) {
+            guide = i;
+            continue;
+        }
+        if(guide < 0) {
+            v.ai.behaviour = ShipTransit;
+            continue;
+        }
+        const Vessel &g = vessels[guide];
+        double dx = v.x - g.x;
+        double dy = v.y - g.y;
+        double h = g.heading * (M_PI/180.0);
+        v.ai.guideId = g.id;
+        v.ai.formationX = dx * cos(h) + dy * sin(h);
+        v.ai.formationY = dx * sin(h) - dy * cos(h);
+    }
+    return vessels;
+}
+
+bool Scenario::parseText(const QString &fileName, QVector<ScenarioRecord> &records, QString *error) {
+    QFile in(fileName);
+    if(!in.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if(error) *error = in.errorString();
+        return false;
+    }
+    records.clear();
+    QTextStream stream(&in);
+    int lineNumber = 0;
+    while(!stream.atEnd()) {
+        QString line = stream.readLine();
+        lineNumber++;
+        int comment = line.indexOf('#');
+        if(comment >= 0) line = line.left(comment);
+        QStringList fields = line.split(' ', QString::SkipEmptyParts);
+        if(fields.isEmpty()) continue;
+
+        ScenarioRecord r;
+        memset(&r, 0, sizeof(r));
+        bool ok = fields.size() >= 7 && fields.size() <= 9;
+        if(ok) {
+            bool fieldOk[7];
+            int type = typeFromName(fields[0]);
+            r.type = type;
+            r.x = fields[1].toDouble(&fieldOk[0]);
+            r.y = fields[2].toDouble(&fieldOk[1]);
+            r.heading = fields[3].toFloat(&fieldOk[2]);
+            r.speed = fields[4].toFloat(&fieldOk[3]);
+            r.speedCommand = fields[5].toFloat(&fieldOk[4]);
+            r.helm = fields[6].toInt(&fieldOk[5]);
+            fieldOk[6] = true;
+            if(fields.size() >= 8)
+                r.depth = fields[7].toFloat(&fieldOk[6]);
+            int behaviour = fields.size() == 9 ? behaviourFromName(fields[8]) : ShipTransit;
+            r.behaviour = behaviour;
+            ok = type >= 0 && behaviour >= 0;
+            for(int i=0;i<7;i++)
+                ok = ok && fieldOk[i];
+        }
+        if(!ok) {
+            if(error) *error = QString("%1:%2: can't parse vessel").arg(fileName).arg(lineNumber);
+            return false;
+        }
+        if(!isValidRecord(r)) {
+            if(error) *error = QString("%1:%2: only ships can be placed").arg(fileName).arg(lineNumber);
+            return false;
+        }
+        records.append(r);
+    }
+    return true;
+}
+
+bool Scenario::isValidRecord(const ScenarioRecord &record) {
+    return record.type == 1 && record.behaviour >= ShipTransit && record.behaviour <= ShipConvoy;
+}
+
+bool Scenario::writeBinary(const QString &fileName, const ScenarioRecord *records, int count) {
+    QFile out(fileName);
+    if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    ScenarioHeader header;
+    header.magic = SCENARIO_MAGIC;
+    header.version = SCENARIO_VERSION;
+    header.count = count;
+    header.recordSize = sizeof(ScenarioRecord);
+    qint64 size = (qint64) count * sizeof(ScenarioRecord);
+    return out.write((const char*) &header, sizeof(header)) == sizeof(header)
+            && out.write((const char*) records, size) == size;
+}
+
+bool Scenario::writeText(const QString &fileName, const ScenarioRecord *records, int count) {
+    QFile out(fileName);
+    if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    QTextStream stream(&out);
+    stream << "# type x y heading speed speedCommand helm depth ai\n";
+    for(int i=0;i<count;i++) {
+        const ScenarioRecord &r = records[i];
+        const char *name = typeName(r.type);
+        if(name) stream << name;
+        else stream << r.type;
+        stream << ' ' << QString::number(r.x, 'f', 2) << ' ' << QString::number(r.y, 'f', 2)
+               << ' ' << r.heading << ' ' << r.speed << ' ' << r.speedCommand
+               << ' ' << (int) r.helm << ' ' << r.depth << ' ' << behaviourName(r.behaviour) << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <QString>
+#include <QFile>
+#include <QVector>
+#include <QtGlobal>
+
+class Vessel;
+
+#define SCENARIO_MAGIC 0x4e435356 // "VSCN"
+#define SCENARIO_VERSION 1
+
+// Binary scenario layout (host byte order, little endian on all our
+// targets): a ScenarioHeader followed by count ScenarioRecords. Records are
+// 8-byte aligned so they can be used straight from the mapped file.
+struct ScenarioHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+    quint32 recordSize;
+};
+
+struct ScenarioRecord
+{
+    double x, y;
+    float heading, speed, speedCommand, depth;
+    qint16 type;
+    qint8 helm;
+    // ShipBehaviour, see vessel.h
+    qint8 behaviour;
+    qint8 reserved[4];
+};
+
+/*
+ * A set of vessels to start the simulation with.
+ *
+ * Binary scenarios (.vsc) are memory-mapped and used in place. Anything else
+ * is parsed as the text source form, one vessel per line:
+ *
+ *   # type  x      y      heading  speed  speedCommand  helm  [depth [ai]]
+ *   ship    500   -1000   90       10     0             1     0      zigzag
+ *
+ * ai is transit (the default), zigzag or convoy. Convoy ships keep station
+ * on the nearest ship above them that is not itself a convoy ship.
+ *
+ * Only ships can be placed: subs and torpedoes are objects of their own
+ * the simulation creates, so files with any other type are rejected.
+ */
+class Scenario
+{
+public:
+    Scenario();
+    ~Scenario();
+
+    bool open(const QString &fileName);
+    void close();
+    QString errorString() const { return error; }
+
+    int count() const { return recordCount; }
+    const ScenarioRecord *records() const { return recordData; }
+
+    // Constructs all vessels of the scenario in one allocation, with ids
+    // firstId, firstId+1, ... The caller owns the array (delete[]).
+    Vessel *createVessels(int firstId) const;
+
+    // Whether a record is something a scenario may contain, see above
+    static bool isValidRecord(const ScenarioRecord &record);
+    static bool parseText(const QString &fileName, QVector<ScenarioRecord> &records, QString *error = 0);
+    static bool writeBinary(const QString &fileName, const ScenarioRecord *records, int count);
+    static bool writeText(const QString &fileName, const ScenarioRecord *records, int count);
+
+private:
+    Q_DISABLE_COPY(Scenario)
+
+    QFile file;
+    uchar *mapped;
+    QVector<ScenarioRecord> parsed;
+    const ScenarioRecord *recordData;
+    int recordCount;
+    QString error;
+};
+
+#endif // SCENARIO_H
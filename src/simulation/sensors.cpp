@@ -0,0 +1,67 @@
+#include "sensors.h"
+#include "vessel.h"
+#include "worldpartition.h"
+#include <math.h>
+
+#define HYDROPHONE_BASE_RANGE 3000
+#define HYDROPHONE_RANGE_PER_SPEED 1000
+#define HYDROPHONE_MAX_RANGE 15000
+#define HYDROPHONE_BEARING_SIGMA 1.5
+// Own speed above which the flow noise masks everything
+#define HYDROPHONE_DEAF_SPEED 8
+#define PERISCOPE_DEPTH 15
+#define PERISCOPE_RANGE 8000
+#define PERISCOPE_BEARING_SIGMA 0.5
+// Relative error of a stadimeter range
+#define PERISCOPE_RANGE_ERROR 0.1
+
+// Standard normal from a hash of the tick, contact and draw
+static double gaussian(int tick, int contact, int draw) {
+    quint64 h = 14695981039346656037ULL;
+    int values[3] = { tick, contact, draw };
+    for(int i=0;i<3;i++)
+        h = (h ^ (quint32) values[i]) * 1099511628211ULL;
+    h ^= h >> 29;
+    double u1 = ((h >> 11) & 0xfffff) / 1048576.0 + 0.5 / 1048576.0;
+    double u2 = ((h >> 31) & 0xfffff) / 1048576.0;
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+void SensorModel::sweep(const Vessel *observer, const WorldPartition &partition, double time, int tick,
+                        QVector<SensorDetection> &out) {
+    out.resize(0);
+    bool listening = observer->speed < HYDROPHONE_DEAF_SPEED;
+    bool looking = observer->depth <= PERISCOPE_DEPTH;
+    if(!listening && !looking) return;
+    nearby.resize(0);
+    partition.collect(observer->x, observer->y, HYDROPHONE_MAX_RANGE, nearby);
+    for(int i=0;i<nearby.size();i++) {
+        const Vessel *v = nearby[i];
+        if(v->type != 1 || v->pendingRemoval) continue;
+        double dx = v->x - observer->x, dy = v->y - observer->y;
+        double range = sqrt(dx * dx + dy * dy);
+        double hearing = qMin((double) HYDROPHONE_MAX_RANGE,
+                              HYDROPHONE_BASE_RANGE + HYDROPHONE_RANGE_PER_SPEED * v->speed);
+        bool heard = listening && range < hearing;
+        bool seen = looking && range < PERISCOPE_RANGE;
+        if(!heard && !seen) continue;
+        double bearing = atan2(dx, -dy) * (180.0/M_PI);
+        SensorDetection d;
+        d.sensor = seen ? SensorDetection::Periscope : SensorDetection::Hydrophone;
+        d.contact = v->id;
+        d.time = time;
+        d.observerX = observer->x;
+        d.observerY = observer->y;
+        d.bearingSigma = seen ? PERISCOPE_BEARING_SIGMA : HYDROPHONE_BEARING_SIGMA;
+        d.bearing = fmod(bearing + d.bearingSigma * gaussian(tick, v->id, 0) + 360, 360);
+        if(seen) {
+            d.rangeSigma = range * PERISCOPE_RANGE_ERROR;
+            d.range = qMax(0.0, range + d.rangeSigma * gaussian(tick, v->id, 1));
+            d.maxRange = PERISCOPE_RANGE;
+        } else {
+            d.range = d.rangeSigma = -1;
+            d.maxRange = HYDROPHONE_MAX_RANGE;
+        }
+        out.append(d);
+    }
+}
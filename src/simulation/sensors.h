@@ -0,0 +1,47 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <QVector>
+
+class Vessel;
+class WorldPartition;
+
+// Ticks between sensor sweeps, one a second at the 50 ms tick
+#define SENSOR_INTERVAL 20
+
+// What a sensor made of one contact in one sweep. Bearings are in degrees
+// like headings, from the observer to the contact.
+struct SensorDetection
+{
+    enum Sensor { Hydrophone, Periscope };
+    int sensor;
+    // The sonar tells contacts apart by their sound; the vessel id stands
+    // for that classification
+    int contact;
+    double time;
+    double observerX, observerY;
+    double bearing, bearingSigma;
+    // Periscope observations only, negative when unknown
+    double range, rangeSigma;
+    // How far out the sensor reaches at best
+    double maxRange;
+};
+
+/*
+ * The own sub's sensors. Hydrophones hear ships from further off the faster
+ * they go, unless the sub is fast enough to drown them in its own noise;
+ * at periscope depth nearby ships are also seen, with a stadimeter range.
+ *
+ * Noise is drawn from the tick and the contact, so a replay detects the
+ * same.
+ */
+class SensorModel
+{
+public:
+    void sweep(const Vessel *observer, const WorldPartition &partition, double time, int tick,
+               QVector<SensorDetection> &out);
+private:
+    QVector<Vessel*> nearby;
+};
+
+#endif // SENSORS_H
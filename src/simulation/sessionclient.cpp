@@ -0,0 +1,98 @@
+#include "sessionclient.h"
+#include "simulationstate.h"
+#include "recordingformat.h"
+#include <QDebug>
+
+SessionClient::SessionClient(QObject *parent) :
+    QObject(parent), device(0), player(0), received(0)
+{
+    current.sequence = current.tick = -1;
+}
+
+void SessionClient::connectToLocal(const QString &name) {
+    device = &localSocket;
+    connect(&localSocket, SIGNAL(connected()), this, SLOT(connected()));
+    connect(&localSocket, SIGNAL(readyRead()), this, SLOT(readMessages()));
+    localSocket.connectToServer(name);
+}
+
+void SessionClient::connectToHost(quint16 port) {
+    device = &tcpSocket;
+    connect(&tcpSocket, SIGNAL(connected()), this, SLOT(connected()));
+    connect(&tcpSocket, SIGNAL(readyRead()), this, SLOT(readMessages()));
+    tcpSocket.connectToHost(QHostAddress::LocalHost, port);
+    tcpSocket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+}
+
+void SessionClient::connected() {
+    send(ReplicationHello, QByteArray());
+}
+
+void SessionClient::readMessages() {
+    QByteArray data = device->readAll();
+    received += data.size();
+    in.append(data);
+    int type;
+    QByteArray body;
+    while(takeMessage(in, type, body)) {
+        if(type == ReplicationWelcome) {
+            const uchar *p = (const uchar*) body.constData();
+            quint64 id;
+            if(!readVarint(p, p + body.size(), id)) continue;
+            player = id;
+            emit joined(player);
+        } else if(type == ReplicationSnapshot) {
+            ReplicaSnapshot snapshot;
+            if(!decodeSnapshot(body, history, snapshot)) {
+                // Lost the baseline; start over from a full snapshot
+                qWarning() << Q_FUNC_INFO << "undecodable snapshot";
+                history.clear();
+                sendAck(-1);
+                continue;
+            }
+            current = snapshot;
+            history.add(current);
+            sendAck(current.sequence);
+            emit snapshotReceived(current.tick);
+        } else {
+            qWarning() << Q_FUNC_INFO << "unknown message" << type;
+        }
+    }
+}
+
+void SessionClient::send(int type, const QByteArray &body) {
+    if(!device) return;
+    out.resize(0);
+    appendMessage(out, type, body);
+    device->write(out);
+}
+
+void SessionClient::sendCommand(int type, int value, double direction) {
+    payload.resize(0);
+    appendVarint(payload, type);
+    appendVarint(payload, zigzag(value));
+    appendVarint(payload, zigzag(qRound(direction * 1000)));
+    send(ReplicationCommand, payload);
+}
+
+void SessionClient::sendAck(int sequence) {
+    payload.resize(0);
+    appendVarint(payload, zigzag(sequence));
+    send(ReplicationAck, payload);
+}
+
+void SessionClient::setHelm(int h) {
+    sendCommand(SimulationCommand::Helm, h);
+}
+
+void SessionClient::setSpeed(int s) {
+    sendCommand(SimulationCommand::Speed, s);
+}
+
+void SessionClient::setDepthChange(int s) {
+    sendCommand(SimulationCommand::DepthChange, s);
+}
+
+void SessionClient::fireTorpedo(double direction, int mode) {
+    sendCommand(SimulationCommand::FireTorpedo, mode, direction);
+}
@@ -0,0 +1,50 @@
+#ifndef SESSIONCLIENT_H
+#define SESSIONCLIENT_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include "replication.h"
+#include "sessionserver.h"
+
+// A player in a SessionServer's session: joins, steers its own sub and
+// keeps the world around it as replicated by the server
+class SessionClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionClient(QObject *parent = 0);
+    void connectToLocal(const QString &name = SESSION_SOCKET_NAME);
+    void connectToHost(quint16 port);
+    // Id of the player's sub, 0 until joined
+    int playerId() const { return player; }
+    // The newest snapshot, in id order
+    const ReplicaSnapshot &world() const { return current; }
+    qint64 bytesReceived() const { return received; }
+public slots:
+    void setHelm(int h);
+    void setSpeed(int s);
+    void setDepthChange(int s);
+    void fireTorpedo(double direction, int mode = 0);
+signals:
+    void joined(int playerId);
+    void snapshotReceived(int tick);
+private slots:
+    void connected();
+    void readMessages();
+private:
+    void send(int type, const QByteArray &payload);
+    void sendCommand(int type, int value, double direction = 0);
+    void sendAck(int sequence);
+
+    QLocalSocket localSocket;
+    QTcpSocket tcpSocket;
+    QIODevice *device;
+    QByteArray in, out, payload;
+    int player;
+    ReplicaSnapshot current;
+    ReplicaHistory history;
+    qint64 received;
+};
+
+#endif // SESSIONCLIENT_H
@@ -0,0 +1,212 @@
+#include "sessionserver.h"
+#include "simulation.h"
+#include "recordingformat.h"
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QDebug>
+
+SessionServer::SessionServer(Simulation *s, QObject *parent) :
+    QObject(parent), simulation(s)
+{
+    sent.bytes = 0;
+    sent.snapshots = sent.fullSnapshots = 0;
+    connect(&localServer, SIGNAL(newConnection()), this, SLOT(newLocalConnection()));
+    connect(&tcpServer, SIGNAL(newConnection()), this, SLOT(newTcpConnection()));
+    connect(simulation, SIGNAL(playerAdded(Vessel*)), this, SLOT(playerAdded(Vessel*)));
+}
+
+SessionServer::~SessionServer() {
+    qDeleteAll(peers);
+}
+
+bool SessionServer::listen(const QString &name, quint16 tcpPort) {
+    QLocalServer::removeServer(name);
+    if(!localServer.listen(name)) {
+        qWarning() << Q_FUNC_INFO << "can't listen on" << name << localServer.errorString();
+        return false;
+    }
+    if(tcpPort && !tcpServer.listen(QHostAddress::LocalHost, tcpPort)) {
+        qWarning() << Q_FUNC_INFO << "can't listen on port" << tcpPort << tcpServer.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SessionServer::newLocalConnection() {
+    while(localServer.hasPendingConnections())
+        addPeer(localServer.nextPendingConnection());
+}
+
+void SessionServer::newTcpConnection() {
+    while(tcpServer.hasPendingConnections()) {
+        QTcpSocket *socket = tcpServer.nextPendingConnection();
+        // Snapshots are small and latency matters more than packet count
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        addPeer(socket);
+    }
+}
+
+void SessionServer::addPeer(QIODevice *device) {
+    Peer *peer = new Peer;
+    peer->device = device;
+    peer->playerId = 0;
+    peer->ackedSequence = -1;
+    peer->nextSequence = 0;
+    peers.append(peer);
+    connect(device, SIGNAL(readyRead()), this, SLOT(readMessages()));
+    connect(device, SIGNAL(disconnected()), this, SLOT(disconnected()));
+    qDebug() << Q_FUNC_INFO << peers.size() << "session clients";
+}
+
+SessionServer::Peer *SessionServer::findPeer(QObject *device) {
+    foreach(Peer *peer, peers) {
+        if(peer->device == device)
+            return peer;
+    }
+    return 0;
+}
+
+void SessionServer::readMessages() {
+    Peer *peer = findPeer(sender());
+    if(!peer) return;
+    peer->in.append(peer->device->readAll());
+    int type;
+    QByteArray body;
+    while(takeMessage(peer->in, type, body))
+        handle(peer, type, body);
+}
+
+void SessionServer::handle(Peer *peer, int type, const QByteArray &body) {
+    const uchar *p = (const uchar*) body.constData();
+    const uchar *end = p + body.size();
+    switch(type) {
+    case ReplicationHello:
+        if(peer->playerId || joining.contains(peer)) break;
+        join(peer);
+        break;
+    case ReplicationCommand: {
+        quint64 commandType, value, direction;
+        if(!peer->playerId || !readVarint(p, end, commandType) || !readVarint(p, end, value)
+                || !readVarint(p, end, direction))
+            break;
+        // Players only steer and fire their own sub
+        if(commandType > SimulationCommand::FireTorpedo) {
+            qWarning() << Q_FUNC_INFO << "refused command" << (int) commandType;
+            break;
+        }
+        SimulationCommand command;
+        command.type = commandType;
+        command.value = unzigzag(value);
+        command.value2 = peer->playerId;
+        command.direction = unzigzag(direction) / 1000.0;
+        simulation->submitCommand(command);
+        break;
+    }
+    case ReplicationAck: {
+        quint64 sequence;
+        if(!readVarint(p, end, sequence)) break;
+        peer->ackedSequence = unzigzag(sequence);
+        if(peer->ackedSequence < 0)
+            peer->history.clear();
+        else
+            peer->history.dropBefore(peer->ackedSequence);
+        break;
+    }
+    default:
+        qWarning() << Q_FUNC_INFO << "unknown message" << type;
+    }
+}
+
+void SessionServer::join(Peer *peer) {
+    joining.append(peer);
+    // Side by side with the simulation's own sub, a kilometer apart
+    simulation->addPlayer(simulation->getSub()->x + 1000 * (simulation->players().size() + joining.size()),
+                          simulation->getSub()->y);
+}
+
+void SessionServer::playerAdded(Vessel *v) {
+    if(joining.isEmpty()) return;
+    Peer *peer = joining.takeFirst();
+    if(!peer) {
+        simulation->removePlayer(v->id);
+        return;
+    }
+    peer->playerId = v->id;
+    payload.resize(0);
+    appendVarint(payload, v->id);
+    message.resize(0);
+    appendMessage(message, ReplicationWelcome, payload);
+    peer->device->write(message);
+}
+
+void SessionServer::disconnected() {
+    Peer *peer = findPeer(sender());
+    if(!peer) return;
+    int waiting = joining.indexOf(peer);
+    if(waiting >= 0)
+        joining[waiting] = 0;
+    if(peer->playerId)
+        simulation->removePlayer(peer->playerId);
+    peers.removeAll(peer);
+    peer->device->deleteLater();
+    delete peer;
+    qDebug() << Q_FUNC_INFO << peers.size() << "session clients";
+}
+
+static bool lessById(const ReplicatedVessel &a, const ReplicatedVessel &b) {
+    return a.id < b.id;
+}
+
+// The world is quantized once per tick; each client then gets the vessels
+// within SESSION_INTEREST_RADIUS of its sub, as a delta against what it
+// acknowledged last, or in full when it has not acknowledged anything that
+// is still kept. A peer whose sub is gone, e.g. after a rewind to before it
+// joined, gets a new sub and a new welcome.
+void SessionServer::replicate() {
+    if(peers.isEmpty()) return;
+    const QVector<Vessel*> &vessels = simulation->vessels();
+    world.tick = simulation->tickCount();
+    world.vessels.resize(vessels.size() + 1);
+    quantizeVessel(simulation->getSub(), world.vessels[0]);
+    for(int i=0;i<vessels.size();i++)
+        quantizeVessel(vessels[i], world.vessels[i + 1]);
+    qSort(world.vessels.begin(), world.vessels.end(), lessById);
+
+    const qint64 radius = SESSION_INTEREST_RADIUS * 10;
+    foreach(Peer *peer, peers) {
+        if(!peer->playerId) continue;
+        ReplicatedVessel key;
+        key.id = peer->playerId;
+        QVector<ReplicatedVessel>::const_iterator own =
+                qLowerBound(world.vessels.constBegin(), world.vessels.constEnd(), key, lessById);
+        if(own == world.vessels.constEnd() || own->id != peer->playerId) {
+            qWarning() << Q_FUNC_INFO << "sub" << peer->playerId << "is gone, rejoining its player";
+            peer->playerId = 0;
+            peer->ackedSequence = -1;
+            peer->history.clear();
+            join(peer);
+            continue;
+        }
+        // Numbered per peer and never reset, so an ack can't name a
+        // snapshot sent before a rewind or a rejoin
+        interest.sequence = peer->nextSequence++;
+        interest.tick = world.tick;
+        interest.vessels.resize(0);
+        for(int i=0;i<world.vessels.size();i++) {
+            const ReplicatedVessel &v = world.vessels[i];
+            qint64 dx = v.x - own->x, dy = v.y - own->y;
+            if(dx * dx + dy * dy <= radius * radius)
+                interest.vessels.append(v);
+        }
+        const ReplicaSnapshot *baseline = peer->ackedSequence >= 0 ? peer->history.find(peer->ackedSequence) : 0;
+        encodeSnapshot(interest, baseline, payload);
+        message.resize(0);
+        appendMessage(message, ReplicationSnapshot, payload);
+        peer->device->write(message);
+        peer->history.add(interest);
+        sent.bytes += message.size();
+        sent.snapshots++;
+        if(!baseline)
+            sent.fullSnapshots++;
+    }
+}
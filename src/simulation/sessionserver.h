@@ -0,0 +1,75 @@
+#ifndef SESSIONSERVER_H
+#define SESSIONSERVER_H
+
+#include <QObject>
+#include <QList>
+#include <QLocalServer>
+#include <QTcpServer>
+#include "replication.h"
+
+#define SESSION_SOCKET_NAME "vesikko-session"
+// Meters around a player's sub that get replicated to the player
+#define SESSION_INTEREST_RADIUS 20000
+
+class Simulation;
+class Vessel;
+
+/*
+ * Multiplayer session: every client that says hello gets a sub of its own
+ * and, after each tick, a snapshot of the world around that sub as a delta
+ * against the newest snapshot it has acknowledged (see replication.h).
+ * Clients connect over a local socket or, with a port, TCP on localhost;
+ * vesikko-view session is the trainee's station.
+ */
+class SessionServer : public QObject
+{
+    Q_OBJECT
+public:
+    SessionServer(Simulation *simulation, QObject *parent = 0);
+    ~SessionServer();
+    // tcpPort 0 listens on the local socket only
+    bool listen(const QString &name = SESSION_SOCKET_NAME, quint16 tcpPort = 0);
+    int clientCount() const { return peers.size(); }
+    // Snapshot bytes sent so far, framing included
+    struct Stats
+    {
+        qint64 bytes;
+        int snapshots, fullSnapshots;
+    };
+    Stats stats() const { return sent; }
+public slots:
+    // Connected to Simulation::tickTime
+    void replicate();
+private slots:
+    void newLocalConnection();
+    void newTcpConnection();
+    void readMessages();
+    void disconnected();
+    void playerAdded(Vessel *v);
+private:
+    struct Peer
+    {
+        QIODevice *device;
+        QByteArray in;
+        int playerId, ackedSequence, nextSequence;
+        ReplicaHistory history;
+    };
+    void addPeer(QIODevice *device);
+    // Asks the simulation for a sub for the peer, welcomed in playerAdded()
+    void join(Peer *peer);
+    Peer *findPeer(QObject *device);
+    void handle(Peer *peer, int type, const QByteArray &payload);
+
+    Simulation *simulation;
+    QLocalServer localServer;
+    QTcpServer tcpServer;
+    QList<Peer*> peers;
+    // Peers waiting for their sub in hello order, 0 for one that left
+    QList<Peer*> joining;
+    // The whole world of the tick in id order, and one client's share of it
+    ReplicaSnapshot world, interest;
+    QByteArray payload, message;
+    Stats sent;
+};
+
+#endif // SESSIONSERVER_H
@@ -0,0 +1,74 @@
+#include "sharedworld.h"
+#include <QDebug>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+SharedWorldReader::SharedWorldReader() : fd(-1), size(0), mapped(0)
+{
+}
+
+SharedWorldReader::~SharedWorldReader() {
+    close();
+}
+
+bool SharedWorldReader::open(const QString &name) {
+    close();
+    fd = shm_open(name.toLocal8Bit().constData(), O_RDONLY, 0);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(SharedWorldHeader)) {
+        close();
+        return false;
+    }
+    size = st.st_size;
+    void *p = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED) {
+        close();
+        return false;
+    }
+    mapped = (uchar*) p;
+    const SharedWorldHeader *header = (const SharedWorldHeader*) mapped;
+    if(header->magic != SHARED_WORLD_MAGIC || header->version != SHARED_WORLD_VERSION
+            || sizeof(SharedWorldHeader) + header->slotCount * (size_t) header->frameSize > size) {
+        qWarning() << Q_FUNC_INFO << name << "is not a published world";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SharedWorldReader::close() {
+    if(mapped)
+        munmap(mapped, size);
+    if(fd >= 0)
+        ::close(fd);
+    mapped = 0;
+    fd = -1;
+}
+
+int SharedWorldReader::capacity() const {
+    return mapped ? ((const SharedWorldHeader*) mapped)->capacity : 0;
+}
+
+const SharedWorldFrame *SharedWorldReader::beginRead(quint32 *seq) const {
+    if(!mapped) return 0;
+    const SharedWorldHeader *header = (const SharedWorldHeader*) mapped;
+    // A slot being written is never the newest for long
+    for(int attempt=0;attempt<SHARED_WORLD_SLOTS;attempt++) {
+        int slot = header->latest;
+        if(slot < 0 || slot >= (int) header->slotCount) return 0;
+        const SharedWorldFrame *f = (const SharedWorldFrame*)
+                (mapped + sizeof(SharedWorldHeader) + slot * (size_t) header->frameSize);
+        *seq = f->seq;
+        SHARED_WORLD_BARRIER();
+        if(!(*seq & 1) && f->count <= (int) header->capacity)
+            return f;
+    }
+    return 0;
+}
+
+bool SharedWorldReader::endRead(const SharedWorldFrame *frame, quint32 seq) const {
+    SHARED_WORLD_BARRIER();
+    return frame->seq == seq;
+}
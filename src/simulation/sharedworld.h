@@ -0,0 +1,95 @@
+#ifndef SHAREDWORLD_H
+#define SHAREDWORLD_H
+
+#include <QString>
+#include <QtGlobal>
+#include <stddef.h>
+
+#define SHARED_WORLD_MAGIC 0x444c5756 // "VWLD"
+#define SHARED_WORLD_VERSION 3
+// Frames in the ring. A reader has this many publishes to finish a frame
+// before the writer comes round to it again.
+#define SHARED_WORLD_SLOTS 4
+#define SHARED_WORLD_NAME "/vesikko-world"
+// Orders the sequence counters against the frame contents
+#define SHARED_WORLD_BARRIER() __sync_synchronize()
+
+/*
+ * World snapshot published by the simulation to POSIX shared memory, for
+ * views running in processes of their own.
+ *
+ * The segment is a SharedWorldHeader followed by SHARED_WORLD_SLOTS frames,
+ * each a SharedWorldFrame and capacity SharedVessels. The writer fills the
+ * slot after the newest one and then makes it the newest; it never waits
+ * for readers. Every frame is guarded by a sequence lock: seq is odd while
+ * the frame is written, and a reader that sees the same even seq before and
+ * after reading knows it read a whole frame.
+ */
+struct SharedVessel
+{
+    double x, y;
+    float depth, heading, speed, helm;
+    qint32 id;
+    qint16 type;
+    // Torpedo mode
+    qint16 mode;
+};
+
+struct SharedWorldFrame
+{
+    volatile quint32 seq;
+    // Frames published so far; unlike the tick it never repeats, not even
+    // after a rewind
+    quint32 number;
+    qint32 tick, total, count;
+    double time, dt;
+    // The newest explosion, and how many there have been
+    double explosionX, explosionY, explosionIntensity;
+    qint32 explosionCount;
+    // The torpedo data computer's solution, target 0 when none is selected
+    qint32 solutionTarget;
+    double solutionGyroAngle, solutionRunTime;
+    qint32 solutionValid;
+    // The sub comes first
+    SharedVessel vessels[1];
+};
+
+struct SharedWorldHeader
+{
+    quint32 magic, version, slotCount, capacity;
+    quint32 frameSize;
+    // Slot of the newest complete frame, -1 before the first
+    volatile qint32 latest;
+};
+
+// Frames are cache line aligned
+inline size_t sharedWorldFrameSize(int capacity) {
+    size_t size = offsetof(SharedWorldFrame, vessels) + capacity * sizeof(SharedVessel);
+    return (size + 63) & ~(size_t) 63;
+}
+
+// Zero-copy access to the newest frame of a published world
+class SharedWorldReader
+{
+public:
+    SharedWorldReader();
+    ~SharedWorldReader();
+    bool open(const QString &name = SHARED_WORLD_NAME);
+    void close();
+    bool isOpen() const { return mapped != 0; }
+    // Vessels a frame holds at most
+    int capacity() const;
+    // The newest frame, read in place, or 0 if there is none yet. The frame
+    // may be overwritten while it is being read: anything read from it is
+    // only good if endRead() then returns true.
+    const SharedWorldFrame *beginRead(quint32 *seq) const;
+    bool endRead(const SharedWorldFrame *frame, quint32 seq) const;
+
+private:
+    Q_DISABLE_COPY(SharedWorldReader)
+    int fd;
+    size_t size;
+    uchar *mapped;
+};
+
+#endif // SHAREDWORLD_H
@@ -0,0 +1,134 @@
+#include "shipai.h"
+#include "vessel.h"
+#include <math.h>
+
+#define ZIGZAG_LEG 40
+#define ZIGZAG_ANGLE 25
+#define EVADE_RANGE 3000
+#define EVADE_TIME 90
+#define EVADE_LEG 15
+#define EVADE_ANGLE 35
+#define EVADE_SPEED 20
+// Convoy station keeping: degrees of course per meter off the station
+// line, and knots per meter ahead of or behind the station
+#define CONVOY_COURSE_GAIN 0.1
+#define CONVOY_MAX_COURSE 30
+#define CONVOY_SPEED_GAIN 0.02
+#define CONVOY_MAX_SPEED_CHANGE 5
+
+namespace {
+
+double angleDifference(double to, double from) {
+    double d = fmod(to - from, 360.0);
+    if(d > 180) d -= 360;
+    if(d < -180) d += 360;
+    return d;
+}
+
+void steer(Vessel *v, double course) {
+    v->helm = qBound(-2.0, angleDifference(course, v->heading) / 5, 2.0);
+}
+
+// Alternates legs either side of course, each ship on its own phase
+double zigzag(const Vessel *v, double course, double time, double leg, double angle) {
+    int n = (int) floor(time / leg + (v->id % 7) / 7.0);
+    return course + ((n & 1) ? -angle : angle);
+}
+
+void think(Vessel *v, double time, const QVector<Vessel*> &vesselsById) {
+    ShipAiState &ai = v->ai;
+    if(ai.evadeUntil > 0) {
+        if(time < ai.evadeUntil) {
+            steer(v, zigzag(v, ai.evadeCourse, time, EVADE_LEG, EVADE_ANGLE));
+            v->speedCommand = EVADE_SPEED;
+            return;
+        }
+        ai.evadeUntil = 0;
+        v->helm = ai.baseHelm;
+        v->speedCommand = ai.baseSpeed;
+    }
+
+    switch(ai.behaviour) {
+    case ShipZigZag:
+        steer(v, zigzag(v, ai.baseCourse, time, ZIGZAG_LEG, ZIGZAG_ANGLE));
+        v->speedCommand = ai.baseSpeed;
+        break;
+    case ShipConvoy: {
+        const Vessel *guide = ai.guideId < vesselsById.size() ? vesselsById[ai.guideId] : 0;
+        if(!guide || guide->pendingRemoval || guide->verticalVelocity > 0) {
+            // Convoy scattered, carry on alone
+            ai.behaviour = ShipTransit;
+            ai.baseCourse = v->heading;
+            ai.baseHelm = 0;
+            v->helm = 0;
+            break;
+        }
+        double h = guide->heading * (M_PI/180.0);
+        double forwardX = sin(h), forwardY = -cos(h);
+        double stationX = guide->x + ai.formationX * cos(h) + ai.formationY * forwardX;
+        double stationY = guide->y + ai.formationX * sin(h) + ai.formationY * forwardY;
+        double dx = stationX - v->x;
+        double dy = stationY - v->y;
+        double ahead = dx * forwardX + dy * forwardY;
+        double right = dx * cos(h) + dy * sin(h);
+        double correction = qBound(-double(CONVOY_MAX_COURSE), right * CONVOY_COURSE_GAIN, double(CONVOY_MAX_COURSE));
+        steer(v, guide->heading + correction);
+        double speedChange = qBound(-double(CONVOY_MAX_SPEED_CHANGE), ahead * CONVOY_SPEED_GAIN, double(CONVOY_MAX_SPEED_CHANGE));
+        v->speedCommand = qBound(0.0, guide->speed + speedChange, double(EVADE_SPEED));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+}
+
+ShipAi::ShipAi() : slice(0), vesselsById(0), time(0)
+{
+}
+
+void ShipAi::rebuild(const QVector<Vessel*> &vessels) {
+    for(int i=0;i<SHIPAI_SLICES;i++)
+        slices[i].resize(0);
+    foreach(Vessel *v, vessels) {
+        if(v->type != 1) continue;
+        slices[v->id % SHIPAI_SLICES].append(v->id);
+    }
+}
+
+int ShipAi::prepare(int tick, double t, const QVector<Vessel*> *byId) {
+    slice = &slices[tick % SHIPAI_SLICES];
+    vesselsById = byId;
+    time = t;
+    return slice->size();
+}
+
+void ShipAi::run(int begin, int end) {
+    for(int i=begin;i<end;i++) {
+        int id = slice->at(i);
+        Vessel *v = id < vesselsById->size() ? vesselsById->at(id) : 0;
+        if(!v || v->pendingRemoval || v->verticalVelocity > 0 || v->lagTime > 0) continue;
+        think(v, time, *vesselsById);
+    }
+}
+
+bool ShipAi::decidesOn(const Vessel *v, int tick) {
+    return v->id % SHIPAI_SLICES == tick % SHIPAI_SLICES;
+}
+
+void ShipAi::alert(const QVector<Vessel*> &vessels, double x, double y, double time) {
+    foreach(Vessel *v, vessels) {
+        if(v->type != 1 || v->verticalVelocity > 0) continue;
+        double dx = v->x - x;
+        double dy = v->y - y;
+        if(dx*dx + dy*dy > EVADE_RANGE * EVADE_RANGE) continue;
+        if(v->ai.evadeUntil <= 0) {
+            // Remember what to go back to
+            v->ai.baseHelm = v->helm;
+            v->ai.baseSpeed = v->speedCommand;
+        }
+        v->ai.evadeCourse = atan2(dx, -dy) * (180.0/M_PI);
+        v->ai.evadeUntil = time + EVADE_TIME;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef SHIPAI_H
+#define SHIPAI_H
+
+#include <QVector>
+#include "workpool.h"
+
+class Vessel;
+
+// Ships are split into this many slices and one slice thinks per tick, so
+// at the 50 ms tick every ship decides twice a second
+#define SHIPAI_SLICES 10
+
+/*
+ * Decision stage for surface ships, run after the tick's kinematics.
+ *
+ * Transit ships keep their orders, zig-zagging escorts alternate legs
+ * around their base course, convoy ships keep station on their guide, and
+ * any ship near an explosion runs away for a while. A decision only reads
+ * kinematic state (position, heading, speed) and only writes the deciding
+ * ship's own orders and ShipAiState, so a slice can be decided in parallel
+ * and still come out the same on every run.
+ *
+ * As a job, [0, prepare()) are the ships of the slice whose turn it is.
+ */
+class ShipAi : public WorkJob
+{
+public:
+    ShipAi();
+    // Deals the ships out to slices, after loading or restoring
+    void rebuild(const QVector<Vessel*> &vessels);
+    // Picks the tick's slice and returns its size. vesselsById maps ids to
+    // live vessels.
+    int prepare(int tick, double time, const QVector<Vessel*> *vesselsById);
+    // Ships lagging behind in far sectors (see Simulation::integrateVessels)
+    // skip their turn
+    virtual void run(int begin, int end);
+    // Whether the ship's slice decides on tick
+    static bool decidesOn(const Vessel *v, int tick);
+    // Ships within range of an explosion at x, y start evading
+    void alert(const QVector<Vessel*> &vessels, double x, double y, double time);
+
+private:
+    QVector<int> slices[SHIPAI_SLICES];
+    const QVector<int> *slice;
+    const QVector<Vessel*> *vesselsById;
+    double time;
+};
+
+#endif // SHIPAI_H
@@ -1,121 +1,734 @@
 #include "simulation.h"
 #include "torpedo.h"
+#include "scenario.h"
+#include "simulationrecorder.h"
+#include "snapshotring.h"
+#include "../profiling/profiler.h"
 #include <QDebug>
+#include <functional>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
 
-Simulation::Simulation(QObject *parent) : QObject(parent), lastVesselId(0), sub(this, 0)
+// Vessels sinking deeper than this are removed from the simulation
+#define SINK_DEPTH 50
+// With a seabed: water a ship or a sub runs aground in, and the depth that
+// crushes a sub's hull
+#define SHIP_DRAUGHT 6
+#define SUB_DRAUGHT 4
+#define SUB_CRUSH_DEPTH 150
+// Torpedoes allocated up front, a salvo within this needs no allocation
+#define TORPEDO_POOL 32
+// Vessels per chunk in the parallel stages
+#define TICK_GRAIN 512
+// Fastest a contact moves, m/s, for finding hits against the contact grid
+#define MAX_CONTACT_SPEED 25
+// Meters a vessel in an inactive sector may be off its fully simulated
+// position
+#define LOD_MAX_ERROR 50
+
+Simulation::Simulation(QObject *parent) : QObject(parent), sub(this, 0), lastVesselId(0), ticks(0), lastTotal(0), totalBase(0),
+    scenarioFile("resources/scenarios/default.txt"), recorder(0), inputsEnabled(true), snapshotInterval(0),
+    simTime(0),
+    pool(new WorkPool),
+    contactsJob(this, &Simulation::buildContacts),
+    subJob(this, &Simulation::integrateSub),
+    integrateJob(this, &Simulation::integrateVessels),
+    collisionJob(this, &Simulation::findHits),
+    hitJob(this, &Simulation::handleHits),
+    retireJob(this, &Simulation::retireVessels),
+    tickDt(0), tickTotal(0)
 {
+    memset(&lod, 0, sizeof(lod));
+    freeTorpedoes.reserve(TORPEDO_POOL);
+    for(int i=0;i<TORPEDO_POOL;i++)
+        freeTorpedoes.append(new Torpedo(this, 0));
+    removals.reserve(TORPEDO_POOL);
+    expiredIds.reserve(TORPEDO_POOL);
+    vesselsById.resize(256);
+
+    // Serial stages run on this thread, parallel ones over vessel chunks.
+    // The sub is integrated alongside the contact grid build.
+    contactsStage = tickGraph.addStage("tick.contacts", &contactsJob);
+    subStage = tickGraph.addStage("tick.sub", &subJob);
+    integrateStage = tickGraph.addStage("tick.integrate", &integrateJob, TICK_GRAIN);
+    collisionStage = tickGraph.addStage("tick.collisions", &collisionJob, TICK_GRAIN);
+    hitStage = tickGraph.addStage("tick.hits", &hitJob);
+    aiStage = tickGraph.addStage("tick.ai", &shipAi, TICK_GRAIN / 2);
+    retireStage = tickGraph.addStage("tick.retire", &retireJob);
+    tickGraph.addDependency(integrateStage, contactsStage);
+    tickGraph.addDependency(collisionStage, integrateStage);
+    tickGraph.addDependency(hitStage, collisionStage);
+    tickGraph.addDependency(aiStage, hitStage);
+    tickGraph.addDependency(retireStage, aiStage);
+    tickGraph.setCount(contactsStage, 1);
+    tickGraph.setCount(subStage, 1);
+    tickGraph.setCount(hitStage, 1);
+    tickGraph.setCount(retireStage, 1);
     connect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
     timer.setSingleShot(false);
     timer.setInterval(50);
-    connect(this, SIGNAL(tickTime(double,int)), &sub, SLOT(tickTime(double,int)));
-    connect(&sub, SIGNAL(vesselUpdated(Vessel*)), this, SIGNAL(vesselUpdated(Vessel*)));
+}
+
+Simulation::~Simulation() {
+    foreach(Vessel *v, otherVessels) {
+        if(!isBlockAllocated(v))
+            delete v;
+    }
+    foreach(Vessel *block, vesselBlocks)
+        delete[] block;
+    delete pool;
+}
+
+void Simulation::setThreadCount(int threads) {
+    delete pool;
+    pool = new WorkPool(threads);
+}
+
+bool Simulation::loadBathymetry(const QString &fileName) {
+    if(!bathymetry.open(fileName)) {
+        qWarning() << "Can't load bathymetry" << fileName << bathymetry.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Simulation::setScenarioFile(const QString &fileName) {
+    scenarioFile = fileName;
+}
+
+bool Simulation::loadScenario(const QString &fileName) {
+    QTime loadTime;
+    loadTime.start();
+    Scenario scenario;
+    if(!scenario.open(fileName)) {
+        qWarning() << "Can't load scenario" << fileName << scenario.errorString();
+        return false;
+    }
+    int count = scenario.count();
+    if(!count) return true;
+    Vessel *block = scenario.createVessels(lastVesselId + 1);
+    lastVesselId += count;
+    vesselBlocks.append(block);
+    vesselBlockSizes.append(count);
+    otherVessels.reserve(otherVessels.size() + count);
+    for(int i=0;i<count;i++)
+        addVessel(&block[i]);
+    shipAi.rebuild(otherVessels);
+    for(int i=0;i<count;i++)
+        emit vesselCreated(&block[i]);
+    qDebug() << "Loaded" << count << "vessels from" << fileName << "in" << loadTime.elapsed() << "ms";
+    return true;
+}
+
+void Simulation::setRecorder(SimulationRecorder *r) {
+    recorder = r;
+}
+
+void Simulation::setInputsEnabled(bool enabled) {
+    inputsEnabled = enabled;
+}
+
+void Simulation::setSnapshots(int count, int interval, int vesselCapacity) {
+    snapshots.allocate(count, vesselCapacity);
+    snapshotInterval = interval;
 }
 
 void Simulation::startSimulation() {
     timer.start();
     totalTime.start();
+    totalBase = 0;
     time.start();
-    Vessel *v = new Vessel(this, ++lastVesselId);
-    v->x = 500;
-    v->y = -1000;
-    v->heading = 90;
-    v->type = 1;
-    v->speed =10;
-    v->setHelm(1);
-    otherVessels.append(v);
-    connect(this, SIGNAL(tickTime(double,int)), v, SLOT(tickTime(double,int)));
-    connect(v, SIGNAL(vesselUpdated(Vessel*)), this, SIGNAL(vesselUpdated(Vessel*)));
-    connect(v, SIGNAL(destroyed()), this, SLOT(vesselDestroyed()));
-    emit vesselCreated(v);
-    v = new Vessel(this, ++lastVesselId);
-    v->x = 2000;
-    v->y = -200;
-    v->heading = 70;
-    v->type = 1;
-    v->speed =10;
-    otherVessels.append(v);
-    connect(this, SIGNAL(tickTime(double,int)), v, SLOT(tickTime(double,int)));
-    connect(v, SIGNAL(vesselUpdated(Vessel*)), this, SIGNAL(vesselUpdated(Vessel*)));
-    connect(v, SIGNAL(destroyed()), this, SLOT(vesselDestroyed()));
-    emit vesselCreated(v);
-    v = new Vessel(this, ++lastVesselId);
-    v->x = -500;
-    v->y = -2000;
-    v->heading = -45;
-    v->type = 1;
-    v->speed =10;
-    v->setHelm(1);
-    otherVessels.append(v);
-    connect(this, SIGNAL(tickTime(double,int)), v, SLOT(tickTime(double,int)));
-    connect(v, SIGNAL(vesselUpdated(Vessel*)), this, SIGNAL(vesselUpdated(Vessel*)));
-    connect(v, SIGNAL(destroyed()), this, SLOT(vesselDestroyed()));
-    emit vesselCreated(v);
-    v = new Vessel(this, ++lastVesselId);
-    v->x = 3000;
-    v->y = 2000;
-    v->heading = 70;
-    v->type = 1;
-    v->speed =5;
-    v->setHelm(-1);
-    otherVessels.append(v);
-    connect(this, SIGNAL(tickTime(double,int)), v, SLOT(tickTime(double,int)));
-    connect(v, SIGNAL(vesselUpdated(Vessel*)), this, SIGNAL(vesselUpdated(Vessel*)));
-    connect(v, SIGNAL(destroyed()), this, SLOT(vesselDestroyed()));
-    emit vesselCreated(v);
+    loadScenario(scenarioFile);
 }
 
 void Simulation::tick() {
-    double dt = time.elapsed() / 1000.0f;
+    PROFILE_SCOPE("sim.tick");
+    double dt = time.elapsed() / 1000.0;
     time.start();
     if(dt > 0.2) {
         qDebug() << "Skipping frame, dt: " << dt;
         dt = 0;
     }
-    emit tickTime(dt, totalTime.elapsed());
+    step(dt, totalBase + totalTime.elapsed());
 }
 
-Vessel *Simulation::getSub() {
-    return &sub;
+void Simulation::step(double dt, int total, bool notify) {
+    // Whole microseconds, as recordings store it, so that a replay
+    // integrates with the very same dt
+    dt = qRound64(dt * 1e6) / 1e6;
+    if(recorder)
+        recorder->beginTick(this, dt, total);
+    if(snapshotInterval) {
+        bool launching = false;
+        for(int i=0;i<pendingCommands.size();i++)
+            launching |= pendingCommands[i].type == SimulationCommand::FireTorpedo;
+        if(launching || ticks % snapshotInterval == 0)
+            snapshots.take(this);
+    }
+    for(int i=0;i<pendingCommands.size();i++) {
+        if(recorder)
+            recorder->recordCommand(pendingCommands[i]);
+        applyCommand(pendingCommands[i]);
+    }
+    pendingCommands.resize(0);
+
+    tickDt = dt;
+    tickTotal = total;
+    simTime += dt;
+    hitTargets.resize(otherVessels.size());
+    sectorMoved.resize(otherVessels.size());
+    tickGraph.setCount(integrateStage, otherVessels.size());
+    tickGraph.setCount(collisionStage, runningTorpedoes.isEmpty() ? 0 : otherVessels.size());
+    tickGraph.setCount(aiStage, shipAi.prepare(ticks, simTime, &vesselsById));
+    fineCount = 0;
+    coarseCount = 0;
+    skippedCount = 0;
+    tickGraph.run(pool);
+    lod.fineTicks += fineCount;
+    lod.coarseSteps += coarseCount;
+    lod.skippedTicks += skippedCount;
+
+    flushRemovals();
+    if(ticks % SENSOR_INTERVAL == 0) {
+        sensors.sweep(&sub, partition, simTime, ticks, sweep);
+        if(!sweep.isEmpty())
+            emit detections(sweep);
+    }
+    ticks++;
+    lastTotal = total;
+    if(recorder)
+        recorder->endTick(this);
+    if(notify) {
+        notifyViews();
+        emit tickTime(dt, total);
+    }
 }
 
-void Simulation::fireTorpedo(double direction) {
-    Torpedo *v = new Torpedo(this, ++lastVesselId);
-    v->x = sub.x;
-    v->y = sub.y;
-    v->heading = sub.heading;
-    v->speed = sub.speed + 10;
-    v->headingCommand = direction;
-    otherVessels.append(v);
-    connect(this, SIGNAL(tickTime(double,int)), v, SLOT(tickTime(double,int)));
-    connect(v, SIGNAL(vesselUpdated(Vessel*)), this, SIGNAL(vesselUpdated(Vessel*)));
-    connect(v, SIGNAL(destroyed()), this, SLOT(vesselDestroyed()));
-    emit vesselCreated(v);
+// Every seeker sees the contacts where they were at the start of the tick.
+// The sectors around the subs and the torpedoes are the ones ticking fully.
+void Simulation::buildContacts(int, int) {
+    partition.beginActivation();
+    partition.activateAround(sub.x, sub.y);
+    foreach(Vessel *s, playerSubs)
+        partition.activateAround(s->x, s->y);
+    foreach(Torpedo *t, runningTorpedoes)
+        partition.activateAround(t->x, t->y);
+    if(!runningTorpedoes.isEmpty())
+        contacts.build(otherVessels);
 }
 
-void Simulation::vesselDestroyed() {
-    Vessel *v = static_cast<Vessel*> (sender());
-    emit vesselDeleted(v);
-    otherVessels.removeAll(v);
+void Simulation::integrateSub(int, int) {
+    sub.tickTime(tickDt, tickTotal);
 }
 
-void Simulation::collisionBetween(Vessel *v, Vessel *v2) {
-    if(!v || !v2) return;
-    if(v->type==2 && v2->type==2) return;
-    Q_ASSERT(otherVessels.contains(v));
-    Q_ASSERT(otherVessels.contains(v2));
-    Vessel *torpedo, *target;
-    torpedo = 0;
-    target = 0;
-    if(v->type==2) {
-        torpedo = v;
-        target = v2;
-    }
-    if(v2->type==2) {
-        torpedo = v2;
-        target = v;
+// Subs, torpedoes and ships in active sectors tick every step. A ship
+// elsewhere lags behind until another tick of lag could take it more than
+// LOD_MAX_ERROR off, and is then advanced over the lag in one closed-form
+// step; the same happens when its sector becomes active. A ship is
+// preferably advanced on its AI turn, looking a whole AI round ahead, so it
+// gets to decide while it is current.
+void Simulation::integrateVessels(int begin, int end) {
+    int fine = 0, coarse = 0, skipped = 0;
+    for(int i=begin;i<end;i++) {
+        Vessel *v = otherVessels[i];
+        sectorMoved[i] = 0;
+        if(v->pendingRemoval) continue;
+        if(v->type != 1 || partition.isActive(v->sector)) {
+            if(v->lagTime > 0) {
+                v->advance(v->lagTime);
+                v->lagTime = 0;
+                coarse++;
+            }
+            v->tickTime(tickDt, tickTotal);
+            fine++;
+        } else {
+            double lag = v->lagTime + tickDt;
+            double ahead = ShipAi::decidesOn(v, ticks) ? SHIPAI_SLICES * tickDt : tickDt;
+            if(v->driftBound(lag + ahead) <= LOD_MAX_ERROR) {
+                v->lagTime = lag;
+                skipped++;
+                continue;
+            }
+            v->advance(lag);
+            v->lagTime = 0;
+            coarse++;
+        }
+        sectorMoved[i] = partition.hasMoved(v);
+    }
+    fineCount.fetchAndAddRelaxed(fine);
+    coarseCount.fetchAndAddRelaxed(coarse);
+    skippedCount.fetchAndAddRelaxed(skipped);
+}
+
+void Simulation::findHits(int begin, int end) {
+    for(int i=begin;i<end;i++) {
+        Vessel *v = otherVessels[i];
+        hitTargets[i] = 0;
+        if(v->type != 2 || v->pendingRemoval || static_cast<Torpedo*>(v)->runTime < TORPEDO_ARM_TIME)
+            continue;
+        hitTargets[i] = contacts.closest(v->x, v->y, TORPEDO_HIT_RADIUS, MAX_CONTACT_SPEED * tickDt);
     }
+}
+
+// In vessel order, so the outcome does not depend on which thread found what
+void Simulation::handleHits(int, int) {
+    for(int i=0;i<otherVessels.size();i++) {
+        Vessel *target = hitTargets[i];
+        if(!target || otherVessels[i]->pendingRemoval || target->pendingRemoval) continue;
+        torpedoHit(otherVessels[i], target);
+    }
+}
+
+void Simulation::retireVessels(int, int) {
+    bool seabed = bathymetry.isOpen();
+    if(seabed)
+        checkSeabed();
+    for(int i=0;i<otherVessels.size();i++) {
+        if(sectorMoved[i])
+            partition.update(otherVessels[i]);
+        // Only sinking ships go; player subs dive as deep as they like
+        if(!seabed && otherVessels[i]->type == 1 && otherVessels[i]->depth > SINK_DEPTH)
+            markForRemoval(otherVessels[i]);
+    }
+    expiredIds.resize(0);
+    expiryWheel.advance(simTime, expiredIds);
+    for(int i=0;i<expiredIds.size();i++) {
+        Vessel *v = findVessel(expiredIds[i]);
+        // Torpedoes that hit something are gone already
+        if(!v || v->type != 2) continue;
+        Torpedo *t = static_cast<Torpedo*>(v);
+        // Run time decides, the wheel only narrows down the candidates
+        if(t->runTime >= TORPEDO_RUN_TIME)
+            markForRemoval(t);
+        else
+            scheduleExpiry(t);
+    }
+}
+
+// Ships stop where the water is shallower than their draught, and a
+// sinking ship is removed when it reaches the bottom (or SINK_DEPTH, in deep
+// water). Torpedoes blow up on the bottom or the shore. Subs run aground
+// like ships, rest on the bottom rather than go through it, and are lost
+// when they dive past their crush depth: the simulation's own sub sinks to
+// the bottom taking no more orders, a player's sub is removed. The seabed under every vessel is
+// looked up in one batch; ships lagging in far sectors use the position
+// they lag at.
+void Simulation::checkSeabed() {
+    seabedVessels.resize(0);
+    seabedVessels.append(&sub);
+    seabedVessels += otherVessels;
+    bathymetry.depthsAt(seabedVessels, seabedDepths);
+    for(int i=0;i<seabedVessels.size();i++) {
+        Vessel *v = seabedVessels[i];
+        if(v->pendingRemoval) continue;
+        float bottom = seabedDepths[i];
+        if(v->type == 1) {
+            if(v->verticalVelocity > 0) {
+                if(v->depth + SHIP_DRAUGHT >= bottom || v->depth > SINK_DEPTH)
+                    markForRemoval(v);
+            } else if(bottom < SHIP_DRAUGHT) {
+                v->speed = v->speedCommand = 0;
+            }
+        } else if(v->type == 2) {
+            if(v->depth >= bottom) {
+                emit explosion(v->x, v->y, 0.5);
+                markForRemoval(v);
+            }
+        } else if(v->type == 0) {
+            if(bottom < SUB_DRAUGHT)
+                v->speed = v->speedCommand = 0;
+            if(v->depth > SUB_CRUSH_DEPTH && v->depth - v->verticalVelocity * tickDt <= SUB_CRUSH_DEPTH
+                    && bottom > SUB_CRUSH_DEPTH) {
+                qDebug() << "Sub" << v->id << "crushed at" << v->depth << "m";
+                emit explosion(v->x, v->y, 0.5);
+                if(v != &sub) {
+                    markForRemoval(v);
+                    continue;
+                }
+                v->wasHitByTorpedo();
+            }
+            if(v->depth > bottom) {
+                v->depth = qMax(bottom, 0.f);
+                v->verticalVelocity = qMin(v->verticalVelocity, 0.0);
+            }
+        }
+    }
+}
+
+void Simulation::torpedoHit(Vessel *torpedo, Vessel *target) {
     qDebug() << "Torpedo " << torpedo << "hit ship " << target;
     emit explosion(torpedo->x, torpedo->y, 1);
-    delete torpedo;
+    shipAi.alert(otherVessels, torpedo->x, torpedo->y, simTime);
+    markForRemoval(torpedo);
     target->wasHitByTorpedo();
 }
+
+void Simulation::notifyViews() {
+    emit vesselUpdated(&sub);
+    foreach(Vessel *v, otherVessels)
+        emit vesselUpdated(v);
+}
+
+Vessel *Simulation::getSub() {
+    return &sub;
+}
+
+void Simulation::queueCommand(int type, int value, int value2, double direction) {
+    SimulationCommand command;
+    command.type = type;
+    command.value = value;
+    command.value2 = value2;
+    command.direction = direction;
+    pendingCommands.append(command);
+}
+
+void Simulation::fireTorpedo(double direction, int mode) {
+    if(inputsEnabled)
+        queueCommand(SimulationCommand::FireTorpedo, mode, 0, direction);
+}
+
+void Simulation::setHelm(int h) {
+    if(inputsEnabled)
+        queueCommand(SimulationCommand::Helm, h);
+}
+
+void Simulation::setSpeed(int s) {
+    if(inputsEnabled)
+        queueCommand(SimulationCommand::Speed, s);
+}
+
+void Simulation::setDepthChange(int s) {
+    if(inputsEnabled)
+        queueCommand(SimulationCommand::DepthChange, s);
+}
+
+void Simulation::submitCommand(const SimulationCommand &command) {
+    if(inputsEnabled)
+        queueCommand(command.type, command.value, command.value2, command.direction);
+}
+
+void Simulation::addPlayer(double x, double y) {
+    if(inputsEnabled)
+        queueCommand(SimulationCommand::AddPlayer, qRound(x), qRound(y));
+}
+
+void Simulation::removePlayer(int id) {
+    if(inputsEnabled)
+        queueCommand(SimulationCommand::RemovePlayer, id);
+}
+
+void Simulation::collisionBetween(Vessel *v, Vessel *v2) {
+    if(!v || !v2 || !inputsEnabled) return;
+    queueCommand(SimulationCommand::Collision, v->id, v2->id);
+}
+
+void Simulation::applyCommand(const SimulationCommand &command) {
+    switch(command.type) {
+    case SimulationCommand::Helm:
+        if(Vessel *s = commandedSub(command.value2))
+            s->setHelm(command.value);
+        break;
+    case SimulationCommand::Speed:
+        if(Vessel *s = commandedSub(command.value2))
+            s->setSpeed(command.value);
+        break;
+    case SimulationCommand::DepthChange:
+        if(Vessel *s = commandedSub(command.value2))
+            s->setDepthChange(command.value);
+        break;
+    case SimulationCommand::FireTorpedo: {
+        Vessel *s = commandedSub(command.value2);
+        if(!s) return;
+        Torpedo *v = takeTorpedo(++lastVesselId);
+        v->x = s->x;
+        v->y = s->y;
+        v->heading = s->heading;
+        v->speed = s->speed + TORPEDO_LAUNCH_SPEED;
+        v->headingCommand = command.direction;
+        v->mode = command.value;
+        addVessel(v);
+        scheduleExpiry(v);
+        emit vesselCreated(v);
+        break;
+    }
+    case SimulationCommand::Collision: {
+        // Either vessel may already be gone if it collided twice in a frame
+        Vessel *v = findVessel(command.value);
+        Vessel *v2 = findVessel(command.value2);
+        if(!v || !v2 || v->pendingRemoval || v2->pendingRemoval) return;
+        if(v->type==2 && v2->type==2) return;
+        Vessel *torpedo, *target;
+        torpedo = 0;
+        target = 0;
+        if(v->type==2) {
+            torpedo = v;
+            target = v2;
+        }
+        if(v2->type==2) {
+            torpedo = v2;
+            target = v;
+        }
+        if(!torpedo) return;
+        torpedoHit(torpedo, target);
+        break;
+    }
+    case SimulationCommand::AddPlayer: {
+        Vessel *v = new Vessel(this, ++lastVesselId);
+        v->x = command.value;
+        v->y = command.value2;
+        addVessel(v);
+        emit vesselCreated(v);
+        emit playerAdded(v);
+        break;
+    }
+    case SimulationCommand::RemovePlayer: {
+        Vessel *v = findVessel(command.value);
+        if(v && v->type == 0)
+            markForRemoval(v);
+        break;
+    }
+    }
+}
+
+// A player's sub, or the simulation's own for id 0
+Vessel *Simulation::commandedSub(int id) {
+    Vessel *v = id == 0 ? &sub : findVessel(id);
+    return v && v->type == 0 && !v->pendingRemoval && !isLost(v) ? v : 0;
+}
+
+bool Simulation::isLost(const Vessel *v) const {
+    return bathymetry.isOpen() && v->depth > SUB_CRUSH_DEPTH;
+}
+
+Vessel *Simulation::findVessel(int id) {
+    if(id <= 0 || id >= vesselsById.size())
+        return 0;
+    return vesselsById[id];
+}
+
+void Simulation::indexVessel(Vessel *v) {
+    if(v->id >= vesselsById.size())
+        vesselsById.resize(qMax(v->id + 1, vesselsById.size() * 2));
+    vesselsById[v->id] = v;
+}
+
+void Simulation::addVessel(Vessel *v) {
+    v->slot = otherVessels.size();
+    otherVessels.append(v);
+    indexVessel(v);
+    partition.insert(v);
+    if(v->type == 2)
+        runningTorpedoes.append(static_cast<Torpedo*>(v));
+    else if(v->type == 0)
+        playerSubs.append(v);
+}
+
+void Simulation::markForRemoval(Vessel *v) {
+    if(v->pendingRemoval) return;
+    v->pendingRemoval = true;
+    removals.append(v);
+}
+
+// Swap-and-pop keeps removal O(1) per vessel; the update order changes, but
+// it does so the same way on every run
+void Simulation::flushRemovals() {
+    if(removals.isEmpty()) return;
+    for(int i=0;i<removals.size();i++) {
+        Vessel *v = removals[i];
+        Vessel *last = otherVessels.last();
+        otherVessels[v->slot] = last;
+        last->slot = v->slot;
+        otherVessels.resize(otherVessels.size() - 1);
+        vesselsById[v->id] = 0;
+        v->slot = -1;
+        partition.remove(v);
+        if(v->type == 2)
+            runningTorpedoes.remove(runningTorpedoes.indexOf(static_cast<Torpedo*>(v)));
+        else if(v->type == 0)
+            playerSubs.remove(playerSubs.indexOf(v));
+    }
+    emit vesselsDeleted(removals);
+    for(int i=0;i<removals.size();i++)
+        releaseVessel(removals[i]);
+    removals.resize(0);
+}
+
+void Simulation::releaseVessel(Vessel *v) {
+    v->pendingRemoval = false;
+    if(v->type == 2)
+        freeTorpedoes.append(static_cast<Torpedo*>(v));
+    else if(!isBlockAllocated(v))
+        delete v;
+}
+
+Torpedo *Simulation::takeTorpedo(int id) {
+    if(freeTorpedoes.isEmpty()) {
+        Torpedo *t = new Torpedo(this, id);
+        t->setContacts(&contacts);
+        return t;
+    }
+    Torpedo *t = freeTorpedoes.last();
+    freeTorpedoes.resize(freeTorpedoes.size() - 1);
+    t->reset(id);
+    t->setContacts(&contacts);
+    return t;
+}
+
+void Simulation::scheduleExpiry(Torpedo *t) {
+    expiryWheel.schedule(t->id, simTime + TORPEDO_RUN_TIME - t->runTime);
+}
+
+bool Simulation::isBlockAllocated(Vessel *v) const {
+    std::less<Vessel*> before;
+    for(int i=0;i<vesselBlocks.size();i++) {
+        Vessel *block = vesselBlocks[i];
+        if(!before(v, block) && before(v, block + vesselBlockSizes[i]))
+            return true;
+    }
+    return false;
+}
+
+void Simulation::saveState(SimulationState &state) const {
+    state.tick = ticks;
+    state.total = lastTotal;
+    state.lastVesselId = lastVesselId;
+    state.time = simTime;
+    sub.saveState(state.sub);
+    state.vessels.resize(otherVessels.size());
+    for(int i=0;i<otherVessels.size();i++)
+        otherVessels[i]->saveState(state.vessels[i]);
+}
+
+namespace {
+// Orders indices into a state's vessels by vessel id
+struct StateIdLess
+{
+    StateIdLess(const QVector<VesselState> &v) : vessels(v) {}
+    bool operator()(int a, int b) const { return vessels[a].id < vessels[b].id; }
+    const QVector<VesselState> &vessels;
+};
+}
+
+// Scenario blocks are filled in id order and keep removed vessels until the
+// simulation is cleared, so a sunk ship can be brought back without
+// allocating
+Vessel *Simulation::findBlockVessel(int id) const {
+    for(int i=0;i<vesselBlocks.size();i++) {
+        Vessel *begin = vesselBlocks[i];
+        Vessel *end = begin + vesselBlockSizes[i];
+        while(begin < end) {
+            Vessel *middle = begin + (end - begin) / 2;
+            if(middle->id < id)
+                begin = middle + 1;
+            else
+                end = middle;
+        }
+        if(begin < vesselBlocks[i] + vesselBlockSizes[i] && begin->id == id)
+            return begin;
+    }
+    return 0;
+}
+
+void Simulation::restoreState(const SimulationState &state) {
+    pendingCommands.resize(0);
+    ticks = state.tick;
+    lastTotal = state.total;
+    totalBase = state.total;
+    totalTime.start();
+    lastVesselId = state.lastVesselId;
+    simTime = state.time;
+    sub.restoreState(state.sub);
+    if(recorder)
+        recorder->markRewind();
+
+    // Vessels that still exist are restored in place, the rest are
+    // deleted or brought back
+    restoredVessels.resize(0);
+    createdVessels.resize(0);
+    deletedVessels.resize(0);
+    restoredVessels.reserve(state.vessels.size());
+    keptSlots.fill(0, otherVessels.size());
+    QVector<int> missingShips;
+    for(int i=0;i<state.vessels.size();i++) {
+        const VesselState &vs = state.vessels[i];
+        Vessel *v = findVessel(vs.id);
+        if(v && v->type == vs.type) {
+            keptSlots[v->slot] = 1;
+        } else {
+            if(vs.type == 2)
+                v = takeTorpedo(vs.id);
+            else
+                v = findBlockVessel(vs.id);
+            if(v)
+                createdVessels.append(v);
+            else
+                missingShips.append(i);
+        }
+        if(v)
+            v->restoreState(vs);
+        restoredVessels.append(v);
+    }
+    for(int i=0;i<otherVessels.size();i++) {
+        if(!keptSlots[i])
+            deletedVessels.append(otherVessels[i]);
+    }
+
+    // Ships never seen by this simulation, e.g. when replaying from a
+    // keyframe, get a block of their own, filled in id order
+    if(!missingShips.isEmpty()) {
+        std::sort(missingShips.begin(), missingShips.end(), StateIdLess(state.vessels));
+        Vessel *block = new Vessel[missingShips.size()];
+        vesselBlocks.append(block);
+        vesselBlockSizes.append(missingShips.size());
+        for(int i=0;i<missingShips.size();i++) {
+            block[i].restoreState(state.vessels[missingShips[i]]);
+            restoredVessels[missingShips[i]] = &block[i];
+            createdVessels.append(&block[i]);
+        }
+    }
+
+    foreach(Vessel *v, deletedVessels) {
+        if(vesselsById[v->id] == v)
+            vesselsById[v->id] = 0;
+        v->slot = -1;
+    }
+    qSwap(otherVessels, restoredVessels);
+    for(int i=0;i<otherVessels.size();i++) {
+        Vessel *v = otherVessels[i];
+        v->slot = i;
+        v->pendingRemoval = false;
+        indexVessel(v);
+    }
+    shipAi.rebuild(otherVessels);
+    partition.rebuild(otherVessels);
+    expiryWheel.reset(simTime);
+    runningTorpedoes.resize(0);
+    playerSubs.resize(0);
+    foreach(Vessel *v, otherVessels) {
+        if(v->type == 2) {
+            runningTorpedoes.append(static_cast<Torpedo*>(v));
+            scheduleExpiry(static_cast<Torpedo*>(v));
+        } else if(v->type == 0) {
+            playerSubs.append(v);
+        }
+    }
+
+    if(!deletedVessels.isEmpty())
+        emit vesselsDeleted(deletedVessels);
+    foreach(Vessel *v, deletedVessels)
+        releaseVessel(v);
+    if(!createdVessels.isEmpty())
+        emit vesselsCreated(createdVessels);
+    notifyViews();
+}
+
+bool Simulation::rewind() {
+    if(!inputsEnabled) return false;
+    const SimulationState *state = snapshots.findBefore(ticks);
+    if(!state) return false;
+    qDebug() << "Rewinding from tick" << ticks << "to" << state->tick;
+    restoreState(*state);
+    snapshots.discardAfter(ticks);
+    return true;
+}
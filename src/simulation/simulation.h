@@ -6,34 +6,184 @@
 #include <QTime>
 #include <QList>
 #include "vessel.h"
+#include "simulationstate.h"
+#include "snapshotring.h"
+#include "timingwheel.h"
+#include "contactgrid.h"
+#include "shipai.h"
+#include "workpool.h"
+#include "taskgraph.h"
+#include "worldpartition.h"
+#include "sensors.h"
+#include "bathymetry.h"
+
+class SimulationRecorder;
+class Torpedo;
 
 class Simulation : public QObject
 {
     Q_OBJECT
 public:
     explicit Simulation(QObject *parent = 0);
+    ~Simulation();
     Vessel *getSub();
+    // Everything but the sub, in update order
+    const QVector<Vessel*> &vessels() const { return otherVessels; }
+    // Simulated seconds
+    double simulatedTime() const { return simTime; }
+    // Scenario loaded by startSimulation(), text or binary (see scenario.h)
+    void setScenarioFile(const QString &fileName);
+    bool loadScenario(const QString &fileName);
+    // Optional seabed, see bathymetry.h. Without one the sea is deep
+    // everywhere and sinking vessels are removed at SINK_DEPTH.
+    bool loadBathymetry(const QString &fileName);
+
+    // Recording is optional, the recorder is not owned
+    void setRecorder(SimulationRecorder *r);
+    // Advances the world by one tick. Called by the timer, or by a player
+    // when replaying a recording. dt is rounded to whole microseconds.
+    // With notifyViews false no vesselUpdated/tickTime are emitted, for
+    // fast-forwarding; notifyViews() then brings the views up to date.
+    void step(double dt, int total, bool notifyViews = true);
+    void notifyViews();
+    void applyCommand(const SimulationCommand &command);
+    // Queues an input from elsewhere, e.g. a view in another process
+    void submitCommand(const SimulationCommand &command);
+    // Subs controlled by session players, besides the simulation's own.
+    // Joining takes effect on the next tick, see playerAdded().
+    void addPlayer(double x, double y);
+    void removePlayer(int id);
+    const QVector<Vessel*> &players() const { return playerSubs; }
+    void saveState(SimulationState &state) const;
+    // Reuses the vessels that still exist; views are resynchronized with
+    // vesselsDeleted/vesselsCreated and vesselUpdated
+    void restoreState(const SimulationState &state);
+    // Keeps count snapshots, one every interval ticks and one before each
+    // torpedo launch
+    void setSnapshots(int count, int interval, int vesselCapacity = 256);
+    int tickCount() const { return ticks; }
+    // When disabled the input slots are ignored (used during replay)
+    void setInputsEnabled(bool enabled);
+    // Threads the tick runs on, counting the calling one. 0 is one per core.
+    // Results do not depend on it.
+    void setThreadCount(int threads);
+    // Vessels ticked in full, advanced in one coarse step, and left lagging,
+    // summed over the ticks so far
+    struct LodStats
+    {
+        qint64 fineTicks, coarseSteps, skippedTicks;
+    };
+    LodStats lodStats() const { return lod; }
 public slots:
     void collisionBetween(Vessel *v, Vessel *v2);
     void startSimulation();
+    // mode is a Torpedo::Mode
+    void fireTorpedo(double direction, int mode = 0);
+    void setHelm(int h);
+    void setSpeed(int s);
+    void setDepthChange(int s);
+    // Goes back to the newest snapshot older than the current tick, so
+    // repeated rewinds step further into the past
+    bool rewind();
 signals:
     void vesselUpdated(Vessel *v);
     void vesselCreated(Vessel *v);
-    void vesselDeleted(Vessel *v);
+    // Vessels removed at the end of a tick or by restoring a state, and
+    // vessels brought back by a restore
+    void vesselsCreated(const QVector<Vessel*> &vessels);
+    void vesselsDeleted(const QVector<Vessel*> &vessels);
     void tickTime(double dt, int total);
     void explosion(double x, double y, double intensity);
+    // In the order addPlayer() was called
+    void playerAdded(Vessel *v);
+    // What the sub's sensors picked up, every SENSOR_INTERVAL ticks
+    void detections(const QVector<SensorDetection> &detections);
 private slots:
     void tick();
-    void vesselDestroyed();
-public slots:
-    void fireTorpedo(double direction);
 
 private:
+    void queueCommand(int type, int value, int value2 = 0, double direction = 0);
+    void addVessel(Vessel *v);
+    void indexVessel(Vessel *v);
+    void markForRemoval(Vessel *v);
+    void flushRemovals();
+    void releaseVessel(Vessel *v);
+    Torpedo *takeTorpedo(int id);
+    void scheduleExpiry(Torpedo *t);
+    Vessel *findVessel(int id);
+    // The sub, unless it is gone or lost
+    Vessel *commandedSub(int id);
+    // A sub past its crush depth is lost. It only sinks from there, so its
+    // depth says so also after a rewind or in a replay.
+    bool isLost(const Vessel *v) const;
+    Vessel *findBlockVessel(int id) const;
+    bool isBlockAllocated(Vessel *v) const;
+
     QTimer timer;
     QTime time, totalTime;
     Vessel sub;
-    QList<Vessel*> otherVessels;
+    QVector<Vessel*> otherVessels;
+    // Live vessels by id, 0 for ids that are gone
+    QVector<Vessel*> vesselsById;
+    // Scenario vessels are allocated as arrays and freed as a whole
+    QList<Vessel*> vesselBlocks;
+    QList<int> vesselBlockSizes;
     int lastVesselId;
+    int ticks, lastTotal, totalBase;
+    QString scenarioFile;
+    QVector<SimulationCommand> pendingCommands;
+    SimulationRecorder *recorder;
+    bool inputsEnabled;
+    SnapshotRing snapshots;
+    int snapshotInterval;
+    // Reused by restoreState
+    QVector<Vessel*> restoredVessels, createdVessels, deletedVessels;
+    QVector<char> keptSlots;
+
+    // Vessels leave in one batch at the end of a tick; torpedoes go back to
+    // a pool and expire through a timing wheel over simulated time
+    QVector<Vessel*> removals;
+    QVector<Torpedo*> freeTorpedoes;
+    TimingWheel expiryWheel;
+    QVector<int> expiredIds;
+    double simTime;
+    // Seeker contacts, built in ticks with homing torpedoes running
+    ContactGrid contacts;
+    ShipAi shipAi;
+
+    // The tick's per-vessel work, see step()
+    void buildContacts(int begin, int end);
+    void integrateSub(int begin, int end);
+    void integrateVessels(int begin, int end);
+    void findHits(int begin, int end);
+    void handleHits(int begin, int end);
+    void retireVessels(int begin, int end);
+    void checkSeabed();
+    void torpedoHit(Vessel *torpedo, Vessel *target);
+    WorkPool *pool;
+    TaskGraph tickGraph;
+    MemberJob<Simulation> contactsJob, subJob, integrateJob, collisionJob, hitJob, retireJob;
+    int contactsStage, subStage, integrateStage, collisionStage, hitStage, aiStage, retireStage;
+    double tickDt;
+    int tickTotal;
+    // Per vessel slot, what a torpedo ran into this tick
+    QVector<Vessel*> hitTargets;
+    // Far sectors tick at a reduced rate; vessels that changed sector in
+    // the integrate stage are refiled in the retire stage
+    WorldPartition partition;
+    QVector<char> sectorMoved;
+    QVector<Torpedo*> runningTorpedoes;
+    QVector<Vessel*> playerSubs;
+    SensorModel sensors;
+    Bathymetry bathymetry;
+    // checkSeabed() scratch: the sub and the other vessels, and the seabed
+    // under each
+    QVector<Vessel*> seabedVessels;
+    QVector<float> seabedDepths;
+    QVector<SensorDetection> sweep;
+    // Per tick counts from the parallel integrate stage
+    QAtomicInt fineCount, coarseCount, skippedCount;
+    LodStats lod;
 };
 
 #endif // SIMULATION_H
@@ -1,6 +1,6 @@
 TARGET=vesikko
 
-QT += declarative gui
+QT += declarative gui network
 
 LIBS += -L../mapview -lmapview
 CONFIG += link_prl
@@ -16,16 +16,62 @@ LIBS +=  ../mapview/libmapview.a
 LIBS +=  ../weaponsview/libweaponsview.a
 LIBS +=  ../hydrophoneview/libhydrophoneview.a
 LIBS +=  ../servogauges/libservogauges.a
+LIBS +=  ../profiling/libprofiling.a
+# shm_open
+LIBS += -lrt
 
 # The .cpp file which was generated for your project. Feel free to hack it.
 SOURCES += main.cpp \
     simulation.cpp \
     vessel.cpp \
-    torpedo.cpp
+    torpedo.cpp \
+    contactgrid.cpp \
+    shipai.cpp \
+    workpool.cpp \
+    taskgraph.cpp \
+    worldpartition.cpp \
+    sensors.cpp \
+    sharedworld.cpp \
+    worldpublisher.cpp \
+    commandserver.cpp \
+    replication.cpp \
+    sessionserver.cpp \
+    tmasolver.cpp \
+    contacttracker.cpp \
+    firecontrol.cpp \
+    scenario.cpp \
+    simulationrecorder.cpp \
+    simulationplayer.cpp \
+    snapshotring.cpp \
+    timingwheel.cpp \
+    bathymetry.cpp
 
 HEADERS += \
     simulation.h \
     vessel.h \
-    torpedo.h
+    torpedo.h \
+    contactgrid.h \
+    shipai.h \
+    workpool.h \
+    taskgraph.h \
+    worldpartition.h \
+    sensors.h \
+    sharedworld.h \
+    worldpublisher.h \
+    commandlink.h \
+    commandserver.h \
+    replication.h \
+    sessionserver.h \
+    tmasolver.h \
+    contacttracker.h \
+    firecontrol.h \
+    scenario.h \
+    recordingformat.h \
+    simulationrecorder.h \
+    simulationplayer.h \
+    simulationstate.h \
+    snapshotring.h \
+    timingwheel.h \
+    bathymetry.h
 
 
@@ -0,0 +1,228 @@
+#include "simulationplayer.h"
+#include "simulationrecorder.h"
+#include "recordingformat.h"
+#include <QDebug>
+#include <string.h>
+
+// Most ticks simulated per timer event, keeps the GUI responsive at high speeds
+#define PLAYER_MAX_STEPS 2000
+
+RecordingReader::RecordingReader() : data(0), end(0), pos(0), ticks(0), lastDtUs(0), lastTotal(0)
+{
+}
+
+bool RecordingReader::open(const QString &fileName) {
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    data = file.map(0, file.size());
+    if(!data || file.size() < 8 || memcmp(data, RECORDING_MAGIC, 4) != 0) {
+        error = "not a recording";
+        return false;
+    }
+    quint32 version;
+    memcpy(&version, data + 4, sizeof(version));
+    if(version != RECORDING_VERSION) {
+        error = "unsupported recording version";
+        return false;
+    }
+    end = data + file.size();
+
+    // Index keyframes and count ticks. A recording cut short by a crash ends
+    // at the last complete chunk.
+    keyframes.clear();
+    ticks = 0;
+    pos = data + 8;
+    while(pos < end) {
+        const uchar *chunk = pos;
+        uchar tag = *pos++;
+        quint64 tick;
+        if(!skipChunk(tag, &tick, 0)) {
+            end = chunk;
+            break;
+        }
+        if(tag == RecordingKeyframe || tag == RecordingRewind) {
+            Keyframe k;
+            k.tick = tick;
+            k.offset = chunk - data;
+            keyframes.append(k);
+        } else if(tag == RecordingTick) {
+            ticks++;
+        }
+    }
+    if(keyframes.isEmpty()) {
+        error = "recording has no keyframes";
+        return false;
+    }
+    return true;
+}
+
+// Moves pos past the chunk whose tag was just read
+bool RecordingReader::skipChunk(uchar tag, quint64 *keyframeTick, quint64 *keyframeTotal) {
+    quint64 v, size;
+    switch(tag) {
+    case RecordingKeyframe:
+    case RecordingRewind:
+        if(!readVarint(pos, end, v)) return false;
+        if(keyframeTick) *keyframeTick = v;
+        if(!readVarint(pos, end, v)) return false;
+        if(keyframeTotal) *keyframeTotal = v;
+        if(!readVarint(pos, end, size) || size > (quint64)(end - pos)) return false;
+        pos += size;
+        return true;
+    case RecordingCommand:
+        for(int i=0;i<4;i++)
+            if(!readVarint(pos, end, v)) return false;
+        return true;
+    case RecordingTick:
+        return readVarint(pos, end, v) && readVarint(pos, end, v);
+    case RecordingStates:
+        if(!readVarint(pos, end, size) || size > (quint64)(end - pos)) return false;
+        pos += size;
+        return true;
+    }
+    return false;
+}
+
+bool RecordingReader::seek(int tick, SimulationState &state) {
+    int k = keyframes.size() - 1;
+    while(k > 0 && keyframes[k].tick > tick)
+        k--;
+    pos = data + keyframes[k].offset + 1;
+    quint64 kTick, kTotal, size;
+    if(!readVarint(pos, end, kTick) || !readVarint(pos, end, kTotal) || !readVarint(pos, end, size))
+        return false;
+    QByteArray raw = qUncompress(pos, size);
+    pos += size;
+    lastDtUs = 0;
+    lastTotal = kTotal;
+    return SimulationRecorder::decodeState((const uchar*) raw.constData(), raw.size(), state);
+}
+
+bool RecordingReader::next(RecordedTick &tick) {
+    tick.commands.resize(0);
+    tick.rewind = false;
+    while(pos < end) {
+        uchar tag = *pos++;
+        quint64 a, b, c, d;
+        switch(tag) {
+        case RecordingKeyframe:
+            // Already applied state, only the delta context restarts
+            if(!skipChunk(tag, 0, &a)) return false;
+            lastDtUs = 0;
+            lastTotal = a;
+            break;
+        case RecordingRewind: {
+            quint64 size;
+            if(!readVarint(pos, end, a) || !readVarint(pos, end, b) || !readVarint(pos, end, size)
+                    || size > (quint64)(end - pos))
+                return false;
+            QByteArray raw = qUncompress(pos, size);
+            pos += size;
+            if(!SimulationRecorder::decodeState((const uchar*) raw.constData(), raw.size(), tick.rewindState))
+                return false;
+            tick.rewind = true;
+            lastDtUs = 0;
+            lastTotal = b;
+            break;
+        }
+        case RecordingCommand: {
+            if(!readVarint(pos, end, a) || !readVarint(pos, end, b)
+                    || !readVarint(pos, end, c) || !readVarint(pos, end, d))
+                return false;
+            SimulationCommand command;
+            command.type = a;
+            command.value = unzigzag(b);
+            command.value2 = unzigzag(c);
+            command.direction = unzigzag(d) / 1000.0;
+            tick.commands.append(command);
+            break;
+        }
+        case RecordingTick:
+            if(!readVarint(pos, end, a) || !readVarint(pos, end, b))
+                return false;
+            lastDtUs += unzigzag(a);
+            lastTotal += b;
+            tick.dt = lastDtUs / 1e6;
+            tick.total = lastTotal;
+            return true;
+        default:
+            if(!skipChunk(tag, 0, 0)) return false;
+        }
+    }
+    return false;
+}
+
+SimulationPlayer::SimulationPlayer(Simulation *s, QObject *parent) : QObject(parent),
+    simulation(s), startTick(0), speed(1), budget(0), havePending(false)
+{
+    connect(&timer, SIGNAL(timeout()), this, SLOT(advance()));
+    timer.setInterval(50);
+    simulation->setInputsEnabled(false);
+}
+
+bool SimulationPlayer::open(const QString &fileName) {
+    if(!reader.open(fileName)) {
+        qWarning() << "Can't replay" << fileName << reader.errorString();
+        return false;
+    }
+    qDebug() << "Replaying" << reader.tickCount() << "ticks from" << fileName;
+    return true;
+}
+
+void SimulationPlayer::start() {
+    seek(startTick);
+    realTime.start();
+    timer.start();
+}
+
+void SimulationPlayer::setSpeed(double s) {
+    speed = qMax(0.0, s);
+}
+
+bool SimulationPlayer::readNext() {
+    havePending = reader.next(pending);
+    return havePending;
+}
+
+void SimulationPlayer::playPending(bool notifyViews) {
+    if(pending.rewind)
+        simulation->restoreState(pending.rewindState);
+    for(int i=0;i<pending.commands.size();i++)
+        simulation->applyCommand(pending.commands[i]);
+    simulation->step(pending.dt, pending.total, notifyViews);
+}
+
+void SimulationPlayer::seek(int tick) {
+    SimulationState state;
+    if(!reader.seek(tick, state)) {
+        qWarning() << Q_FUNC_INFO << "broken keyframe";
+        return;
+    }
+    simulation->restoreState(state);
+    while(simulation->tickCount() < tick && readNext())
+        playPending(false);
+    simulation->notifyViews();
+    readNext();
+    budget = 0;
+}
+
+void SimulationPlayer::advance() {
+    budget += realTime.restart() / 1000.0 * speed;
+    int steps = 0;
+    while(havePending && budget >= pending.dt && steps < PLAYER_MAX_STEPS) {
+        budget -= pending.dt;
+        playPending(true);
+        readNext();
+        steps++;
+    }
+    if(steps == PLAYER_MAX_STEPS)
+        budget = 0;
+    if(!havePending) {
+        timer.stop();
+        qDebug() << "Replay finished at tick" << simulation->tickCount();
+        emit finished();
+    }
+}
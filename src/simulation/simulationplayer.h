@@ -0,0 +1,82 @@
+#ifndef SIMULATIONPLAYER_H
+#define SIMULATIONPLAYER_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QTime>
+#include <QVector>
+#include "simulation.h"
+
+struct RecordedTick
+{
+    double dt;
+    int total;
+    QVector<SimulationCommand> commands;
+    // The recorded simulation was rewound to rewindState before this tick
+    bool rewind;
+    SimulationState rewindState;
+};
+
+// Reads a recording (see recordingformat.h) from a memory-mapped file
+class RecordingReader
+{
+public:
+    RecordingReader();
+    bool open(const QString &fileName);
+    QString errorString() const { return error; }
+    int tickCount() const { return ticks; }
+
+    // Restores the last keyframe at or before tick into state and continues
+    // reading from there
+    bool seek(int tick, SimulationState &state);
+    // Reads the next tick's inputs, false at the end of the recording
+    bool next(RecordedTick &tick);
+
+private:
+    bool skipChunk(uchar tag, quint64 *keyframeTick, quint64 *keyframeTotal);
+
+    struct Keyframe { int tick; qint64 offset; };
+    QFile file;
+    const uchar *data, *end, *pos;
+    QVector<Keyframe> keyframes;
+    int ticks;
+    qint64 lastDtUs, lastTotal;
+    QString error;
+};
+
+/*
+ * Drives a Simulation from a recording instead of its timer. Speed is a
+ * multiple of recorded time; seeking restores the nearest keyframe and
+ * fast-forwards from there.
+ */
+class SimulationPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SimulationPlayer(Simulation *simulation, QObject *parent = 0);
+    bool open(const QString &fileName);
+    void setStartTick(int tick) { startTick = tick; }
+signals:
+    void finished();
+public slots:
+    void start();
+    void setSpeed(double speed);
+    void seek(int tick);
+private slots:
+    void advance();
+private:
+    bool readNext();
+    void playPending(bool notifyViews);
+
+    Simulation *simulation;
+    RecordingReader reader;
+    QTimer timer;
+    QTime realTime;
+    int startTick;
+    double speed, budget;
+    bool havePending;
+    RecordedTick pending;
+};
+
+#endif // SIMULATIONPLAYER_H
@@ -0,0 +1,211 @@
+#include "simulationrecorder.h"
+#include "recordingformat.h"
+#include <QDebug>
+#include <math.h>
+
+// Frames kept around so that recording does not allocate per tick
+#define RECORDER_FRAMES 32
+
+struct RecordedStateHeader
+{
+    qint32 tick, total, lastVesselId, count;
+    double time;
+};
+
+SimulationRecorder::SimulationRecorder(QObject *parent) : QThread(parent),
+    keyframeInterval(200), recordStates(false), rewindPending(false), stopping(false), current(0),
+    lastDtUs(0), lastTotal(0)
+{
+}
+
+SimulationRecorder::~SimulationRecorder() {
+    close();
+    qDeleteAll(freeFrames);
+}
+
+bool SimulationRecorder::open(const QString &fileName, int interval, bool states) {
+    close();
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Can't record to" << fileName << file.errorString();
+        return false;
+    }
+    quint32 version = RECORDING_VERSION;
+    file.write(RECORDING_MAGIC, 4);
+    file.write((const char*) &version, sizeof(version));
+    keyframeInterval = qMax(1, interval);
+    recordStates = states;
+    stopping = false;
+    lastDtUs = lastTotal = 0;
+    lastStates.clear();
+    while(freeFrames.size() < RECORDER_FRAMES)
+        freeFrames.append(new RecorderFrame);
+    start(QThread::LowPriority);
+    return true;
+}
+
+void SimulationRecorder::close() {
+    if(!isRunning()) return;
+    mutex.lock();
+    stopping = true;
+    frameQueued.wakeOne();
+    mutex.unlock();
+    wait();
+    file.close();
+}
+
+RecorderFrame *SimulationRecorder::takeFreeFrame() {
+    QMutexLocker locker(&mutex);
+    if(!freeFrames.isEmpty())
+        return freeFrames.takeLast();
+    // The writer has fallen behind; grow rather than lose inputs
+    return new RecorderFrame;
+}
+
+void SimulationRecorder::beginTick(const Simulation *simulation, double dt, int total) {
+    if(!isRunning()) return;
+    current = takeFreeFrame();
+    current->dt = dt;
+    current->total = total;
+    current->commands.resize(0);
+    current->rewind = rewindPending;
+    current->keyframe = rewindPending || simulation->tickCount() % keyframeInterval == 0;
+    rewindPending = false;
+    current->hasStates = false;
+    if(current->keyframe)
+        simulation->saveState(current->keyframeState);
+}
+
+void SimulationRecorder::markRewind() {
+    rewindPending = true;
+}
+
+void SimulationRecorder::recordCommand(const SimulationCommand &command) {
+    if(current)
+        current->commands.append(command);
+}
+
+void SimulationRecorder::endTick(const Simulation *simulation) {
+    if(!current) return;
+    if(recordStates) {
+        simulation->saveState(current->states);
+        current->hasStates = true;
+    }
+    QMutexLocker locker(&mutex);
+    queuedFrames.append(current);
+    current = 0;
+    frameQueued.wakeOne();
+}
+
+void SimulationRecorder::run() {
+    forever {
+        mutex.lock();
+        while(queuedFrames.isEmpty() && !stopping)
+            frameQueued.wait(&mutex);
+        if(queuedFrames.isEmpty()) {
+            mutex.unlock();
+            break;
+        }
+        RecorderFrame *frame = queuedFrames.takeFirst();
+        mutex.unlock();
+
+        encode(frame);
+        file.write(buffer);
+
+        mutex.lock();
+        freeFrames.append(frame);
+        mutex.unlock();
+    }
+    file.flush();
+}
+
+void SimulationRecorder::encode(RecorderFrame *frame) {
+    buffer.resize(0);
+    if(frame->keyframe) {
+        QByteArray raw;
+        encodeState(frame->keyframeState, raw);
+        QByteArray compressed = qCompress(raw);
+        buffer.append((char) (frame->rewind ? RecordingRewind : RecordingKeyframe));
+        appendVarint(buffer, frame->keyframeState.tick);
+        appendVarint(buffer, frame->keyframeState.total);
+        appendVarint(buffer, compressed.size());
+        buffer.append(compressed);
+        lastDtUs = 0;
+        lastTotal = frame->keyframeState.total;
+    }
+    for(int i=0;i<frame->commands.size();i++) {
+        const SimulationCommand &c = frame->commands[i];
+        buffer.append((char) RecordingCommand);
+        appendVarint(buffer, c.type);
+        appendVarint(buffer, zigzag(c.value));
+        appendVarint(buffer, zigzag(c.value2));
+        appendVarint(buffer, zigzag(qRound64(c.direction * 1000)));
+    }
+    qint64 dtUs = qRound64(frame->dt * 1e6);
+    buffer.append((char) RecordingTick);
+    appendVarint(buffer, zigzag(dtUs - lastDtUs));
+    appendVarint(buffer, frame->total - lastTotal);
+    lastDtUs = dtUs;
+    lastTotal = frame->total;
+    if(frame->hasStates)
+        encodeStates(frame->states);
+}
+
+void SimulationRecorder::encodeStates(const SimulationState &states) {
+    QByteArray payload;
+    appendVarint(payload, states.vessels.size() + 1);
+    for(int i=-1;i<states.vessels.size();i++) {
+        const VesselState &vs = i < 0 ? states.sub : states.vessels[i];
+        QuantizedState q;
+        q.x = qRound64(vs.x * 100);
+        q.y = qRound64(vs.y * 100);
+        q.depth = qRound64(vs.depth * 100);
+        q.heading = qRound64(vs.heading * 100);
+        q.speed = qRound64(vs.speed * 100);
+        QuantizedState last = lastStates.value(vs.id);
+        appendVarint(payload, vs.id);
+        appendVarint(payload, zigzag(q.x - last.x));
+        appendVarint(payload, zigzag(q.y - last.y));
+        appendVarint(payload, zigzag(q.depth - last.depth));
+        appendVarint(payload, zigzag(q.heading - last.heading));
+        appendVarint(payload, zigzag(q.speed - last.speed));
+        lastStates.insert(vs.id, q);
+    }
+    buffer.append((char) RecordingStates);
+    appendVarint(buffer, payload.size());
+    buffer.append(payload);
+}
+
+void SimulationRecorder::encodeState(const SimulationState &state, QByteArray &out) {
+    RecordedStateHeader header;
+    header.tick = state.tick;
+    header.total = state.total;
+    header.lastVesselId = state.lastVesselId;
+    header.time = state.time;
+    header.count = state.vessels.size();
+    out.resize(sizeof(header) + sizeof(VesselState) * (header.count + 1));
+    char *p = out.data();
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, &state.sub, sizeof(VesselState));
+    p += sizeof(VesselState);
+    memcpy(p, state.vessels.constData(), sizeof(VesselState) * header.count);
+}
+
+bool SimulationRecorder::decodeState(const uchar *data, int size, SimulationState &state) {
+    RecordedStateHeader header;
+    if(size < (int) sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if(header.count < 0 || size != (int)(sizeof(header) + sizeof(VesselState) * (header.count + 1)))
+        return false;
+    data += sizeof(header);
+    state.tick = header.tick;
+    state.total = header.total;
+    state.lastVesselId = header.lastVesselId;
+    state.time = header.time;
+    memcpy(&state.sub, data, sizeof(VesselState));
+    data += sizeof(VesselState);
+    state.vessels.resize(header.count);
+    memcpy(state.vessels.data(), data, sizeof(VesselState) * header.count);
+    return true;
+}
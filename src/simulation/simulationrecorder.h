@@ -0,0 +1,78 @@
+#ifndef SIMULATIONRECORDER_H
+#define SIMULATIONRECORDER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include "simulation.h"
+
+// Everything recorded for one tick, filled on the simulation thread
+struct RecorderFrame
+{
+    double dt;
+    int total;
+    QVector<SimulationCommand> commands;
+    bool keyframe, rewind, hasStates;
+    SimulationState keyframeState, states;
+};
+
+/*
+ * Streams a simulation's inputs to a recording file (see recordingformat.h).
+ *
+ * The simulation thread only copies the tick's inputs into a preallocated
+ * frame and queues it; encoding and file IO run on the recorder's own
+ * thread.
+ */
+class SimulationRecorder : public QThread
+{
+    Q_OBJECT
+public:
+    explicit SimulationRecorder(QObject *parent = 0);
+    ~SimulationRecorder();
+
+    // keyframeInterval in ticks; with recordStates every tick's vessel
+    // states are stored too
+    bool open(const QString &fileName, int keyframeInterval = 200, bool recordStates = false);
+    void close();
+
+    // Called by Simulation::step
+    void beginTick(const Simulation *simulation, double dt, int total);
+    void recordCommand(const SimulationCommand &command);
+    void endTick(const Simulation *simulation);
+    // The simulation jumped to another state; the next tick starts with a
+    // keyframe that players must apply
+    void markRewind();
+
+    static void encodeState(const SimulationState &state, QByteArray &out);
+    static bool decodeState(const uchar *data, int size, SimulationState &state);
+
+protected:
+    virtual void run();
+
+private:
+    RecorderFrame *takeFreeFrame();
+    void encode(RecorderFrame *frame);
+    void encodeStates(const SimulationState &states);
+
+    QFile file;
+    int keyframeInterval;
+    bool recordStates;
+    bool rewindPending;
+
+    QMutex mutex;
+    QWaitCondition frameQueued;
+    QList<RecorderFrame*> queuedFrames, freeFrames;
+    bool stopping;
+    RecorderFrame *current;
+
+    // Writer thread only
+    QByteArray buffer;
+    qint64 lastDtUs, lastTotal;
+    struct QuantizedState { qint64 x, y, depth, heading, speed; };
+    QHash<int, QuantizedState> lastStates;
+};
+
+#endif // SIMULATIONRECORDER_H
@@ -0,0 +1,32 @@
+#ifndef SIMULATIONSTATE_H
+#define SIMULATIONSTATE_H
+
+#include <QVector>
+#include "vessel.h"
+
+// An input to the simulation. Inputs are queued and applied at the start of
+// the next tick so that a recording replays exactly.
+struct SimulationCommand
+{
+    enum Type { Helm, Speed, DepthChange, FireTorpedo, Collision, AddPlayer, RemovePlayer };
+    qint32 type;
+    // Helm/Speed/DepthChange value, FireTorpedo mode, the two vessel ids of
+    // a Collision, the AddPlayer position in meters or the RemovePlayer id.
+    // Helm/Speed/DepthChange/FireTorpedo go to the player sub with id
+    // value2, 0 being the simulation's own sub.
+    qint32 value, value2;
+    // FireTorpedo direction
+    double direction;
+};
+
+// Everything needed to continue a simulation
+struct SimulationState
+{
+    int tick, total, lastVesselId;
+    // Simulated seconds
+    double time;
+    VesselState sub;
+    QVector<VesselState> vessels;
+};
+
+#endif // SIMULATIONSTATE_H
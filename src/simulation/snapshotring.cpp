@@ -0,0 +1,46 @@
+#include "snapshotring.h"
+#include "simulation.h"
+
+SnapshotRing::SnapshotRing() : head(0), used(0)
+{
+}
+
+void SnapshotRing::allocate(int count, int vesselCapacity) {
+    ring.resize(count);
+    for(int i=0;i<count;i++)
+        ring[i].vessels.reserve(vesselCapacity);
+    clear();
+}
+
+void SnapshotRing::clear() {
+    head = 0;
+    used = 0;
+}
+
+void SnapshotRing::take(const Simulation *simulation) {
+    if(ring.isEmpty()) return;
+    // saveState() resizes within the reserved capacity, growing only when
+    // the world outgrows it
+    simulation->saveState(ring[head]);
+    head = (head + 1) % ring.size();
+    used = qMin(used + 1, ring.size());
+}
+
+const SimulationState &SnapshotRing::at(int i) const {
+    return ring.at((head - 1 - i + ring.size()) % ring.size());
+}
+
+const SimulationState *SnapshotRing::findBefore(int tick) const {
+    for(int i=0;i<used;i++) {
+        if(at(i).tick < tick)
+            return &at(i);
+    }
+    return 0;
+}
+
+void SnapshotRing::discardAfter(int tick) {
+    while(used && at(0).tick > tick) {
+        head = (head - 1 + ring.size()) % ring.size();
+        used--;
+    }
+}
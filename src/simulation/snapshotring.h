@@ -0,0 +1,37 @@
+#ifndef SNAPSHOTRING_H
+#define SNAPSHOTRING_H
+
+#include <QVector>
+#include "simulationstate.h"
+
+class Simulation;
+
+/*
+ * Fixed ring of whole-world snapshots. Slots are allocated up front with
+ * room for a number of vessels, so taking a snapshot only copies states;
+ * the oldest snapshot is overwritten when the ring is full.
+ */
+class SnapshotRing
+{
+public:
+    SnapshotRing();
+    void allocate(int count, int vesselCapacity);
+    bool isAllocated() const { return !ring.isEmpty(); }
+
+    void take(const Simulation *simulation);
+    // Newest snapshot taken before tick, or 0
+    const SimulationState *findBefore(int tick) const;
+    // Forgets snapshots after tick, after rewinding past them
+    void discardAfter(int tick);
+    int count() const { return used; }
+    void clear();
+
+private:
+    // i = 0 is the newest
+    const SimulationState &at(int i) const;
+
+    QVector<SimulationState> ring;
+    int head, used;
+};
+
+#endif // SNAPSHOTRING_H
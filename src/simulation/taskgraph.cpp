@@ -0,0 +1,77 @@
+#include "taskgraph.h"
+#include "../profiling/profiler.h"
+#include <QDebug>
+
+void TaskGraph::ProfiledJob::run(int begin, int end) {
+    ProfileScope scope(zone);
+    job->run(begin, end);
+}
+
+TaskGraph::TaskGraph()
+{
+}
+
+int TaskGraph::addStage(const char *name, WorkJob *job, int grain) {
+    Stage stage;
+    stage.name = name;
+    stage.profiled.job = job;
+    stage.profiled.zone = Profiler::instance()->zone(name);
+    stage.count = 0;
+    stage.grain = grain;
+    stages.append(stage);
+    waves.clear();
+    return stages.size() - 1;
+}
+
+void TaskGraph::addDependency(int stage, int dependsOn) {
+    stages[stage].dependencies.append(dependsOn);
+    waves.clear();
+}
+
+void TaskGraph::setCount(int stage, int count) {
+    stages[stage].count = count;
+}
+
+void TaskGraph::computeWaves() {
+    QVector<int> wave(stages.size(), -1);
+    int placed = 0;
+    int w = 0;
+    waveStart.clear();
+    while(placed < stages.size()) {
+        waveStart.append(waves.size());
+        for(int s=0;s<stages.size();s++) {
+            if(wave[s] >= 0) continue;
+            bool ready = true;
+            foreach(int d, stages[s].dependencies)
+                ready = ready && wave[d] >= 0 && wave[d] < w;
+            if(ready) {
+                wave[s] = w;
+                waves.append(s);
+                placed++;
+            }
+        }
+        if(waves.size() == waveStart.last()) {
+            qWarning() << Q_FUNC_INFO << "dependency cycle, stages not run";
+            break;
+        }
+        w++;
+    }
+    waveStart.append(waves.size());
+}
+
+void TaskGraph::run(WorkPool *pool) {
+    if(waves.isEmpty())
+        computeWaves();
+    for(int w=0;w+1<waveStart.size();w++) {
+        ranges.resize(0);
+        for(int i=waveStart[w];i<waveStart[w + 1];i++) {
+            Stage &stage = stages[waves[i]];
+            WorkRange range;
+            range.job = &stage.profiled;
+            range.count = stage.count;
+            range.grain = stage.grain;
+            ranges.append(range);
+        }
+        pool->run(ranges.constData(), ranges.size());
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <QVector>
+#include "workpool.h"
+
+/*
+ * Stages of work with explicit dependencies, run on a WorkPool.
+ *
+ * A stage is a WorkJob over [0, count). Parallel stages are cut into chunks
+ * of their grain; serial stages (grain 0) run whole on the calling thread.
+ * Stages run in waves: a wave holds every stage whose dependencies finished
+ * in earlier waves, and its stages run side by side.
+ *
+ * Results do not depend on the thread count as long as a parallel stage
+ * only writes per-index results and anything order dependent is left to a
+ * serial stage.
+ */
+class TaskGraph
+{
+public:
+    TaskGraph();
+    // Name is a string literal, used as the stage's profiler zone
+    int addStage(const char *name, WorkJob *job, int grain = 0);
+    void addDependency(int stage, int dependsOn);
+    // Stage sizes usually change from run to run
+    void setCount(int stage, int count);
+    void run(WorkPool *pool);
+
+private:
+    void computeWaves();
+
+    class ProfiledJob : public WorkJob
+    {
+    public:
+        ProfiledJob() : job(0), zone(0) {}
+        virtual void run(int begin, int end);
+        WorkJob *job;
+        int zone;
+    };
+    struct Stage
+    {
+        const char *name;
+        ProfiledJob profiled;
+        int count, grain;
+        QVector<int> dependencies;
+    };
+    QVector<Stage> stages;
+    // Stage indices wave after wave, waveStart[w] is where wave w begins
+    QVector<int> waves, waveStart;
+    QVector<WorkRange> ranges;
+};
+
+#endif // TASKGRAPH_H
@@ -0,0 +1,48 @@
+#include "timingwheel.h"
+#include <math.h>
+
+// Entries each slot has room for before it has to grow
+#define TIMINGWHEEL_SLOT_CAPACITY 16
+
+TimingWheel::TimingWheel(int slots, double r) : wheel(slots), resolution(r), current(0)
+{
+    for(int i=0;i<wheel.size();i++)
+        wheel[i].reserve(TIMINGWHEEL_SLOT_CAPACITY);
+}
+
+qint64 TimingWheel::slotOf(double time) const {
+    return (qint64) floor(time / resolution);
+}
+
+void TimingWheel::reset(double now) {
+    for(int i=0;i<wheel.size();i++)
+        wheel[i].resize(0);
+    current = slotOf(now);
+}
+
+void TimingWheel::schedule(int id, double deadline) {
+    Entry e;
+    e.id = id;
+    e.deadline = deadline;
+    qint64 slot = qMax(slotOf(deadline), current);
+    wheel[slot % wheel.size()].append(e);
+}
+
+void TimingWheel::advance(double now, QVector<int> &expired) {
+    qint64 target = slotOf(now);
+    // A jump of a full turn or more visits every slot once
+    qint64 first = qMax(current, target - wheel.size() + 1);
+    for(qint64 s=first;s<=target;s++) {
+        QVector<Entry> &slot = wheel[s % wheel.size()];
+        for(int i=0;i<slot.size();) {
+            if(slot[i].deadline <= now) {
+                expired.append(slot[i].id);
+                slot[i] = slot.last();
+                slot.resize(slot.size() - 1);
+            } else {
+                i++;
+            }
+        }
+    }
+    current = target;
+}
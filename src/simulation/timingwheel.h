@@ -0,0 +1,33 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QVector>
+
+/*
+ * Hashed timing wheel over simulation time. Scheduling and advancing cost
+ * only the entries in the slots passed over; an entry further away than
+ * one turn stays in its slot until its round comes.
+ */
+class TimingWheel
+{
+public:
+    explicit TimingWheel(int slots = 64, double resolution = 1.0);
+    void reset(double now);
+    void schedule(int id, double deadline);
+    // Appends the ids due at or before now to expired
+    void advance(double now, QVector<int> &expired);
+
+private:
+    struct Entry
+    {
+        int id;
+        double deadline;
+    };
+    qint64 slotOf(double time) const;
+
+    QVector<QVector<Entry> > wheel;
+    double resolution;
+    qint64 current;
+};
+
+#endif // TIMINGWHEEL_H
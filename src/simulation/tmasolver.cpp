@@ -0,0 +1,221 @@
+#include "tmasolver.h"
+#include <math.h>
+
+#define TMA_MIN_RANGE 300
+#define TMA_MAX_SPEED 15
+// Kernel width of the resampling jitter relative to the spread of the
+// particles, which keeps them from collapsing onto a few copies
+#define TMA_KERNEL_WIDTH 0.2
+// Velocity noise per square root second, lets the solution follow a
+// maneuvering target
+#define TMA_VELOCITY_NOISE 0.05
+
+TmaSolver::TmaSolver(quint32 seed, int particles) :
+    count(particles), detections(0), originX(0), originY(0), time(0),
+    lastObserverX(0), lastObserverY(0), random(seed ? seed : 1),
+    px(particles), py(particles), pvx(particles), pvy(particles), weight(particles),
+    nx(particles), ny(particles), nvx(particles), nvy(particles)
+{
+}
+
+// xorshift32
+float TmaSolver::uniform() {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return (random >> 8) * (1.0f / 16777216.0f);
+}
+
+float TmaSolver::gaussian() {
+    float u1 = uniform() + 1.0f / 33554432.0f;
+    float u2 = uniform();
+    return sqrtf(-2 * logf(u1)) * cosf(2 * (float) M_PI * u2);
+}
+
+void TmaSolver::initialize(const SensorDetection &d) {
+    originX = d.observerX;
+    originY = d.observerY;
+    double maxRange = qMax((double) TMA_MIN_RANGE * 2, d.maxRange);
+    for(int i=0;i<count;i++) {
+        float b = (d.bearing + d.bearingSigma * gaussian()) * (M_PI/180.0);
+        float r = d.range >= 0 ? d.range + d.rangeSigma * gaussian()
+                               : TMA_MIN_RANGE + uniform() * (maxRange - TMA_MIN_RANGE);
+        float course = uniform() * 2 * (float) M_PI;
+        float speed = uniform() * TMA_MAX_SPEED;
+        px[i] = sinf(b) * r;
+        py[i] = -cosf(b) * r;
+        pvx[i] = sinf(course) * speed;
+        pvy[i] = -cosf(course) * speed;
+        weight[i] = 1.0f / count;
+    }
+    time = d.time;
+}
+
+void TmaSolver::predict(float dt) {
+    float *x = px.data(), *y = py.data();
+    const float *vx = pvx.constData(), *vy = pvy.constData();
+    for(int i=0;i<count;i++) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+// A Cauchy kernel on the sine of the bearing error: as selective as a
+// gaussian near the bearing, forgiving of the odd wild bearing, and cheap.
+// Particles behind the observer get nothing.
+float TmaSolver::weigh(const SensorDetection &d) {
+    float ox = d.observerX - originX, oy = d.observerY - originY;
+    float b = d.bearing * (M_PI/180.0);
+    float mx = sinf(b), my = -cosf(b);
+    float sigma = d.bearingSigma * (M_PI/180.0);
+    float bearingK = 1.0f / (2 * sigma * sigma);
+    bool ranged = d.range >= 0;
+    float range = ranged ? d.range : 0;
+    float rangeK = ranged ? 1.0f / (2 * d.rangeSigma * d.rangeSigma + 1) : 0;
+    const float *x = px.constData(), *y = py.constData();
+    float *w = weight.data();
+    for(int i=0;i<count;i++) {
+        float dx = x[i] - ox, dy = y[i] - oy;
+        float r2 = dx * dx + dy * dy + 1;
+        float cross = mx * dy - my * dx;
+        float ahead = mx * dx + my * dy > 0 ? 1.0f : 0.0f;
+        float rangeError = sqrtf(r2) - range;
+        float l = ahead / ((1 + cross * cross / r2 * bearingK) * (1 + rangeError * rangeError * rangeK));
+        w[i] *= l;
+    }
+    // Kept out of the loop above, a float sum only vectorizes with
+    // reassociation allowed
+    float sum = 0;
+    for(int i=0;i<count;i++)
+        sum += w[i];
+    return sum;
+}
+
+// Systematic resampling, then a shrunk kernel jitter (Liu and West) drawn
+// from the covariance of the cloud, which keeps its mean, spread and the
+// range-speed correlation along the bearing; plus velocity noise for the
+// time since the last detection
+void TmaSolver::resample(float sum, float dt) {
+    const QVector<float> *dims[4] = { &px, &py, &pvx, &pvy };
+    double mean[4], cov[4][4];
+    for(int a=0;a<4;a++) {
+        const float *v = dims[a]->constData();
+        double m = 0;
+        for(int i=0;i<count;i++)
+            m += weight[i] * v[i];
+        mean[a] = m / sum;
+    }
+    for(int a=0;a<4;a++) {
+        for(int b=0;b<=a;b++) {
+            const float *va = dims[a]->constData(), *vb = dims[b]->constData();
+            double c = 0;
+            for(int i=0;i<count;i++)
+                c += weight[i] * (va[i] - mean[a]) * (vb[i] - mean[b]);
+            cov[a][b] = c / sum;
+        }
+    }
+    // Cholesky factor, lower triangle; a degenerate direction gets no jitter
+    double l[4][4] = {{0}};
+    for(int a=0;a<4;a++) {
+        for(int b=0;b<=a;b++) {
+            double s = cov[a][b];
+            for(int k=0;k<b;k++)
+                s -= l[a][k] * l[b][k];
+            if(a == b)
+                l[a][a] = s > 0 ? sqrt(s) : 0;
+            else
+                l[a][b] = l[b][b] > 0 ? s / l[b][b] : 0;
+        }
+    }
+    float step = sum / count;
+    float u = uniform() * step;
+    float cumulative = weight[0];
+    int j = 0;
+    for(int i=0;i<count;i++) {
+        while(u > cumulative && j < count - 1)
+            cumulative += weight[++j];
+        nx[i] = px[j];
+        ny[i] = py[j];
+        nvx[i] = pvx[j];
+        nvy[i] = pvy[j];
+        u += step;
+    }
+    const float h = TMA_KERNEL_WIDTH, shrink = sqrtf(1 - h * h);
+    float noise = TMA_VELOCITY_NOISE * sqrtf(qMax(dt, 0.0f));
+    for(int i=0;i<count;i++) {
+        float z[4] = { gaussian(), gaussian(), gaussian(), gaussian() };
+        float jitter[4];
+        for(int a=0;a<4;a++) {
+            jitter[a] = 0;
+            for(int k=0;k<=a;k++)
+                jitter[a] += l[a][k] * z[k];
+            jitter[a] = (1 - shrink) * mean[a] + h * jitter[a];
+        }
+        px[i] = shrink * nx[i] + jitter[0];
+        py[i] = shrink * ny[i] + jitter[1];
+        pvx[i] = shrink * nvx[i] + jitter[2] + noise * gaussian();
+        pvy[i] = shrink * nvy[i] + jitter[3] + noise * gaussian();
+        weight[i] = 1.0f / count;
+    }
+}
+
+void TmaSolver::update(const SensorDetection &d) {
+    lastObserverX = d.observerX;
+    lastObserverY = d.observerY;
+    detections++;
+    if(detections == 1) {
+        initialize(d);
+        return;
+    }
+    float dt = d.time - time;
+    time = d.time;
+    predict(dt);
+    float sum = weigh(d);
+    // Nothing explains the bearing any more, e.g. the contact was lost for
+    // long; start over from it
+    if(!(sum > 1e-30f)) {
+        initialize(d);
+        return;
+    }
+    float squares = 0;
+    for(int i=0;i<count;i++)
+        squares += weight[i] * weight[i];
+    float effective = sum * sum / squares;
+    if(effective < count / 2) {
+        resample(sum, dt);
+    } else {
+        float scale = 1.0f / sum;
+        for(int i=0;i<count;i++)
+            weight[i] *= scale;
+    }
+}
+
+void TmaSolver::estimate(TrackEstimate &e) const {
+    double sum = 0, x = 0, y = 0, vx = 0, vy = 0;
+    for(int i=0;i<count;i++) {
+        sum += weight[i];
+        x += weight[i] * px[i];
+        y += weight[i] * py[i];
+        vx += weight[i] * pvx[i];
+        vy += weight[i] * pvy[i];
+    }
+    if(sum > 0) {
+        x /= sum;
+        y /= sum;
+        vx /= sum;
+        vy /= sum;
+    }
+    double spread = 0;
+    for(int i=0;i<count;i++)
+        spread += weight[i] * ((px[i] - x) * (px[i] - x) + (py[i] - y) * (py[i] - y));
+    e.time = time;
+    e.x = originX + x;
+    e.y = originY + y;
+    e.speed = sqrt(vx * vx + vy * vy);
+    e.course = fmod(atan2(vx, -vy) * (180.0/M_PI) + 360, 360);
+    double dx = e.x - lastObserverX, dy = e.y - lastObserverY;
+    e.range = sqrt(dx * dx + dy * dy);
+    e.bearing = fmod(atan2(dx, -dy) * (180.0/M_PI) + 360, 360);
+    e.positionError = sum > 0 ? sqrt(spread / sum) : 0;
+    e.detections = detections;
+}
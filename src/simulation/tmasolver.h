@@ -0,0 +1,61 @@
+#ifndef TMASOLVER_H
+#define TMASOLVER_H
+
+#include <QVector>
+#include "sensors.h"
+
+#define TMA_PARTICLES 1024
+
+// A track's solution, in world coordinates
+struct TrackEstimate
+{
+    int contact;
+    double time;
+    double x, y, course, speed;
+    // From the observer of the newest detection
+    double range, bearing;
+    // Spread of the particles around the estimated position, meters
+    double positionError;
+    int detections;
+};
+
+/*
+ * Bearings-only target motion analysis for one contact, as a particle
+ * filter over constant-velocity target motions. Particles start spread
+ * along the first bearing out to the sensor's reach with any course and
+ * speed; each detection moves them to its time, weighs them by how well
+ * they explain the bearing (and periscope range) and resamples when the
+ * weight concentrates on few. The solution firms up as the observer
+ * maneuvers.
+ *
+ * The particle state is kept as arrays of floats relative to the first
+ * observer position, and the predict and weigh loops are free of branches
+ * and calls so the compiler vectorizes them.
+ */
+class TmaSolver
+{
+public:
+    explicit TmaSolver(quint32 seed = 1, int particles = TMA_PARTICLES);
+    int particleCount() const { return count; }
+    void update(const SensorDetection &d);
+    void estimate(TrackEstimate &e) const;
+    double lastTime() const { return time; }
+private:
+    void initialize(const SensorDetection &d);
+    void predict(float dt);
+    // Returns the weight sum
+    float weigh(const SensorDetection &d);
+    void resample(float sum, float dt);
+    float uniform();
+    float gaussian();
+
+    int count, detections;
+    double originX, originY, time;
+    double lastObserverX, lastObserverY;
+    quint32 random;
+    QVector<float> px, py, pvx, pvy, weight;
+    // Resampling scratch
+    QVector<float> nx, ny, nvx, nvy;
+};
+
+#endif // TMASOLVER_H
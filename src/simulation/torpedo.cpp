@@ -1,18 +1,75 @@
 #include "torpedo.h"
+#include "contactgrid.h"
 #include <math.h>
 
-Torpedo::Torpedo(QObject *parent, int i) : Vessel(parent, i)
+Torpedo::Torpedo(QObject *parent, int i) : Vessel(parent, i), contacts(0)
 {
+    reset(i);
+}
+
+void Torpedo::setContacts(const ContactGrid *grid) {
+    contacts = grid;
+}
+
+void Torpedo::reset(int i) {
+    id = i;
+    x = y = depth = heading = speed = helm = verticalVelocity = 0;
+    slot = -1;
+    sector = sectorSlot = -1;
+    lagTime = 0;
+    pendingRemoval = false;
     type = 2;
-    speedCommand = 50;
-    acceleration = 5;
+    speedCommand = TORPEDO_SPEED;
+    acceleration = TORPEDO_ACCELERATION;
     headingCommand = heading;
-    QTimer::singleShot(50000, this, SLOT(deleteLater()));
+    runTime = 0;
+    mode = Straight;
+    targetId = 0;
 }
+
 void Torpedo::tickTime(double dt, int total) {
     Vessel::tickTime(dt, total);
+    runTime += dt;
+    targetId = 0;
+
+    if(runTime < TORPEDO_ENABLE_TIME || mode == Straight) {
+        steer(headingCommand);
+        return;
+    }
+    if(isHoming() && contacts) {
+        SeekerCone cone;
+        cone.x = x;
+        cone.y = y;
+        cone.heading = heading;
+        cone.active = mode == ActiveHoming;
+        cone.range = cone.active ? TORPEDO_ACTIVE_RANGE : TORPEDO_PASSIVE_RANGE;
+        cone.halfAngle = cone.active ? TORPEDO_ACTIVE_HALF_ANGLE : TORPEDO_PASSIVE_HALF_ANGLE;
+        // Steers on where the target was at the start of the tick: this
+        // runs in parallel with the target's own integration
+        SeekerContact target;
+        if(contacts->acquire(cone, target)) {
+            targetId = target.id;
+            double bearing = atan2(target.x - x, y - target.y) * (180.0/M_PI);
+            if(bearing < 0) bearing += 360;
+            steer(bearing);
+            return;
+        }
+    }
+    // Pattern torpedoes, and homing ones searching for a target, snake
+    // across the launch course
+    steer(patternHeading());
+}
+
+double Torpedo::patternHeading() const {
+    int leg = (int) ((runTime - TORPEDO_ENABLE_TIME) / TORPEDO_PATTERN_LEG);
+    double h = headingCommand + ((leg & 1) ? -TORPEDO_PATTERN_ANGLE : TORPEDO_PATTERN_ANGLE);
+    if(h < 0) h += 360;
+    if(h >= 360) h -= 360;
+    return h;
+}
 
-    if(qAbs(heading - headingCommand) < 0.5) {
+void Torpedo::steer(double command) {
+    if(qAbs(heading - command) < 0.5) {
         setHelm(0);
         return;
     }
@@ -20,9 +77,23 @@ void Torpedo::tickTime(double dt, int total) {
     double x1,y1,x2,y2;
     x1=sinf(heading * (M_PI/180.0));
     y1=cosf(heading * (M_PI/180.0));
-    x2=sinf(headingCommand * (M_PI/180.0));
-    y2=cosf(headingCommand * (M_PI/180.0));
+    x2=sinf(command * (M_PI/180.0));
+    y2=cosf(command * (M_PI/180.0));
     double cross = x1*y2 - y1*x2;
-    if(cross < 0) setHelm(2);
-    else setHelm(-2);
+    if(cross < 0) setHelm(TORPEDO_HELM);
+    else setHelm(-TORPEDO_HELM);
+}
+
+void Torpedo::saveState(VesselState &state) const {
+    Vessel::saveState(state);
+    state.headingCommand = headingCommand;
+    state.runTime = runTime;
+    state.mode = mode;
+}
+
+void Torpedo::restoreState(const VesselState &state) {
+    Vessel::restoreState(state);
+    headingCommand = state.headingCommand;
+    runTime = state.runTime;
+    mode = state.mode;
 }
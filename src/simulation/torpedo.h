@@ -1,17 +1,55 @@
 #ifndef TORPEDO_H
 #define TORPEDO_H
 #include "vessel.h"
-#include <QTimer>
+
+class ContactGrid;
+
+// Torpedoes are removed by the simulation after running this many seconds
+#define TORPEDO_RUN_TIME 50
+// Seconds before the warhead arms, and how close it has to get to hit
+#define TORPEDO_ARM_TIME 2
+#define TORPEDO_HIT_RADIUS 25
+// Seconds of straight run before patterns and seekers start
+#define TORPEDO_ENABLE_TIME 5
+// Pattern running: legs of this many seconds, this many degrees off course
+#define TORPEDO_PATTERN_LEG 8
+#define TORPEDO_PATTERN_ANGLE 30
+// Seeker ranges in meters and half angles in degrees
+#define TORPEDO_PASSIVE_RANGE 2000
+#define TORPEDO_PASSIVE_HALF_ANGLE 40
+#define TORPEDO_ACTIVE_RANGE 1200
+#define TORPEDO_ACTIVE_HALF_ANGLE 25
+// Run speed and acceleration, the speed over the launching sub's at launch,
+// and the helm used to steer (3 degrees per second per unit of helm)
+#define TORPEDO_SPEED 50
+#define TORPEDO_ACCELERATION 5
+#define TORPEDO_LAUNCH_SPEED 10
+#define TORPEDO_HELM 2
+
 class Torpedo : public Vessel
 {
     Q_OBJECT
 public:
+    enum Mode { Straight, Pattern, PassiveHoming, ActiveHoming };
     explicit Torpedo(QObject *parent, int id);
+    // Makes a pooled torpedo new again
+    void reset(int id);
+    // Contacts the seeker looks at, rebuilt by the simulation every tick
+    void setContacts(const ContactGrid *grid);
+    bool isHoming() const { return mode == PassiveHoming || mode == ActiveHoming; }
+    int mode;
+    // Vessel the seeker locked on this tick, 0 if none
+    int targetId;
     double headingCommand;
-signals:
-
-public slots:
+    // Seconds since launch
+    double runTime;
     virtual void tickTime(double dt, int total);
+    virtual void saveState(VesselState &state) const;
+    virtual void restoreState(const VesselState &state);
+private:
+    double patternHeading() const;
+    void steer(double command);
+    const ContactGrid *contacts;
 };
 
 #endif // TORPEDO_H
@@ -1,12 +1,18 @@
 #include "vessel.h"
 #include <QDebug>
 #include <math.h>
+#include <string.h>
 
 Vessel::Vessel(QObject *parent, int i) :
     QObject(parent), id(i)
 {
     x = y = depth = heading = speed = helm = verticalVelocity = speedCommand = 0;
     type = 0;
+    slot = -1;
+    pendingRemoval = false;
+    sector = sectorSlot = -1;
+    lagTime = 0;
+    memset(&ai, 0, sizeof(ai));
     acceleration = 1.0;
 }
 
@@ -43,13 +49,43 @@ void Vessel::tickTime(double dt, int total) {
     if(speed > speedCommand)
         speed -= acceleration*dt*3;
 
-    if(depth > 50)
-        deleteLater();
-
     Q_ASSERT(speed < 51);
     Q_ASSERT(speed > -20);
+}
+
+void Vessel::advance(double t) {
+    // Speed ramps at tickTime's rates and holds once it reaches the order,
+    // the path is covered at the mean speed
+    double rate = speed < speedCommand ? acceleration : acceleration * 3;
+    double change = fabs(speedCommand - speed);
+    double rampTime = qMin(t, change / rate);
+    double endSpeed = speed + (speedCommand > speed ? 1 : -1) * rate * rampTime;
+    double meanSpeed = ((speed + endSpeed) / 2 * rampTime + endSpeed * (t - rampTime)) / t;
 
-    emit vesselUpdated(this);
+    double h0 = heading * (M_PI/180.0);
+    double turnRate = helm * 3 * (M_PI/180.0);
+    double h1 = h0 + turnRate * t;
+    if(fabs(turnRate * t) < 1e-6) {
+        x += sin(h0) * meanSpeed * t;
+        y -= cos(h0) * meanSpeed * t;
+    } else {
+        x += meanSpeed / turnRate * (cos(h0) - cos(h1));
+        y -= meanSpeed / turnRate * (sin(h1) - sin(h0));
+    }
+    heading = fmod(heading + helm * 3 * t, 360.0);
+    if(heading < 0)
+        heading += 360;
+    speed = endSpeed;
+    depth += verticalVelocity * t;
+    if(depth < 0) depth = 0;
+}
+
+// Ground covered at the fastest the vessel may go, plus the most the mean
+// speed of advance() can be off while the speed ramps
+double Vessel::driftBound(double t) const {
+    double fastest = qMax(fabs(speed), fabs(speedCommand));
+    double change = qMin(fabs(speedCommand - speed), acceleration * 3 * t);
+    return fastest * t + change * t / 2;
 }
 
 void Vessel::wasHitByTorpedo() {
@@ -57,3 +93,36 @@ void Vessel::wasHitByTorpedo() {
     setHelm(0);
     verticalVelocity = 1;
 }
+
+void Vessel::saveState(VesselState &state) const {
+    state.x = x;
+    state.y = y;
+    state.depth = depth;
+    state.verticalVelocity = verticalVelocity;
+    state.heading = heading;
+    state.speed = speed;
+    state.speedCommand = speedCommand;
+    state.helm = helm;
+    state.headingCommand = 0;
+    state.runTime = 0;
+    state.lagTime = lagTime;
+    state.id = id;
+    state.type = type;
+    state.mode = 0;
+    state.ai = ai;
+}
+
+void Vessel::restoreState(const VesselState &state) {
+    x = state.x;
+    y = state.y;
+    depth = state.depth;
+    verticalVelocity = state.verticalVelocity;
+    heading = state.heading;
+    speed = state.speed;
+    speedCommand = state.speedCommand;
+    helm = state.helm;
+    lagTime = state.lagTime;
+    id = state.id;
+    type = state.type;
+    ai = state.ai;
+}
@@ -3,15 +3,62 @@
 
 #include <QObject>
 
+enum ShipBehaviour { ShipTransit, ShipZigZag, ShipConvoy };
+
+// What a ship's AI remembers between decisions, see shipai.h
+struct ShipAiState
+{
+    qint32 behaviour;
+    // Convoy: the ship keeping station on, and the station in its frame,
+    // meters to the right and ahead
+    qint32 guideId;
+    double formationX, formationY;
+    // Orders the ship was given, returned to after evading
+    double baseCourse, baseSpeed, baseHelm;
+    // Evading until this simulation time, away from the danger
+    double evadeCourse, evadeUntil;
+};
+
+// Plain copy of everything that evolves in a vessel, used by recordings and
+// state snapshots
+struct VesselState
+{
+    double x, y, depth, verticalVelocity, heading, speed, speedCommand, helm;
+    // Torpedo only
+    double headingCommand, runTime;
+    // Simulated time a vessel in a far sector has yet to be advanced by
+    double lagTime;
+    qint32 id, type;
+    qint32 mode;
+    ShipAiState ai;
+};
+
 class Vessel : public QObject
 {
     Q_OBJECT
 public:
-    explicit Vessel(QObject *parent, int i);
+    explicit Vessel(QObject *parent = 0, int i = 0);
     double x, y, depth, verticalVelocity, heading, speed, speedCommand, helm;
     int id, type;
-signals:
-    void vesselUpdated(Vessel *v);
+    // Index in the simulation's vessel array, and whether the vessel goes
+    // away at the end of the current tick
+    int slot;
+    bool pendingRemoval;
+    // World sector and index in it, see WorldPartition, and the time the
+    // vessel lags behind the simulation while its sector is inactive
+    int sector, sectorSlot;
+    double lagTime;
+    ShipAiState ai;
+    // Advances the vessel by dt seconds. Called by Simulation::tick.
+    virtual void tickTime(double dt, int total);
+    // Closed form of tickTime() over a long step, with helm and orders held:
+    // a constant turn rate and the speed ramping to its order
+    void advance(double t);
+    // How far the vessel can be from where fine ticks would put it, after
+    // lagging for t or being advanced over it in one step
+    double driftBound(double t) const;
+    virtual void saveState(VesselState &state) const;
+    virtual void restoreState(const VesselState &state);
 protected:
     double acceleration;
 
@@ -19,7 +66,6 @@ public slots:
     void setHelm(int h);
     void setSpeed(int s);
     void setDepthChange(int s);
-    virtual void tickTime(double dt, int total);
     void wasHitByTorpedo();
 };
 
@@ -0,0 +1,155 @@
+#include "workpool.h"
+
+WorkPoolThread::WorkPoolThread(WorkPool *p, int i) : pool(p), index(i)
+{
+}
+
+void WorkPoolThread::run() {
+    pool->workerLoop(index);
+}
+
+WorkPool::WorkPool(int threads) : generation(0), stopping(false)
+{
+    if(threads <= 0)
+        threads = qMax(1, QThread::idealThreadCount());
+    // Deque 0 belongs to the calling thread
+    for(int i=0;i<threads;i++) {
+        Deque *d = new Deque;
+        d->head = 0;
+        deques.append(d);
+    }
+    for(int i=1;i<threads;i++) {
+        WorkPoolThread *t = new WorkPoolThread(this, i);
+        workers.append(t);
+        t->start();
+    }
+}
+
+WorkPool::~WorkPool() {
+    mutex.lock();
+    stopping = true;
+    jobStarted.wakeAll();
+    mutex.unlock();
+    foreach(WorkPoolThread *t, workers) {
+        t->wait();
+        delete t;
+    }
+    qDeleteAll(deques);
+}
+
+bool WorkPool::takeChunk(int self, Chunk &chunk) {
+    // Own work from the back, it is the most recently dealt and still warm
+    Deque *own = deques[self];
+    own->mutex.lock();
+    if(own->chunks.size() > own->head) {
+        chunk = own->chunks.last();
+        own->chunks.resize(own->chunks.size() - 1);
+        own->mutex.unlock();
+        return true;
+    }
+    own->mutex.unlock();
+    // Steal from the front of the others
+    for(int i=1;i<deques.size();i++) {
+        Deque *victim = deques[(self + i) % deques.size()];
+        victim->mutex.lock();
+        if(victim->chunks.size() > victim->head) {
+            chunk = victim->chunks[victim->head++];
+            victim->mutex.unlock();
+            return true;
+        }
+        victim->mutex.unlock();
+    }
+    return false;
+}
+
+void WorkPool::work(int self) {
+    Chunk chunk;
+    while(takeChunk(self, chunk)) {
+        chunk.job->run(chunk.begin, chunk.end);
+        if(!remaining.deref()) {
+            mutex.lock();
+            jobDone.wakeAll();
+            mutex.unlock();
+        }
+    }
+}
+
+void WorkPool::workerLoop(int self) {
+    int seen = 0;
+    forever {
+        mutex.lock();
+        while(generation == seen && !stopping)
+            jobStarted.wait(&mutex);
+        if(stopping) {
+            mutex.unlock();
+            return;
+        }
+        seen = generation;
+        mutex.unlock();
+        work(self);
+    }
+}
+
+void WorkPool::parallelFor(WorkJob *job, int count, int grain) {
+    WorkRange range;
+    range.job = job;
+    range.count = count;
+    range.grain = qMax(1, grain);
+    run(&range, 1);
+}
+
+void WorkPool::run(const WorkRange *ranges, int count) {
+    dealt.resize(0);
+    for(int r=0;r<count;r++) {
+        const WorkRange &range = ranges[r];
+        if(range.grain <= 0) continue;
+        for(int begin=0;begin<range.count;begin+=range.grain) {
+            Chunk chunk;
+            chunk.job = range.job;
+            chunk.begin = begin;
+            chunk.end = qMin(range.count, begin + range.grain);
+            dealt.append(chunk);
+        }
+    }
+    // Not worth waking anyone for
+    if(workers.isEmpty() || dealt.size() <= 1) {
+        for(int r=0;r<count;r++) {
+            if(ranges[r].grain <= 0 && ranges[r].count > 0)
+                ranges[r].job->run(0, ranges[r].count);
+        }
+        for(int i=0;i<dealt.size();i++)
+            dealt[i].job->run(dealt[i].begin, dealt[i].end);
+        return;
+    }
+
+    // Workers still looking for chunks of the previous run may pick these
+    // up as soon as they are dealt, so the count has to be in place first
+    int chunks = dealt.size();
+    remaining = chunks;
+    // Contiguous runs per thread keep neighbouring data on one core
+    for(int i=0;i<deques.size();i++) {
+        Deque *d = deques[i];
+        QMutexLocker locker(&d->mutex);
+        d->chunks.resize(0);
+        d->head = 0;
+        int first = (qint64) i * chunks / deques.size();
+        int last = (qint64) (i + 1) * chunks / deques.size();
+        for(int c=first;c<last;c++)
+            d->chunks.append(dealt[c]);
+    }
+    mutex.lock();
+    generation++;
+    jobStarted.wakeAll();
+    mutex.unlock();
+
+    for(int r=0;r<count;r++) {
+        if(ranges[r].grain <= 0 && ranges[r].count > 0)
+            ranges[r].job->run(0, ranges[r].count);
+    }
+    work(0);
+
+    mutex.lock();
+    while(remaining != 0)
+        jobDone.wait(&mutex);
+    mutex.unlock();
+}
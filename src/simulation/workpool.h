@@ -0,0 +1,97 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QVector>
+
+// A range of work handed to the pool. run() is called from several threads
+// at once with disjoint ranges.
+class WorkJob
+{
+public:
+    virtual ~WorkJob() {}
+    virtual void run(int begin, int end) = 0;
+};
+
+// Runs a member function of an object as a job
+template<class T>
+class MemberJob : public WorkJob
+{
+public:
+    typedef void (T::*Function)(int begin, int end);
+    MemberJob(T *o, Function f) : object(o), function(f) {}
+    virtual void run(int begin, int end) { (object->*function)(begin, end); }
+private:
+    T *object;
+    Function function;
+};
+
+// A job over [0, count) cut into chunks of grain. Grain 0 means the job
+// runs whole on the calling thread, for work that must stay there.
+struct WorkRange
+{
+    WorkJob *job;
+    int count, grain;
+};
+
+class WorkPool;
+
+class WorkPoolThread : public QThread
+{
+public:
+    WorkPoolThread(WorkPool *pool, int index);
+protected:
+    virtual void run();
+private:
+    WorkPool *pool;
+    int index;
+};
+
+/*
+ * Work-stealing thread pool for data-parallel simulation stages.
+ *
+ * run() cuts each range into chunks and deals them out to per-thread
+ * deques. Each thread takes from the back of its own deque and, when that
+ * runs dry, steals from the front of the others'. The calling thread first
+ * runs the ranges that have to stay on it, then works along, and returns
+ * when every chunk is done.
+ */
+class WorkPool
+{
+public:
+    // threads = 0 uses one thread per core, counting the caller
+    explicit WorkPool(int threads = 0);
+    ~WorkPool();
+    int threadCount() const { return workers.size() + 1; }
+    void run(const WorkRange *ranges, int count);
+    void parallelFor(WorkJob *job, int count, int grain);
+
+private:
+    friend class WorkPoolThread;
+    struct Chunk { WorkJob *job; int begin, end; };
+    struct Deque
+    {
+        QMutex mutex;
+        QVector<Chunk> chunks;
+        int head;
+    };
+
+    bool takeChunk(int self, Chunk &chunk);
+    void work(int self);
+    void workerLoop(int self);
+
+    QVector<WorkPoolThread*> workers;
+    QVector<Deque*> deques;
+    QVector<Chunk> dealt;
+    QAtomicInt remaining;
+
+    QMutex mutex;
+    QWaitCondition jobStarted, jobDone;
+    int generation;
+    bool stopping;
+};
+
+#endif // WORKPOOL_H
@@ -0,0 +1,100 @@
+#include "worldpartition.h"
+#include "vessel.h"
+#include <math.h>
+
+WorldPartition::WorldPartition(double size, int ring) :
+    sectorSize(size), activeRing(ring)
+{
+}
+
+void WorldPartition::clear() {
+    sectors.clear();
+    sectorIndex.clear();
+    activeSectors.clear();
+}
+
+int WorldPartition::cellOf(double v) const {
+    return (int) floor(v / sectorSize);
+}
+
+qint64 WorldPartition::keyOf(double x, double y) const {
+    return key(cellOf(x), cellOf(y));
+}
+
+int WorldPartition::findOrAdd(qint64 k) {
+    int index = sectorIndex.value(k, -1);
+    if(index >= 0)
+        return index;
+    Sector sector;
+    sector.key = k;
+    sector.active = false;
+    sectors.append(sector);
+    sectorIndex.insert(k, sectors.size() - 1);
+    return sectors.size() - 1;
+}
+
+void WorldPartition::rebuild(const QVector<Vessel*> &vessels) {
+    for(int i=0;i<sectors.size();i++)
+        sectors[i].vessels.resize(0);
+    for(int i=0;i<vessels.size();i++)
+        insert(vessels[i]);
+}
+
+void WorldPartition::insert(Vessel *v) {
+    v->sector = findOrAdd(keyOf(v->x, v->y));
+    QVector<Vessel*> &list = sectors[v->sector].vessels;
+    v->sectorSlot = list.size();
+    list.append(v);
+}
+
+void WorldPartition::remove(Vessel *v) {
+    if(v->sector < 0) return;
+    QVector<Vessel*> &list = sectors[v->sector].vessels;
+    Vessel *last = list.last();
+    list[v->sectorSlot] = last;
+    last->sectorSlot = v->sectorSlot;
+    list.resize(list.size() - 1);
+    v->sector = v->sectorSlot = -1;
+}
+
+bool WorldPartition::hasMoved(const Vessel *v) const {
+    return sectors[v->sector].key != keyOf(v->x, v->y);
+}
+
+void WorldPartition::update(Vessel *v) {
+    if(v->sector >= 0 && !hasMoved(v)) return;
+    remove(v);
+    insert(v);
+}
+
+void WorldPartition::beginActivation() {
+    for(int i=0;i<activeSectors.size();i++)
+        sectors[activeSectors[i]].active = false;
+    activeSectors.resize(0);
+}
+
+// Creates the sectors around a focus even when empty, so a vessel moving
+// into one finds it active
+void WorldPartition::activateAround(double x, double y) {
+    int cx = cellOf(x), cy = cellOf(y);
+    for(int dy=-activeRing;dy<=activeRing;dy++) {
+        for(int dx=-activeRing;dx<=activeRing;dx++) {
+            int s = findOrAdd(key(cx + dx, cy + dy));
+            if(sectors[s].active) continue;
+            sectors[s].active = true;
+            activeSectors.append(s);
+        }
+    }
+}
+
+void WorldPartition::collect(double x, double y, double radius, QVector<Vessel*> &out) const {
+    int x0 = cellOf(x - radius), x1 = cellOf(x + radius);
+    int y0 = cellOf(y - radius), y1 = cellOf(y + radius);
+    for(int cy=y0;cy<=y1;cy++) {
+        for(int cx=x0;cx<=x1;cx++) {
+            int s = sectorIndex.value(key(cx, cy), -1);
+            if(s >= 0)
+                out += sectors[s].vessels;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef WORLDPARTITION_H
+#define WORLDPARTITION_H
+
+#include <QVector>
+#include <QHash>
+
+class Vessel;
+
+/*
+ * The world cut into square sectors keyed by grid cell. Sectors are created
+ * as vessels enter them and kept when they empty, so a vessel can refer to
+ * its sector by index.
+ *
+ * Sectors near a focus (the sub, running torpedoes) are active and tick
+ * every step; vessels elsewhere are simulated coarsely, see
+ * Simulation::integrateVessels().
+ */
+class WorldPartition
+{
+public:
+    explicit WorldPartition(double sectorSize = 20000, int activeRing = 1);
+    void clear();
+    // All of the vessels, e.g. after restoring a state
+    void rebuild(const QVector<Vessel*> &vessels);
+    void insert(Vessel *v);
+    void remove(Vessel *v);
+    // Whether the vessel has left the sector it is filed under; safe to call
+    // from parallel stages
+    bool hasMoved(const Vessel *v) const;
+    // Files the vessel under the sector it is in now
+    void update(Vessel *v);
+
+    // Activates the sectors within activeRing of the foci given since the
+    // last beginActivation()
+    void beginActivation();
+    void activateAround(double x, double y);
+    // By sector index, Vessel::sector
+    bool isActive(int sector) const { return sectors[sector].active; }
+
+    int sectorCount() const { return sectors.size(); }
+    int activeCount() const { return activeSectors.size(); }
+    int vesselCount(int sector) const { return sectors[sector].vessels.size(); }
+    // Appends the vessels of the sectors overlapping the square around x, y;
+    // the caller checks the actual distance
+    void collect(double x, double y, double radius, QVector<Vessel*> &out) const;
+
+private:
+    struct Sector
+    {
+        qint64 key;
+        bool active;
+        QVector<Vessel*> vessels;
+    };
+    static qint64 key(int cx, int cy) { return ((qint64) cx << 32) | (quint32) cy; }
+    int cellOf(double v) const;
+    qint64 keyOf(double x, double y) const;
+    int findOrAdd(qint64 key);
+
+    double sectorSize;
+    int activeRing;
+    QVector<Sector> sectors;
+    QHash<qint64, int> sectorIndex;
+    QVector<int> activeSectors;
+};
+
+#endif // WORLDPARTITION_H
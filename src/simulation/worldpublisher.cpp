@@ -0,0 +1,131 @@
+#include "worldpublisher.h"
+#include "simulation.h"
+#include "torpedo.h"
+#include "../profiling/profiler.h"
+#include <QDebug>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+SharedWorldPublisher::SharedWorldPublisher(Simulation *s, QObject *parent) :
+    QObject(parent), simulation(s), fd(-1), capacity(0), size(0), mapped(0),
+    explosionX(0), explosionY(0), explosionIntensity(0), explosionCount(0), published(0),
+    solutionTarget(0), solutionValid(false), solutionGyroAngle(0), solutionRunTime(0)
+{
+}
+
+SharedWorldPublisher::~SharedWorldPublisher() {
+    close();
+}
+
+bool SharedWorldPublisher::open(const QString &n, int c) {
+    close();
+    name = n;
+    capacity = c;
+    size = sizeof(SharedWorldHeader) + SHARED_WORLD_SLOTS * sharedWorldFrameSize(capacity);
+    // A segment left behind by a crashed simulation is unlinked; readers
+    // still mapping it see it go stale and open the new one
+    shm_unlink(name.toLocal8Bit().constData());
+    fd = shm_open(name.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0 || ftruncate(fd, size) < 0) {
+        qWarning() << Q_FUNC_INFO << "can't create" << name << strerror(errno);
+        close();
+        return false;
+    }
+    void *p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED) {
+        qWarning() << Q_FUNC_INFO << "can't map" << name << strerror(errno);
+        close();
+        return false;
+    }
+    mapped = (uchar*) p;
+    memset(mapped, 0, size);
+    SharedWorldHeader *header = (SharedWorldHeader*) mapped;
+    header->version = SHARED_WORLD_VERSION;
+    header->slotCount = SHARED_WORLD_SLOTS;
+    header->capacity = capacity;
+    header->frameSize = sharedWorldFrameSize(capacity);
+    header->latest = -1;
+    // Readers check the magic last
+    SHARED_WORLD_BARRIER();
+    header->magic = SHARED_WORLD_MAGIC;
+    qDebug() << "Publishing world to" << name << size / 1024 << "kB";
+    return true;
+}
+
+void SharedWorldPublisher::close() {
+    if(mapped) {
+        munmap(mapped, size);
+        shm_unlink(name.toLocal8Bit().constData());
+    }
+    if(fd >= 0)
+        ::close(fd);
+    mapped = 0;
+    fd = -1;
+}
+
+SharedWorldFrame *SharedWorldPublisher::frame(int slot) {
+    return (SharedWorldFrame*) (mapped + sizeof(SharedWorldHeader) + slot * sharedWorldFrameSize(capacity));
+}
+
+void SharedWorldPublisher::explosion(double x, double y, double intensity) {
+    explosionX = x;
+    explosionY = y;
+    explosionIntensity = intensity;
+    explosionCount++;
+}
+
+void SharedWorldPublisher::solutionChanged(int target, bool valid, double gyroAngle, double runTime) {
+    solutionTarget = target;
+    solutionValid = valid;
+    solutionGyroAngle = gyroAngle;
+    solutionRunTime = runTime;
+}
+
+void SharedWorldPublisher::publish(double dt, int total) {
+    if(!mapped) return;
+    PROFILE_SCOPE("sim.publish");
+    SharedWorldHeader *header = (SharedWorldHeader*) mapped;
+    int slot = (header->latest + 1) % SHARED_WORLD_SLOTS;
+    SharedWorldFrame *f = frame(slot);
+    f->seq++;
+    SHARED_WORLD_BARRIER();
+
+    const QVector<Vessel*> &vessels = simulation->vessels();
+    int count = qMin(vessels.size() + 1, capacity);
+    f->number = ++published;
+    f->tick = simulation->tickCount();
+    f->total = total;
+    f->count = count;
+    f->time = simulation->simulatedTime();
+    f->dt = dt;
+    f->explosionX = explosionX;
+    f->explosionY = explosionY;
+    f->explosionIntensity = explosionIntensity;
+    f->explosionCount = explosionCount;
+    f->solutionTarget = solutionTarget;
+    f->solutionValid = solutionValid;
+    f->solutionGyroAngle = solutionGyroAngle;
+    f->solutionRunTime = solutionRunTime;
+    for(int i=0;i<count;i++) {
+        const Vessel *v = i ? vessels[i - 1] : simulation->getSub();
+        SharedVessel &sv = f->vessels[i];
+        sv.x = v->x;
+        sv.y = v->y;
+        sv.depth = v->depth;
+        sv.heading = v->heading;
+        sv.speed = v->speed;
+        sv.helm = v->helm;
+        sv.id = v->id;
+        sv.type = v->type;
+        sv.mode = v->type == 2 ? static_cast<const Torpedo*>(v)->mode : 0;
+    }
+
+    SHARED_WORLD_BARRIER();
+    f->seq++;
+    SHARED_WORLD_BARRIER();
+    header->latest = slot;
+}
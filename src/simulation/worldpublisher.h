@@ -0,0 +1,44 @@
+#ifndef WORLDPUBLISHER_H
+#define WORLDPUBLISHER_H
+
+#include <QObject>
+#include <QString>
+#include "sharedworld.h"
+
+class Simulation;
+
+// Publishes the simulation after every tick. Publishing without readers
+// costs one copy of the world into the segment.
+class SharedWorldPublisher : public QObject
+{
+    Q_OBJECT
+public:
+    SharedWorldPublisher(Simulation *simulation, QObject *parent = 0);
+    ~SharedWorldPublisher();
+    // Vessels beyond capacity are left out of the frames
+    bool open(const QString &name = SHARED_WORLD_NAME, int capacity = 65536);
+    void close();
+public slots:
+    // Connected to Simulation::tickTime
+    void publish(double dt, int total);
+    void explosion(double x, double y, double intensity);
+    // TorpedoDataComputer::solutionChanged
+    void solutionChanged(int target, bool valid, double gyroAngle, double runTime);
+
+private:
+    SharedWorldFrame *frame(int slot);
+
+    Simulation *simulation;
+    QString name;
+    int fd, capacity;
+    size_t size;
+    uchar *mapped;
+    double explosionX, explosionY, explosionIntensity;
+    int explosionCount;
+    quint32 published;
+    int solutionTarget;
+    bool solutionValid;
+    double solutionGyroAngle, solutionRunTime;
+};
+
+#endif // WORLDPUBLISHER_H
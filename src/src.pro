@@ -1,8 +1,12 @@
 TEMPLATE=subdirs
 CONFIG += ordered
-SUBDIRS= mapview\
+SUBDIRS= profiling \
+    mapview\
     periscopeview \
     weaponsview \
     hydrophoneview \
     servogauges \
-    simulation
+    simulation \
+    viewclient \
+    scenariotool \
+    benchmarks
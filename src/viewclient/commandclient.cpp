@@ -0,0 +1,64 @@
+#include "commandclient.h"
+#include "../simulation/vessel.h"
+
+CommandClient::CommandClient(QObject *parent) : QObject(parent)
+{
+    reconnectTimer.setInterval(1000);
+    connect(&reconnectTimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+}
+
+void CommandClient::connectTo(const QString &n) {
+    name = n;
+    reconnect();
+    reconnectTimer.start();
+}
+
+void CommandClient::reconnect() {
+    if(socket.state() == QLocalSocket::UnconnectedState)
+        socket.connectToServer(name);
+}
+
+// Commands while the simulation is away are dropped, like key presses
+// nobody saw
+void CommandClient::send(int type, int value, int value2, double direction) {
+    if(socket.state() != QLocalSocket::ConnectedState) return;
+    SimulationCommand command;
+    command.type = type;
+    command.value = value;
+    command.value2 = value2;
+    command.direction = direction;
+    socket.write((const char*) &command, sizeof(command));
+}
+
+void CommandClient::setHelm(int h) {
+    send(SimulationCommand::Helm, h);
+}
+
+void CommandClient::setSpeed(int s) {
+    send(SimulationCommand::Speed, s);
+}
+
+void CommandClient::setDepthChange(int s) {
+    send(SimulationCommand::DepthChange, s);
+}
+
+void CommandClient::fireTorpedo(double direction, int mode) {
+    send(SimulationCommand::FireTorpedo, mode, 0, direction);
+}
+
+void CommandClient::rewind() {
+    send(COMMAND_REWIND, 0);
+}
+
+void CommandClient::nextTarget() {
+    send(COMMAND_NEXT_TARGET, 0);
+}
+
+void CommandClient::fireSalvo(int mode, int count) {
+    send(COMMAND_FIRE_SALVO, mode, count);
+}
+
+void CommandClient::collisionBetween(Vessel *v, Vessel *v2) {
+    if(v && v2)
+        send(SimulationCommand::Collision, v->id, v2->id);
+}
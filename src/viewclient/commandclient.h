@@ -0,0 +1,38 @@
+#ifndef COMMANDCLIENT_H
+#define COMMANDCLIENT_H
+
+#include <QObject>
+#include <QTimer>
+#include <QLocalSocket>
+#include "../simulation/commandlink.h"
+
+class Vessel;
+
+// Sends a view's inputs to the simulation, see commandlink.h
+class CommandClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CommandClient(QObject *parent = 0);
+    // Keeps reconnecting until the simulation is there
+    void connectTo(const QString &name = COMMAND_SOCKET_NAME);
+public slots:
+    void setHelm(int h);
+    void setSpeed(int s);
+    void setDepthChange(int s);
+    void fireTorpedo(double direction, int mode = 0);
+    void rewind();
+    // Torpedo data computer
+    void nextTarget();
+    void fireSalvo(int mode, int count);
+    void collisionBetween(Vessel *v, Vessel *v2);
+private slots:
+    void reconnect();
+private:
+    void send(int type, int value, int value2 = 0, double direction = 0);
+    QString name;
+    QLocalSocket socket;
+    QTimer reconnectTimer;
+};
+
+#endif // COMMANDCLIENT_H
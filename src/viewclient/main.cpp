@@ -0,0 +1,121 @@
+#include <QtGui/QApplication>
+#include <QDebug>
+#include <QStringList>
+#include "worldmirror.h"
+#include "commandclient.h"
+#include "sessionmirror.h"
+#include "../mapview/mapqmlupdater.h"
+#include "../mapview/mapview.h"
+#include "../periscopeview/periscopeview.h"
+#include "../weaponsview/weaponsview.h"
+#include "../hydrophoneview/hydrophoneview.h"
+#include "../servogauges/servogauges.h"
+#include "../simulation/bathymetry.h"
+#include "../simulation/sessionclient.h"
+
+// One view of a simulation running in another process, started with
+// vesikko --publish; or, with session, a trainee's map and weapons aboard a
+// sub of their own in a session started with vesikko --session
+static int usage() {
+    qWarning() << "Usage: vesikko-view map|weapons|hydrophone|servo|periscope [--world name] [--commands name]"
+               << "[--record file.y4m] [--slices n] [--bathymetry file.vbt]";
+    qWarning() << "       vesikko-view session [--session name | --port n] [--bathymetry file.vbt]";
+    return 1;
+}
+
+// The session's vessels on the map and the player's orders and torpedoes
+// sent to the server for the player's sub. Rewinding is the instructor's.
+static int runSession(QApplication &app, const QStringList &args) {
+    SessionClient session;
+    SessionMirror world(&session);
+    MapView *mapView = new MapView(&app);
+    QObject::connect(&world, SIGNAL(vesselUpdated(Vessel*)), &mapView->mqu, SLOT(vesselUpdated(Vessel*)));
+    QObject::connect(&world, SIGNAL(vesselsCreated(QVector<Vessel*>)), &mapView->mqu, SLOT(createVessels(QVector<Vessel*>)));
+    QObject::connect(&world, SIGNAL(vesselsDeleted(QVector<Vessel*>)), &mapView->mqu, SLOT(vesselsDeleted(QVector<Vessel*>)));
+    QObject::connect(mapView, SIGNAL(setHelm(int)), &session, SLOT(setHelm(int)));
+    QObject::connect(mapView, SIGNAL(setSpeed(int)), &session, SLOT(setSpeed(int)));
+    QObject::connect(mapView, SIGNAL(setDepthChange(int)), &session, SLOT(setDepthChange(int)));
+    QString chart = option(args, "--bathymetry", QString());
+    if(!chart.isEmpty())
+        mapView->setChart(chart);
+    WeaponsView *weaponsView = new WeaponsView(&app);
+    QObject::connect(weaponsView, SIGNAL(fireTorpedo(double, int)), &session, SLOT(fireTorpedo(double, int)));
+    int port = option(args, "--port", "0").toInt();
+    if(port > 0)
+        session.connectToHost(port);
+    else
+        session.connectToLocal(option(args, "--session", SESSION_SOCKET_NAME));
+    return app.exec();
+}
+
+static QString option(const QStringList &args, const QString &name, const QString &defaultValue) {
+    int i = args.indexOf(name);
+    return i > 0 && i + 1 < args.size() ? args[i + 1] : defaultValue;
+}
+
+Q_DECL_EXPORT int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QStringList args = app.arguments();
+    if(args.size() < 2) return usage();
+    QString view = args[1];
+    if(view == "session")
+        return runSession(app, args);
+    WorldMirror world;
+    CommandClient commands;
+    Bathymetry bathymetry;
+
+    if(view == "map") {
+        MapView *mapView = new MapView(&app);
+        QObject::connect(&world, SIGNAL(vesselUpdated(Vessel*)), &mapView->mqu, SLOT(vesselUpdated(Vessel*)));
+        QObject::connect(&world, SIGNAL(vesselsCreated(QVector<Vessel*>)), &mapView->mqu, SLOT(createVessels(QVector<Vessel*>)));
+        QObject::connect(&world, SIGNAL(vesselsDeleted(QVector<Vessel*>)), &mapView->mqu, SLOT(vesselsDeleted(QVector<Vessel*>)));
+        QObject::connect(mapView, SIGNAL(setHelm(int)), &commands, SLOT(setHelm(int)));
+        QObject::connect(mapView, SIGNAL(setSpeed(int)), &commands, SLOT(setSpeed(int)));
+        QObject::connect(mapView, SIGNAL(setDepthChange(int)), &commands, SLOT(setDepthChange(int)));
+        QObject::connect(mapView, SIGNAL(rewind()), &commands, SLOT(rewind()));
+        QString chart = option(args, "--bathymetry", QString());
+        if(!chart.isEmpty())
+            mapView->setChart(chart);
+    } else if(view == "weapons") {
+        WeaponsView *weaponsView = new WeaponsView(&app);
+        QObject::connect(weaponsView, SIGNAL(fireTorpedo(double, int)), &commands, SLOT(fireTorpedo(double, int)));
+        // The torpedo data computer runs next to the simulation
+        QObject::connect(weaponsView, SIGNAL(nextTarget()), &commands, SLOT(nextTarget()));
+        QObject::connect(weaponsView, SIGNAL(fireSalvo(int, int)), &commands, SLOT(fireSalvo(int, int)));
+        QObject::connect(&world, SIGNAL(solutionChanged(int, bool, double, double)), weaponsView, SLOT(showSolution(int, bool, double, double)));
+    } else if(view == "hydrophone") {
+        HydrophoneView *hydrophoneView = new HydrophoneView(&app);
+        QObject::connect(&world, SIGNAL(vesselUpdated(Vessel*)), hydrophoneView, SLOT(vesselUpdated(Vessel*)));
+    } else if(view == "servo") {
+        ServoGauges *servoGauges = new ServoGauges(&app);
+        QObject::connect(&world, SIGNAL(vesselUpdated(Vessel*)), servoGauges, SLOT(vesselUpdated(Vessel*)));
+    } else if(view == "periscope") {
+        // A panorama across several projectors, one slice per display
+        int slices = option(args, "--slices", "1").toInt();
+        PeriscopeView *periscope = new PeriscopeView(&app, false, 400, 300, qMax(1, slices));
+        QObject::connect(&world, SIGNAL(vesselUpdated(Vessel*)), periscope, SLOT(vesselUpdated(Vessel*)));
+        QObject::connect(&world, SIGNAL(vesselsCreated(QVector<Vessel*>)), periscope, SLOT(createVessels(QVector<Vessel*>)));
+        QObject::connect(&world, SIGNAL(vesselsDeleted(QVector<Vessel*>)), periscope, SLOT(vesselsDeleted(QVector<Vessel*>)));
+        QObject::connect(&world, SIGNAL(tickTime(double, int)), periscope, SLOT(tick(double, int)));
+        QObject::connect(&world, SIGNAL(explosion(double,double,double)), periscope, SLOT(addExplosion(double,double,double)));
+        QObject::connect(periscope, SIGNAL(collisionBetween(Vessel*,Vessel*)), &commands, SLOT(collisionBetween(Vessel*,Vessel*)));
+        // Debrief recording of everything the periscope shows
+        QString recording = option(args, "--record", QString());
+        if(!recording.isEmpty() && !periscope->startRecording(recording))
+            qWarning() << "Can't record the periscope to" << recording;
+        // The same seabed the simulation was started with
+        QString seabedFile = option(args, "--bathymetry", QString());
+        if(!seabedFile.isEmpty()) {
+            if(bathymetry.open(seabedFile))
+                periscope->setBathymetry(&bathymetry);
+            else
+                qWarning() << "Can't load bathymetry" << seabedFile << bathymetry.errorString();
+        }
+    } else {
+        return usage();
+    }
+    world.start(option(args, "--world", SHARED_WORLD_NAME));
+    commands.connectTo(option(args, "--commands", COMMAND_SOCKET_NAME));
+    return app.exec();
+}
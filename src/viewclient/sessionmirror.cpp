@@ -0,0 +1,66 @@
+#include "sessionmirror.h"
+#include "../simulation/sessionclient.h"
+
+SessionMirror::SessionMirror(SessionClient *c, QObject *parent) :
+    QObject(parent), client(c), sub(this, 0), snapshots(0)
+{
+    connect(client, SIGNAL(snapshotReceived(int)), this, SLOT(apply()));
+}
+
+SessionMirror::~SessionMirror() {
+    foreach(const Mirrored &m, mirrored)
+        delete m.vessel;
+}
+
+void SessionMirror::apply() {
+    int player = client->playerId();
+    if(!player) return;
+    const QVector<ReplicatedVessel> &vessels = client->world().vessels;
+    snapshots++;
+    created.resize(0);
+    deleted.resize(0);
+    for(int i=0;i<vessels.size();i++) {
+        const ReplicatedVessel &rv = vessels[i];
+        int id = rv.id == player ? 0 : rv.id == 0 ? player : rv.id;
+        Vessel *v;
+        if(id == 0) {
+            v = &sub;
+        } else {
+            QHash<int, Mirrored>::iterator m = mirrored.find(id);
+            if(m == mirrored.end()) {
+                Mirrored entry;
+                entry.vessel = new Vessel(0, id);
+                m = mirrored.insert(id, entry);
+                created.append(entry.vessel);
+            }
+            m.value().snapshot = snapshots;
+            v = m.value().vessel;
+        }
+        v->x = dequantizePosition(rv.x);
+        v->y = dequantizePosition(rv.y);
+        v->depth = dequantizePosition(rv.depth);
+        v->heading = dequantizeHeading(rv.heading);
+        v->speed = dequantizeSpeed(rv.speed);
+        v->type = rv.type;
+    }
+    QHash<int, Mirrored>::iterator m = mirrored.begin();
+    while(m != mirrored.end()) {
+        if(m.value().snapshot != snapshots) {
+            deleted.append(m.value().vessel);
+            m = mirrored.erase(m);
+        } else {
+            ++m;
+        }
+    }
+
+    if(!deleted.isEmpty()) {
+        emit vesselsDeleted(deleted);
+        foreach(Vessel *v, deleted)
+            delete v;
+    }
+    if(!created.isEmpty())
+        emit vesselsCreated(created);
+    emit vesselUpdated(&sub);
+    foreach(const Mirrored &entry, mirrored)
+        emit vesselUpdated(entry.vessel);
+}
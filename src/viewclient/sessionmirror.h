@@ -0,0 +1,42 @@
+#ifndef SESSIONMIRROR_H
+#define SESSIONMIRROR_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include "../simulation/vessel.h"
+
+class SessionClient;
+
+/*
+ * Local copies of the vessels a SessionClient gets replicated, with the
+ * same signals WorldMirror gives the views. The views take vessel 0 to be
+ * the sub they are aboard, so the player's sub is shown as 0 and the
+ * simulation's own sub under the player's id.
+ */
+class SessionMirror : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionMirror(SessionClient *client, QObject *parent = 0);
+    ~SessionMirror();
+signals:
+    void vesselUpdated(Vessel *v);
+    void vesselsCreated(const QVector<Vessel*> &vessels);
+    void vesselsDeleted(const QVector<Vessel*> &vessels);
+private slots:
+    void apply();
+private:
+    SessionClient *client;
+    Vessel sub;
+    int snapshots;
+    struct Mirrored
+    {
+        Vessel *vessel;
+        int snapshot;
+    };
+    QHash<int, Mirrored> mirrored;
+    QVector<Vessel*> created, deleted;
+};
+
+#endif // SESSIONMIRROR_H
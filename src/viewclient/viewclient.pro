@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# A single view of a simulation running in
+# another process, or a trainee's station in a
+# session: vesikko-view <view>
+#
+#-------------------------------------------------
+
+TARGET = vesikko-view
+
+QT += declarative gui network
+
+CONFIG += link_prl
+
+# If periscopeview included
+CONFIG += link_pkgconfig
+PKGCONFIG += openscenegraph
+LIBS += -losgOcean
+LIBS +=  ../periscopeview/libperiscopeview.a
+LIBS +=  ../mapview/libmapview.a
+LIBS +=  ../weaponsview/libweaponsview.a
+LIBS +=  ../hydrophoneview/libhydrophoneview.a
+LIBS +=  ../servogauges/libservogauges.a
+LIBS +=  ../profiling/libprofiling.a
+# shm_open
+LIBS += -lrt
+
+SOURCES += main.cpp \
+    worldmirror.cpp \
+    commandclient.cpp \
+    sessionmirror.cpp \
+    ../simulation/vessel.cpp \
+    ../simulation/torpedo.cpp \
+    ../simulation/contactgrid.cpp \
+    ../simulation/sharedworld.cpp \
+    ../simulation/bathymetry.cpp \
+    ../simulation/replication.cpp \
+    ../simulation/sessionclient.cpp
+
+HEADERS += worldmirror.h \
+    commandclient.h \
+    sessionmirror.h \
+    ../simulation/vessel.h \
+    ../simulation/torpedo.h \
+    ../simulation/contactgrid.h \
+    ../simulation/sharedworld.h \
+    ../simulation/commandlink.h \
+    ../simulation/bathymetry.h \
+    ../simulation/replication.h \
+    ../simulation/sessionclient.h
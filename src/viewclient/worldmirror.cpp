@@ -0,0 +1,129 @@
+#include "worldmirror.h"
+#include "../simulation/torpedo.h"
+#include <QDebug>
+#include <string.h>
+
+// Polls without a new tick before the segment is taken to be left behind by
+// a simulation that went away, and opened again
+#define MIRROR_STALE_POLLS 100
+// Attempts at reading a frame whole before waiting for the next poll
+#define MIRROR_READ_ATTEMPTS 3
+
+WorldMirror::WorldMirror(QObject *parent) :
+    QObject(parent), lastNumber(0), stalePolls(0), lastExplosionCount(0),
+    lastSolutionTarget(-1), lastSolutionValid(0), lastGyroAngle(0), lastRunTime(0), lastTime(0), sub(this, 0)
+{
+    connect(&timer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+WorldMirror::~WorldMirror() {
+    foreach(const Mirrored &m, mirrored)
+        delete m.vessel;
+}
+
+void WorldMirror::start(const QString &n, int interval) {
+    name = n;
+    timer.start(interval);
+}
+
+void WorldMirror::poll() {
+    if(!reader.isOpen() && !reader.open(name))
+        return;
+    for(int attempt=0;attempt<MIRROR_READ_ATTEMPTS;attempt++) {
+        if(readFrame()) {
+            if(frame.number == lastNumber) {
+                if(++stalePolls > MIRROR_STALE_POLLS) {
+                    qDebug() << Q_FUNC_INFO << "no new frames, reopening" << name;
+                    reader.close();
+                    stalePolls = 0;
+                    // A new simulation counts from the start
+                    lastNumber = 0;
+                }
+                return;
+            }
+            stalePolls = 0;
+            apply();
+            return;
+        }
+    }
+}
+
+// Copies the newest frame out; false if there is none or the simulation
+// overwrote it meanwhile
+bool WorldMirror::readFrame() {
+    quint32 seq;
+    const SharedWorldFrame *f = reader.beginRead(&seq);
+    if(!f) return false;
+    memcpy(&frame, f, offsetof(SharedWorldFrame, vessels));
+    if(frame.count < 0 || frame.count > reader.capacity()) return false;
+    frameVessels.resize(frame.count);
+    memcpy(frameVessels.data(), f->vessels, frame.count * sizeof(SharedVessel));
+    return reader.endRead(f, seq);
+}
+
+void WorldMirror::apply() {
+    created.resize(0);
+    deleted.resize(0);
+    for(int i=0;i<frameVessels.size();i++) {
+        const SharedVessel &sv = frameVessels[i];
+        Vessel *v;
+        if(sv.id == 0) {
+            v = &sub;
+        } else {
+            QHash<int, Mirrored>::iterator m = mirrored.find(sv.id);
+            if(m == mirrored.end()) {
+                Mirrored entry;
+                entry.vessel = sv.type == 2 ? new Torpedo(0, sv.id) : new Vessel(0, sv.id);
+                m = mirrored.insert(sv.id, entry);
+                created.append(entry.vessel);
+            }
+            m.value().number = frame.number;
+            v = m.value().vessel;
+        }
+        v->x = sv.x;
+        v->y = sv.y;
+        v->depth = sv.depth;
+        v->heading = sv.heading;
+        v->speed = sv.speed;
+        v->helm = sv.helm;
+        v->type = sv.type;
+        if(v->type == 2)
+            static_cast<Torpedo*>(v)->mode = sv.mode;
+    }
+    QHash<int, Mirrored>::iterator m = mirrored.begin();
+    while(m != mirrored.end()) {
+        if(m.value().number != frame.number) {
+            deleted.append(m.value().vessel);
+            m = mirrored.erase(m);
+        } else {
+            ++m;
+        }
+    }
+
+    if(!deleted.isEmpty()) {
+        emit vesselsDeleted(deleted);
+        foreach(Vessel *v, deleted)
+            delete v;
+    }
+    if(!created.isEmpty())
+        emit vesselsCreated(created);
+    emit vesselUpdated(&sub);
+    foreach(const Mirrored &entry, mirrored)
+        emit vesselUpdated(entry.vessel);
+    if(frame.explosionCount != lastExplosionCount && lastNumber)
+        emit explosion(frame.explosionX, frame.explosionY, frame.explosionIntensity);
+    lastExplosionCount = frame.explosionCount;
+    if(frame.solutionTarget != lastSolutionTarget || frame.solutionValid != lastSolutionValid
+            || frame.solutionGyroAngle != lastGyroAngle || frame.solutionRunTime != lastRunTime) {
+        lastSolutionTarget = frame.solutionTarget;
+        lastSolutionValid = frame.solutionValid;
+        lastGyroAngle = frame.solutionGyroAngle;
+        lastRunTime = frame.solutionRunTime;
+        emit solutionChanged(lastSolutionTarget, lastSolutionValid, lastGyroAngle, lastRunTime);
+    }
+    // Frames skipped in between count towards the step
+    double dt = lastNumber && frame.time >= lastTime ? frame.time - lastTime : frame.dt;
+    lastNumber = frame.number;
+    lastTime = frame.time;
+    emit tickTime(dt, frame.total);
+}
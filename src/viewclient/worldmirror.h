@@ -0,0 +1,64 @@
+#ifndef WORLDMIRROR_H
+#define WORLDMIRROR_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include "../simulation/vessel.h"
+#include "../simulation/sharedworld.h"
+
+/*
+ * Local copies of the vessels of a world published over shared memory,
+ * with the same signals Simulation gives the views in process. Torpedoes
+ * are mirrored as Torpedo, with their mode.
+ *
+ * Frames are polled, so a view busy drawing only skips frames; the
+ * simulation never waits for it.
+ */
+class WorldMirror : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WorldMirror(QObject *parent = 0);
+    ~WorldMirror();
+    // Keeps trying until the world is published
+    void start(const QString &name = SHARED_WORLD_NAME, int interval = 20);
+signals:
+    void vesselUpdated(Vessel *v);
+    void vesselsCreated(const QVector<Vessel*> &vessels);
+    void vesselsDeleted(const QVector<Vessel*> &vessels);
+    void tickTime(double dt, int total);
+    void explosion(double x, double y, double intensity);
+    // The simulation's torpedo data computer, see
+    // TorpedoDataComputer::solutionChanged
+    void solutionChanged(int target, bool valid, double gyroAngle, double runTime);
+private slots:
+    void poll();
+private:
+    bool readFrame();
+    void apply();
+
+    QString name;
+    QTimer timer;
+    SharedWorldReader reader;
+    // The newest frame, copied out of the segment once it read whole
+    SharedWorldFrame frame;
+    QVector<SharedVessel> frameVessels;
+    // Number of the newest frame applied, 0 for none
+    quint32 lastNumber;
+    int stalePolls, lastExplosionCount;
+    int lastSolutionTarget, lastSolutionValid;
+    double lastGyroAngle, lastRunTime;
+    double lastTime;
+    Vessel sub;
+    struct Mirrored
+    {
+        Vessel *vessel;
+        quint32 number;
+    };
+    QHash<int, Mirrored> mirrored;
+    QVector<Vessel*> created, deleted;
+};
+
+#endif // WORLDMIRROR_H
@@ -3,7 +3,26 @@ import QtQuick 1.0
 Rectangle {
     id: weaponsView
     color: "black"
-    signal fireTorpedo(double direction)
+    signal fireTorpedo(double direction, int mode)
+    signal nextTarget()
+    signal fireSalvo(int mode, int count)
+    property int torpedoMode: 0
+    property variant modeNames: ["Straight", "Pattern", "Passive", "Active"]
+    property int salvoCount: 1
+    property int target: 0
+    property string solutionText: "No target"
+
+    // From the torpedo data computer
+    function showSolution(newTarget, valid, gyroAngle, runTime) {
+        target = newTarget;
+        if(!target)
+            solutionText = "No target";
+        else if(!valid)
+            solutionText = "Out of range";
+        else
+            solutionText = "Gyro " + (gyroAngle < 0 ? "L " : "R ") + Math.abs(gyroAngle).toFixed(1)
+                    + "  Run " + runTime.toFixed(0) + " s";
+    }
 
     Button {
         id: firebutton
@@ -18,8 +37,56 @@ Rectangle {
                 heading += num3.value;
                 while(heading > 360)
                     heading -= 360;
-                console.log("fire in " + heading);
-                weaponsView.fireTorpedo(heading);
+                console.log("fire in " + heading + " mode " + torpedoMode);
+                weaponsView.fireTorpedo(heading, torpedoMode);
+            }
+        }
+    }
+
+    Button {
+        id: modebutton
+        anchors.top: firebutton.bottom
+        anchors.topMargin: 10
+        text: modeNames[torpedoMode]
+        MouseArea {
+            anchors.fill: parent
+            onClicked: torpedoMode = (torpedoMode + 1) % 4
+        }
+    }
+
+    // Torpedo data computer: fires on the solution for the selected track
+    Column {
+        id: tdc
+        anchors.right: parent.right
+        anchors.verticalCenter: parent.verticalCenter
+        spacing: 10
+        Button {
+            width: 150
+            text: target ? "Target " + target : "No target"
+            MouseArea {
+                anchors.fill: parent
+                onClicked: weaponsView.nextTarget()
+            }
+        }
+        Text {
+            width: 150
+            text: solutionText
+            color: "white"
+        }
+        Button {
+            width: 150
+            text: "Salvo " + salvoCount
+            MouseArea {
+                anchors.fill: parent
+                onClicked: salvoCount = salvoCount == 4 ? 1 : salvoCount * 2
+            }
+        }
+        Button {
+            width: 150
+            text: "Fire on solution"
+            MouseArea {
+                anchors.fill: parent
+                onClicked: weaponsView.fireSalvo(torpedoMode, salvoCount)
             }
         }
     }
@@ -4,12 +4,12 @@
 #include <QDeclarativeItem>
 #include <QCoreApplication>
 
-WeaponsView::WeaponsView(QObject *parent) : QObject(parent), mainWin()
+WeaponsView::WeaponsView(QObject *parent) : QObject(parent), mainWin(), weaponsViewObject(0)
 {
     view = new QDeclarativeView(&mainWin);
     view->setSource(QUrl::fromLocalFile("src/weaponsview/qml/vesikko/WeaponsView.qml"));
     view->setResizeMode(QDeclarativeView::SizeRootObjectToView);
-    mainWin.setGeometry(QRect(500,0,500,250));
+    mainWin.setGeometry(QRect(500,0,700,250));
     mainWin.setCentralWidget(view);
     mainWin.setWindowTitle("Vesikko Weapons");
     mainWin.show();
@@ -19,6 +19,18 @@ WeaponsView::WeaponsView(QObject *parent) : QObject(parent), mainWin()
         qDebug() << "No root object - QML missing?";
         return;
     }
-    QObject::connect(object, SIGNAL(fireTorpedo(double)), this, SIGNAL(fireTorpedo(double)));
+    weaponsViewObject = object;
+    QObject::connect(object, SIGNAL(fireTorpedo(double, int)), this, SIGNAL(fireTorpedo(double, int)));
+    QObject::connect(object, SIGNAL(nextTarget()), this, SIGNAL(nextTarget()));
+    QObject::connect(object, SIGNAL(fireSalvo(int, int)), this, SIGNAL(fireSalvo(int, int)));
     connect(&mainWin, SIGNAL(destroyed()), QCoreApplication::instance(), SLOT(quit()));
 }
+
+void WeaponsView::showSolution(int target, bool valid, double gyroAngle, double runTime) {
+    if(!weaponsViewObject) return;
+    QMetaObject::invokeMethod(weaponsViewObject, "showSolution",
+                              Q_ARG(QVariant, target),
+                              Q_ARG(QVariant, valid),
+                              Q_ARG(QVariant, gyroAngle),
+                              Q_ARG(QVariant, runTime));
+}
@@ -12,10 +12,17 @@ Q_OBJECT
 public:
     WeaponsView(QObject *parent = 0);
 signals:
-    void fireTorpedo(double dir);
+    // mode: 0 straight, 1 pattern, 2 passive homing, 3 active homing
+    void fireTorpedo(double dir, int mode);
+    void nextTarget();
+    void fireSalvo(int mode, int count);
+public slots:
+    // TorpedoDataComputer::solutionChanged
+    void showSolution(int target, bool valid, double gyroAngle, double runTime);
 private:
     QDeclarativeView *view;
     QMainWindow mainWin;
+    QObject *weaponsViewObject;
 };
 
 #endif // WEAPONSVIEW_H